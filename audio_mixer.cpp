@@ -0,0 +1,352 @@
+#include "audio_mixer.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <cmath>    // For cos/sin (pan law)
+#include <cstring>  // For memset
+#include <iostream> // For error output
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_MIXER_SSE2 1
+#endif
+
+namespace {
+
+const int MIXER_SOUND_PADDING = 4;  // Silent samples after each sound so interpolation can read idx + 1
+const int MIX_BLOCK_FRAMES = 256;   // Frames mixed per pass over the voices
+const size_t COMMAND_QUEUE_SIZE = 256; // Commands queued between two callbacks
+const int POSITION_SHIFT = 32;      // Voice positions are 32.32 fixed point
+
+struct Voice {
+    MixerVoiceId id;
+    const MixerSound* sound;
+    Uint64 position;
+    Uint64 step;
+    float gainLeft;
+    float gainRight;
+    Uint32 startOrder; // For stealing the oldest voice
+    bool active;
+};
+
+enum class MixerCommandType : Uint8 { Play, Stop, SetParams, StopAll };
+
+struct MixerCommand {
+    MixerCommandType type;
+    MixerVoiceId voice;
+    const MixerSound* sound;
+    float gain;
+    float pan;
+    float pitch;
+};
+
+// Owned by the audio thread
+Voice gVoices[MAX_MIXER_VOICES];
+Uint32 gNextStartOrder = 0;
+alignas(16) float gMixBuffer[MIX_BLOCK_FRAMES * 2];
+
+// Written by the game thread, drained by the audio callback; neither side ever waits on the other
+SpscRing<MixerCommand, COMMAND_QUEUE_SIZE> gCommands;
+
+// Extra source (music) mixed under the voices; swapped atomically so it can change while playing
+std::atomic<MixerStreamFunction> gStream(nullptr);
+
+// Game thread only
+MixerVoiceId gNextVoiceId = 1;
+Uint32 gDroppedCommands = 0;
+bool gMixerActive = false;
+int gMixerSampleRate = 0;
+
+void setVoiceParams(Voice& voice, float gain, float pan, float pitch) {
+    // Equal-power pan: constant loudness as the sound moves across the screen
+    pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+    float angle = (pan + 1.0f) * 0.25f * 3.14159265f;
+    if (pitch <= 0.0f) {
+        pitch = 1.0f;
+    }
+    voice.step = static_cast<Uint64>(pitch * static_cast<double>(1ull << POSITION_SHIFT));
+    voice.gainLeft = gain * std::cos(angle);
+    voice.gainRight = gain * std::sin(angle);
+}
+
+Voice* findVoice(MixerVoiceId id) {
+    for (Voice& voice : gVoices) {
+        if (voice.active && voice.id == id) {
+            return &voice;
+        }
+    }
+    return nullptr; // Already finished or stolen
+}
+
+void startVoice(const MixerCommand& start) {
+    // Use a free voice, or steal the one that has been playing the longest
+    Voice* voice = nullptr;
+    for (Voice& candidate : gVoices) {
+        if (!candidate.active) {
+            voice = &candidate;
+            break;
+        }
+        if (voice == nullptr || candidate.startOrder < voice->startOrder) {
+            voice = &candidate;
+        }
+    }
+
+    voice->id = start.voice;
+    voice->sound = start.sound;
+    voice->position = 0;
+    voice->startOrder = gNextStartOrder++;
+    voice->active = true;
+    setVoiceParams(*voice, start.gain, start.pan, start.pitch);
+}
+
+void runCommand(const MixerCommand& command) {
+    switch (command.type) {
+    case MixerCommandType::Play:
+        startVoice(command);
+        break;
+    case MixerCommandType::Stop:
+        if (Voice* voice = findVoice(command.voice)) {
+            voice->active = false;
+        }
+        break;
+    case MixerCommandType::SetParams:
+        if (Voice* voice = findVoice(command.voice)) {
+            setVoiceParams(*voice, command.gain, command.pan, command.pitch);
+        }
+        break;
+    case MixerCommandType::StopAll:
+        for (Voice& voice : gVoices) {
+            voice.active = false;
+        }
+        break;
+    }
+}
+
+// Game thread: queue a command without ever blocking on the audio device
+bool sendCommand(const MixerCommand& command) {
+    if (!gMixerActive) {
+        return false;
+    }
+    if (!gCommands.push(command)) {
+        // The callback has not run for a while (device stalled?); drop rather than wait
+        gDroppedCommands++;
+        return false;
+    }
+    return true;
+}
+
+// Adds frames of one voice into out (interleaved stereo). Returns false once the voice has finished.
+bool mixVoice(Voice& voice, float* out, int frames) {
+    const float* samples = voice.sound->samples;
+    Uint64 end = static_cast<Uint64>(voice.sound->length) << POSITION_SHIFT;
+    if (voice.position >= end) {
+        return false;
+    }
+
+    // Frames left before the voice runs off the end of its sound
+    Uint64 remaining = (end - voice.position + voice.step - 1) / voice.step;
+    int count = remaining < static_cast<Uint64>(frames) ? static_cast<int>(remaining) : frames;
+
+    Uint64 position = voice.position;
+    Uint64 step = voice.step;
+    const float fracScale = 1.0f / 4294967296.0f;
+    int i = 0;
+
+#ifdef AUDIO_MIXER_SSE2
+    __m128 gainLeft = _mm_set1_ps(voice.gainLeft);
+    __m128 gainRight = _mm_set1_ps(voice.gainRight);
+    for (; i + 4 <= count; i += 4) {
+        Uint64 p0 = position;
+        Uint64 p1 = p0 + step;
+        Uint64 p2 = p1 + step;
+        Uint64 p3 = p2 + step;
+        position = p3 + step;
+
+        size_t i0 = static_cast<size_t>(p0 >> POSITION_SHIFT);
+        size_t i1 = static_cast<size_t>(p1 >> POSITION_SHIFT);
+        size_t i2 = static_cast<size_t>(p2 >> POSITION_SHIFT);
+        size_t i3 = static_cast<size_t>(p3 >> POSITION_SHIFT);
+
+        __m128 a = _mm_setr_ps(samples[i0], samples[i1], samples[i2], samples[i3]);
+        __m128 b = _mm_setr_ps(samples[i0 + 1], samples[i1 + 1], samples[i2 + 1], samples[i3 + 1]);
+        __m128 frac = _mm_mul_ps(_mm_setr_ps(
+            static_cast<float>(static_cast<Uint32>(p0)), static_cast<float>(static_cast<Uint32>(p1)),
+            static_cast<float>(static_cast<Uint32>(p2)), static_cast<float>(static_cast<Uint32>(p3))),
+            _mm_set1_ps(fracScale));
+
+        // Linear interpolation, then pan into L/R and interleave
+        __m128 value = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), frac));
+        __m128 left = _mm_mul_ps(value, gainLeft);
+        __m128 right = _mm_mul_ps(value, gainRight);
+        float* dst = out + i * 2;
+        _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_unpacklo_ps(left, right)));
+        _mm_storeu_ps(dst + 4, _mm_add_ps(_mm_loadu_ps(dst + 4), _mm_unpackhi_ps(left, right)));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        size_t index = static_cast<size_t>(position >> POSITION_SHIFT);
+        float frac = static_cast<float>(static_cast<Uint32>(position)) * fracScale;
+        float value = samples[index] + (samples[index + 1] - samples[index]) * frac;
+        out[i * 2] += value * voice.gainLeft;
+        out[i * 2 + 1] += value * voice.gainRight;
+        position += step;
+    }
+
+    voice.position = position;
+    return count == frames && position < end;
+}
+
+// Float [-1, 1] to saturated 16-bit
+void convertToS16(const float* in, Sint16* out, int samples) {
+    int i = 0;
+#ifdef AUDIO_MIXER_SSE2
+    __m128 scale = _mm_set1_ps(32767.0f);
+    for (; i + 8 <= samples; i += 8) {
+        __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(in + i), scale));
+        __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(in + i + 4), scale));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(lo, hi));
+    }
+#endif
+    for (; i < samples; ++i) {
+        float value = in[i] * 32767.0f;
+        if (value > 32767.0f) value = 32767.0f;
+        if (value < -32768.0f) value = -32768.0f;
+        out[i] = static_cast<Sint16>(value);
+    }
+}
+
+// Mix_HookMusic callback: runs on the audio thread and must never block or allocate
+void mixerCallback(void* userdata, Uint8* stream, int len) {
+    (void)userdata;
+
+    MixerCommand command;
+    while (gCommands.pop(command)) {
+        runCommand(command);
+    }
+
+    Sint16* out = reinterpret_cast<Sint16*>(stream);
+    int totalFrames = len / (2 * static_cast<int>(sizeof(Sint16)));
+    for (int offset = 0; offset < totalFrames; offset += MIX_BLOCK_FRAMES) {
+        int frames = totalFrames - offset < MIX_BLOCK_FRAMES ? totalFrames - offset : MIX_BLOCK_FRAMES;
+        memset(gMixBuffer, 0, sizeof(float) * frames * 2);
+        MixerStreamFunction stream = gStream.load(std::memory_order_acquire);
+        if (stream) {
+            stream(gMixBuffer, frames);
+        }
+        for (Voice& voice : gVoices) {
+            if (voice.active && !mixVoice(voice, gMixBuffer, frames)) {
+                voice.active = false;
+            }
+        }
+        convertToS16(gMixBuffer, out + offset * 2, frames * 2);
+    }
+}
+
+} // namespace
+
+bool initAudioMixer() {
+    int frequency;
+    Uint16 format;
+    int channels;
+    if (Mix_QuerySpec(&frequency, &format, &channels) == 0) {
+        std::cerr << "Audio mixer: audio device is not open! SDL_mixer Error: " << Mix_GetError() << std::endl;
+        return false;
+    }
+    if (format != AUDIO_S16SYS || channels != 2) {
+        std::cerr << "Audio mixer: needs 16-bit stereo output, falling back to SDL_mixer channels." << std::endl;
+        return false;
+    }
+    gMixerSampleRate = frequency;
+    memset(gVoices, 0, sizeof(gVoices));
+    MixerCommand stale;
+    while (gCommands.pop(stale)) {
+        // Drop commands left over from a previous session (the callback is not hooked yet)
+    }
+    Mix_HookMusic(mixerCallback, nullptr);
+    gMixerActive = true;
+    return true;
+}
+
+void closeAudioMixer() {
+    if (gMixerActive) {
+        Mix_HookMusic(nullptr, nullptr); // SDL_mixer waits for the callback to finish
+        gMixerActive = false;
+        if (gDroppedCommands > 0) {
+            std::cerr << "Audio mixer dropped " << gDroppedCommands << " commands (queue full)." << std::endl;
+        }
+    }
+}
+
+bool isAudioMixerActive() {
+    return gMixerActive;
+}
+
+MixerSound* createMixerSound(const Mix_Chunk* chunk) {
+    if (chunk == nullptr || chunk->abuf == nullptr) {
+        return nullptr;
+    }
+    // The chunk is already converted to the device format (16-bit stereo); downmix to mono float
+    const Sint16* pcm = reinterpret_cast<const Sint16*>(chunk->abuf);
+    int frames = static_cast<int>(chunk->alen / (2 * sizeof(Sint16)));
+    MixerSound* sound = allocateMixerSound(frames);
+    for (int i = 0; i < frames; ++i) {
+        sound->samples[i] = (pcm[i * 2] + pcm[i * 2 + 1]) * (0.5f / 32768.0f);
+    }
+    return sound;
+}
+
+MixerSound* allocateMixerSound(int length) {
+    MixerSound* sound = new MixerSound;
+    sound->length = length;
+    sound->samples = new float[length + MIXER_SOUND_PADDING](); // Zeroed, including the padding
+    return sound;
+}
+
+int getMixerSampleRate() {
+    return gMixerSampleRate;
+}
+
+void freeMixerSound(MixerSound* sound) {
+    if (sound) {
+        delete[] sound->samples;
+        delete sound;
+    }
+}
+
+MixerVoiceId playMixerSound(const MixerSound* sound, float gain, float pan, float pitch) {
+    if (sound == nullptr) {
+        return 0;
+    }
+    MixerVoiceId id = gNextVoiceId++;
+    if (gNextVoiceId == 0) {
+        gNextVoiceId = 1; // 0 means "no voice"
+    }
+    if (!sendCommand({ MixerCommandType::Play, id, sound, gain, pan, pitch })) {
+        return 0;
+    }
+    return id;
+}
+
+void stopMixerVoice(MixerVoiceId voice) {
+    if (voice != 0) {
+        sendCommand({ MixerCommandType::Stop, voice, nullptr, 0.0f, 0.0f, 0.0f });
+    }
+}
+
+void setMixerVoiceParams(MixerVoiceId voice, float gain, float pan, float pitch) {
+    if (voice != 0) {
+        sendCommand({ MixerCommandType::SetParams, voice, nullptr, gain, pan, pitch });
+    }
+}
+
+void stopAllMixerVoices() {
+    sendCommand({ MixerCommandType::StopAll, 0, nullptr, 0.0f, 0.0f, 0.0f });
+}
+
+void setMixerStream(MixerStreamFunction stream) {
+    gStream.store(stream, std::memory_order_release);
+}
+
+float panFromScreenX(float x, int screenWidth) {
+    return x / screenWidth * 2.0f - 1.0f;
+}
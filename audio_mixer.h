@@ -0,0 +1,74 @@
+#pragma once
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <SDL.h>
+#include <SDL_mixer.h>
+
+// In-house sound effect mixer.
+//
+// Runs inside SDL_mixer's audio callback (through Mix_HookMusic) and mixes up
+// to MAX_MIXER_VOICES voices with SSE2. Each voice has its own gain, an
+// equal-power stereo pan and a pitch, applied by resampling with linear
+// interpolation. Once every voice is busy, a new sound takes over the voice
+// that has been playing the longest, so bursts of triggers never grow the
+// work done per callback.
+//
+// The game thread never touches voices directly: play/stop/set-param calls
+// become commands in a lock-free single-producer ring that the callback
+// drains at the start of each buffer. The game loop therefore never waits for
+// the audio device, and the callback never waits for game code. All calls
+// below must come from the game thread.
+
+const int MAX_MIXER_VOICES = 32;
+
+// Handle to a playing voice; 0 means "no voice". Stale handles are ignored.
+typedef Uint32 MixerVoiceId;
+
+// Mono float PCM at the device sample rate, ready for mixing
+struct MixerSound {
+    float* samples; // length + padding samples; the padding is silence
+    int length;
+};
+
+// Hooks the mixer into the open SDL_mixer device. Needs 16-bit stereo output.
+bool initAudioMixer();
+
+void closeAudioMixer();
+
+// True between a successful initAudioMixer() and closeAudioMixer()
+bool isAudioMixerActive();
+
+// Converts a decoded chunk (device format) to a mixer sound. Returns nullptr on failure.
+MixerSound* createMixerSound(const Mix_Chunk* chunk);
+
+// An all-silent sound of length samples, for code that generates its own PCM
+MixerSound* allocateMixerSound(int length);
+
+void freeMixerSound(MixerSound* sound);
+
+// Output rate of the open device; 0 before initAudioMixer() succeeds
+int getMixerSampleRate();
+
+// Starts a voice. gain is linear, pan goes from -1 (left) to 1 (right),
+// pitch is a playback rate (1 = original). Returns 0 if the command queue is full.
+MixerVoiceId playMixerSound(const MixerSound* sound, float gain, float pan, float pitch);
+
+void stopMixerVoice(MixerVoiceId voice);
+
+void setMixerVoiceParams(MixerVoiceId voice, float gain, float pan, float pitch);
+
+void stopAllMixerVoices();
+
+// Adds frames of interleaved stereo float into out. Called on the audio thread
+// for every block, so it must not block or allocate.
+typedef void (*MixerStreamFunction)(float* out, int frames);
+
+// Installs (or with nullptr removes) a continuous source such as music, mixed
+// under the sound effects
+void setMixerStream(MixerStreamFunction stream);
+
+// Maps a horizontal screen position to a pan value
+float panFromScreenX(float x, int screenWidth);
+
+#endif
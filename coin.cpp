@@ -1,11 +1,13 @@
 #include "coin.h"
-#include <SDL_image.h> // Required for IMG_LoadTexture
+#include "image_loader.h" // QOI fast path with PNG fallback
+#include "sprite_sheet.h" // Trimmed, packed frames built by sprite_packer
+#include "rle_sprite.h"   // Run-length encoded frames for the software renderer
 #include <iostream>    // For error output
 #include <string>      // For std::string and std::to_string
 #include <vector>      // For std::vector
 
-// Global vector to hold all coin animation textures
-std::vector<SDL_Texture*> gCoinTextures;
+// Packed sheet preferred over the individual frames
+const char* COIN_SHEET_PATH = "coin.sprites";
 
 // Number of frames in the animation (coin_01.png to coin_08.png means 8 frames)
 const int NUM_COIN_FRAMES = 8;
@@ -18,46 +20,126 @@ const int COIN_ANIMATION_SPEED_MS = 100; // 100ms per frame = 10 frames per seco
 const int DEFAULT_COIN_FRAME_WIDTH = 32;
 const int DEFAULT_COIN_FRAME_HEIGHT = 32;
 
+// Frees the RLE frames and the surfaces they are encoded from
+void freeCoinRleFrames(CoinSystem& coins) {
+    for (RleSprite* sprite : coins.rleFrames) {
+        freeRleSprite(sprite);
+    }
+    coins.rleFrames.clear();
+    for (SDL_Surface* surface : coins.surfaces) {
+        SDL_FreeSurface(surface);
+    }
+    coins.surfaces.clear();
+    coins.rleScale = 0.0f;
+}
+
+// Makes sure coins.rleFrames hold every frame scaled by scale, each at its own
+// size, so frames of different widths share one cache entry through a spin.
+// The frames are scaled once here (nearest neighbour, like the software
+// renderer) rather than on every blit. Returns false if the frames cannot be
+// prepared.
+bool prepareCoinRleFrames(CoinSystem& coins, float scale) {
+    if (scale <= 0.0f) {
+        return false;
+    }
+    if (scale == coins.rleScale && !coins.rleFrames.empty()) {
+        return true;
+    }
+    if (coins.surfaces.empty()) {
+        for (int i = 1; i <= NUM_COIN_FRAMES; ++i) {
+            std::string filename = "coin_0" + std::to_string(i) + ".png";
+            SDL_Surface* surface = loadImageSurface(filename.c_str());
+            if (surface == nullptr) {
+                freeCoinRleFrames(coins);
+                return false;
+            }
+            coins.surfaces.push_back(surface);
+        }
+    }
+
+    for (RleSprite* sprite : coins.rleFrames) {
+        freeRleSprite(sprite);
+    }
+    coins.rleFrames.clear();
+    for (SDL_Surface* surface : coins.surfaces) {
+        // Same rounding as getCoinFrame, so the sprite covers the frame's dstRect
+        int width = static_cast<int>(surface->w * scale);
+        int height = static_cast<int>(surface->h * scale);
+        SDL_Surface* scaled = width > 0 && height > 0 ? SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888) : nullptr;
+        if (scaled == nullptr) {
+            freeCoinRleFrames(coins);
+            return false;
+        }
+        SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE); // Copy alpha instead of blending onto the empty surface
+        SDL_BlitScaled(surface, nullptr, scaled, nullptr);
+        RleSprite* sprite = createRleSprite(scaled);
+        SDL_FreeSurface(scaled);
+        if (sprite == nullptr) {
+            freeCoinRleFrames(coins);
+            return false;
+        }
+        coins.rleFrames.push_back(sprite);
+    }
+    coins.rleScale = scale;
+    return true;
+}
+
+void setCoinSoftwareTarget(CoinSystem& coins, SDL_Surface* target) {
+    coins.softwareTarget = target;
+    if (target == nullptr) {
+        freeCoinRleFrames(coins);
+    }
+}
+
 // Initializes the coin system by loading all individual coin textures.
 // Returns true if all textures are loaded successfully, false otherwise.
-bool initCoinSystem(SDL_Renderer* renderer) {
+bool initCoinSystem(CoinSystem& coins, SDL_Renderer* renderer) {
     // Clear any existing textures in case init is called multiple times
-    closeCoinSystem();
+    closeCoinSystem(coins);
+
+    // Prefer the packed sheet: one texture, and no transparent border to fill
+    coins.sheet = loadSpriteSheet(renderer, COIN_SHEET_PATH);
+    if (coins.sheet != nullptr) {
+        if (coins.sheet->frames.size() >= static_cast<size_t>(NUM_COIN_FRAMES)) {
+            std::cout << "Loaded " << coins.sheet->frames.size() << " coin frames from " << COIN_SHEET_PATH << "." << std::endl;
+            return true;
+        }
+        std::cerr << COIN_SHEET_PATH << " has fewer than " << NUM_COIN_FRAMES << " frames; loading the PNGs instead." << std::endl;
+        freeSpriteSheet(coins.sheet);
+        coins.sheet = nullptr;
+    }
 
     for (int i = 1; i <= NUM_COIN_FRAMES; ++i) {
         // Construct the filename: "coin_01.png", "coin_02.png", etc.
         std::string filename = "coin_0" + std::to_string(i) + ".png";
-        SDL_Texture* texture = IMG_LoadTexture(renderer, filename.c_str());
+        SDL_Texture* texture = loadImageTexture(renderer, filename.c_str()); // Uses coin_0N.qoi when present
         if (texture == nullptr) {
-            std::cerr << "Failed to load coin texture: " << filename << "! SDL_image Error: " << IMG_GetError() << std::endl;
+            std::cerr << "Failed to load coin texture: " << filename << "!" << std::endl;
             // Clean up any textures that were loaded before the failure
-            closeCoinSystem(); // Call close to free any partially loaded textures
+            closeCoinSystem(coins); // Call close to free any partially loaded textures
             return false;
         }
-        gCoinTextures.push_back(texture);
+        coins.textures.push_back(texture);
     }
-    std::cout << "Successfully loaded " << gCoinTextures.size() << " coin textures." << std::endl;
+    std::cout << "Successfully loaded " << coins.textures.size() << " coin textures." << std::endl;
     return true;
 }
 
-// Draws an animated coin at the given position and scale.
-void draw_Coin(int x, int y, float scale, SDL_Renderer* renderer, Uint32 currentTime) {
-    // Ensure textures are loaded and renderer is valid before attempting to draw
-    if (gCoinTextures.empty() || renderer == nullptr) {
-        // std::cerr << "Cannot draw coin: textures not loaded or renderer invalid." << std::endl;
-        return;
-    }
-
+// Picks the animation frame for currentTime and where it goes when centered (or pivoted) on (x, y)
+void getCoinFrame(const CoinSystem& coins, int x, int y, float scale, Uint32 currentTime, int& frame_index, SDL_Rect& dstRect) {
     // Determine the current frame to display based on time
     // This will cycle through frames 0, 1, 2, ..., NUM_COIN_FRAMES-1
-    int frame_index = (currentTime / COIN_ANIMATION_SPEED_MS) % NUM_COIN_FRAMES;
+    frame_index = (currentTime / COIN_ANIMATION_SPEED_MS) % NUM_COIN_FRAMES;
 
-    // Get the texture for the current frame
-    SDL_Texture* currentTexture = gCoinTextures[frame_index];
+    if (coins.sheet) {
+        // Packed frames are anchored at their pivot (the frame's center unless the packer was told otherwise)
+        dstRect = getSpriteFramePlacement(coins.sheet, frame_index, x, y, scale);
+        return;
+    }
 
-    // Query the original dimensions of the texture to calculate scaled dimensions
+    // Query the original dimensions of the frame to calculate scaled dimensions
     int originalWidth, originalHeight;
-    SDL_QueryTexture(currentTexture, NULL, NULL, &originalWidth, &originalHeight);
+    SDL_QueryTexture(coins.textures[frame_index], NULL, NULL, &originalWidth, &originalHeight);
 
     // Calculate the scaled width and height for drawing
     int scaledWidth = static_cast<int>(originalWidth * scale);
@@ -65,43 +147,104 @@ void draw_Coin(int x, int y, float scale, SDL_Renderer* renderer, Uint32 current
 
     // Define the destination rectangle on the screen.
     // We center the coin around the provided (x,y) coordinates.
-    SDL_Rect dstRect = { x - scaledWidth / 2, y - scaledHeight / 2, scaledWidth, scaledHeight };
+    dstRect = { x - scaledWidth / 2, y - scaledHeight / 2, scaledWidth, scaledHeight };
+}
+
+// Draws an animated coin at the given position and scale.
+void draw_Coin(CoinSystem& coins, int x, int y, float scale, SDL_Renderer* renderer, Uint32 currentTime) {
+    // Ensure textures are loaded and renderer is valid before attempting to draw
+    if ((coins.textures.empty() && coins.sheet == nullptr) || renderer == nullptr) {
+        // std::cerr << "Cannot draw coin: textures not loaded or renderer invalid." << std::endl;
+        return;
+    }
+
+    int frame_index;
+    SDL_Rect dstRect;
+    getCoinFrame(coins, x, y, scale, currentTime, frame_index, dstRect);
+    SDL_Texture* currentTexture = coins.sheet ? nullptr : coins.textures[frame_index];
 
     // Render the current frame of the coin animation
-    SDL_RenderCopy(renderer, currentTexture, NULL, &dstRect);
+    if (coins.softwareTarget) {
+        if (prepareCoinRleFrames(coins, scale)) {
+            // Draw everything queued so far first, so the coin lands on top of it
+            SDL_RenderFlush(renderer);
+            if (blitRleSprite(coins.rleFrames[frame_index], coins.softwareTarget, dstRect.x, dstRect.y)) {
+                return;
+            }
+        }
+        // Frames missing or an unusual surface format: stay on the renderer from now on
+        std::cerr << "Coin RLE blits unavailable; drawing coins through the renderer." << std::endl;
+        setCoinSoftwareTarget(coins, nullptr);
+    }
+    if (coins.sheet) {
+        drawSpriteFrame(renderer, coins.sheet, frame_index, dstRect); // Same pixels, minus the transparent border
+    }
+    else {
+        SDL_RenderCopy(renderer, currentTexture, NULL, &dstRect);
+    }
+}
+
+// Queues the same frame draw_Coin would draw (never as an RLE blit)
+void queueCoin(const CoinSystem& coins, RenderQueue& queue, Uint8 layer, int x, int y, float scale, Uint32 currentTime) {
+    if (coins.textures.empty() && coins.sheet == nullptr) {
+        return;
+    }
+    int frame_index;
+    SDL_Rect dstRect;
+    getCoinFrame(coins, x, y, scale, currentTime, frame_index, dstRect);
+    if (coins.sheet) {
+        SDL_Rect src;
+        SDL_FRect dst;
+        if (getSpriteFrameRects(coins.sheet, frame_index, dstRect, src, dst)) {
+            queueTexture(queue, layer, coins.sheet->texture, &src, dst); // Every frame shares the atlas, so all coins batch
+        }
+    }
+    else {
+        SDL_FRect dst = { static_cast<float>(dstRect.x), static_cast<float>(dstRect.y), static_cast<float>(dstRect.w), static_cast<float>(dstRect.h) };
+        queueTexture(queue, layer, coins.textures[frame_index], nullptr, dst);
+    }
 }
 
 // Returns the effective rendered width of a coin, taking into account the scale.
-// Uses the first loaded texture's dimensions as a reference.
-int getCoinRenderedWidth(float scale) {
-    if (gCoinTextures.empty()) {
+// Uses the first frame's dimensions as a reference.
+int getCoinRenderedWidth(const CoinSystem& coins, float scale) {
+    if (coins.sheet) {
+        return static_cast<int>(coins.sheet->frames[0].sourceW * scale);
+    }
+    if (coins.textures.empty()) {
         // If textures aren't loaded, return a default width to avoid issues in collision
         return static_cast<int>(DEFAULT_COIN_FRAME_WIDTH * scale);
     }
     int originalWidth, originalHeight;
-    SDL_QueryTexture(gCoinTextures[0], NULL, NULL, &originalWidth, &originalHeight);
+    SDL_QueryTexture(coins.textures[0], NULL, NULL, &originalWidth, &originalHeight);
     return static_cast<int>(originalWidth * scale);
 }
 
 // Returns the effective rendered height of a coin, taking into account the scale.
-// Uses the first loaded texture's dimensions as a reference.
-int getCoinRenderedHeight(float scale) {
-    if (gCoinTextures.empty()) {
+// Uses the first frame's dimensions as a reference.
+int getCoinRenderedHeight(const CoinSystem& coins, float scale) {
+    if (coins.sheet) {
+        return static_cast<int>(coins.sheet->frames[0].sourceH * scale);
+    }
+    if (coins.textures.empty()) {
         // If textures aren't loaded, return a default height to avoid issues in collision
         return static_cast<int>(DEFAULT_COIN_FRAME_HEIGHT * scale);
     }
     int originalWidth, originalHeight;
-    SDL_QueryTexture(gCoinTextures[0], NULL, NULL, &originalWidth, &originalHeight);
+    SDL_QueryTexture(coins.textures[0], NULL, NULL, &originalWidth, &originalHeight);
     return static_cast<int>(originalHeight * scale);
 }
 
-// Cleans up all loaded coin textures by destroying them and clearing the vector.
-void closeCoinSystem() {
-    for (SDL_Texture* texture : gCoinTextures) {
+// Cleans up all loaded coin textures by destroying them and clearing the vectors.
+void closeCoinSystem(CoinSystem& coins) {
+    for (SDL_Texture* texture : coins.textures) {
         if (texture) {
             SDL_DestroyTexture(texture);
         }
     }
-    gCoinTextures.clear(); // Ensure the vector is empty after freeing textures
+    coins.textures.clear(); // Ensure the vector is empty after freeing textures
+    freeSpriteSheet(coins.sheet);
+    coins.sheet = nullptr;
+    freeCoinRleFrames(coins);
     std::cout << "Coin system textures cleaned up." << std::endl;
 }
\ No newline at end of file
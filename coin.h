@@ -5,15 +5,41 @@
 #include <SDL.h>
 #include <vector>   
 #include <string>   
+#include "render_queue.h"
 
-bool initCoinSystem(SDL_Renderer* renderer);
+struct SpriteSheet;
+struct RleSprite;
 
-void draw_Coin(int x, int y, float scale, SDL_Renderer* renderer, Uint32 currentTime);
+// Coin animation frames. Owned by the engine and shared by every match drawn
+// with the same renderer.
+struct CoinSystem {
+    std::vector<SDL_Texture*> textures; // One texture per frame
+    SpriteSheet* sheet = nullptr;       // All frames trimmed and packed into one texture; used instead of textures when present
 
-int getCoinRenderedWidth(float scale);
+    // Software rendering: coins are blitted as RLE sprites straight into this surface
+    SDL_Surface* softwareTarget = nullptr;
+    std::vector<SDL_Surface*> surfaces; // Source frames, kept to re-encode at a new size
+    std::vector<RleSprite*> rleFrames;  // Each frame encoded at its own size times rleScale
+    float rleScale = 0.0f;
+};
 
-int getCoinRenderedHeight(float scale);
+bool initCoinSystem(CoinSystem& coins, SDL_Renderer* renderer);
 
-void closeCoinSystem();
+void draw_Coin(CoinSystem& coins, int x, int y, float scale, SDL_Renderer* renderer, Uint32 currentTime);
+
+// Queues the frame draw_Coin would draw. Ignores the software target: the
+// caller draws coins with draw_Coin instead when one is set.
+void queueCoin(const CoinSystem& coins, RenderQueue& queue, Uint8 layer, int x, int y, float scale, Uint32 currentTime);
+
+int getCoinRenderedWidth(const CoinSystem& coins, float scale);
+
+int getCoinRenderedHeight(const CoinSystem& coins, float scale);
+
+void closeCoinSystem(CoinSystem& coins);
+
+// With a software renderer, pass the surface it draws into: coins are then
+// blitted into it directly as run-length encoded sprites, skipping their
+// transparent pixels. Pass nullptr to go back to drawing through the renderer.
+void setCoinSoftwareTarget(CoinSystem& coins, SDL_Surface* target);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,219 @@
+#pragma once
+#ifndef FIXEDMATH_H
+#define FIXEDMATH_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Deterministic fixed-point math.
+//
+// Fixed is a Q16.16 number stored in an int32_t. Every operation is plain
+// integer arithmetic, and trig comes from a lookup table, so results are
+// bit-identical on every compiler and instruction set. Lockstep peers and
+// replays cannot drift apart the way float sqrt/sin/cos can.
+//
+// Angles are integer steps of a full turn (FIXED_ANGLE_STEPS per 360 degrees).
+//
+// The simulation uses the Scalar type and the scalar* helpers at the bottom
+// of this file. Compare squared distances with scalarLengthSquared and
+// scalarSquared rather than by multiplying Scalars, which overflows in Fixed. Build with PONG_FIXED_POINT defined to switch Scalar from
+// float to Fixed.
+
+const int FIXED_SHIFT = 16;
+const int32_t FIXED_ONE = 1 << FIXED_SHIFT;
+const uint32_t FIXED_ANGLE_STEPS = 1024;
+
+struct Fixed {
+    int32_t raw;
+
+    constexpr Fixed() : raw(0) {}
+    constexpr Fixed(int value) : raw(static_cast<int32_t>(static_cast<uint32_t>(value) << FIXED_SHIFT)) {}
+
+    static constexpr Fixed fromRaw(int32_t raw) {
+        Fixed result;
+        result.raw = raw;
+        return result;
+    }
+
+    // Only for constants and config values; never call it on simulation results
+    static Fixed fromFloat(float value) {
+        return fromRaw(static_cast<int32_t>(std::lround(value * FIXED_ONE)));
+    }
+
+    float toFloat() const { return static_cast<float>(raw) / FIXED_ONE; }
+
+    // Truncates toward zero, like static_cast<int>(float)
+    int toInt() const { return raw >= 0 ? raw >> FIXED_SHIFT : -((-raw) >> FIXED_SHIFT); }
+
+    Fixed& operator+=(Fixed other) { raw += other.raw; return *this; }
+    Fixed& operator-=(Fixed other) { raw -= other.raw; return *this; }
+    Fixed& operator*=(Fixed other) { *this = *this * other; return *this; }
+    Fixed& operator/=(Fixed other) { *this = *this / other; return *this; }
+
+    friend constexpr Fixed operator+(Fixed a, Fixed b) { return fromRaw(a.raw + b.raw); }
+    friend constexpr Fixed operator-(Fixed a, Fixed b) { return fromRaw(a.raw - b.raw); }
+    friend constexpr Fixed operator-(Fixed a) { return fromRaw(-a.raw); }
+    friend constexpr Fixed operator*(Fixed a, Fixed b) {
+        return fromRaw(static_cast<int32_t>((static_cast<int64_t>(a.raw) * b.raw) >> FIXED_SHIFT));
+    }
+    friend constexpr Fixed operator/(Fixed a, Fixed b) {
+        return fromRaw(static_cast<int32_t>((static_cast<int64_t>(a.raw) * FIXED_ONE) / b.raw));
+    }
+
+    friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+    friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+    friend constexpr bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+    friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+    friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+};
+
+// Arrays of Fixed are plain int32 lanes, so vectorized code can load and store them directly
+static_assert(sizeof(Fixed) == sizeof(int32_t), "Fixed must stay a bare int32_t");
+
+// x * x + y * y as a raw Q32.32 value. Fixed multiplication shifts the
+// product back into Q16.16, which overflows for lengths of 182 and more;
+// here each square is below 2^62, so the sum always fits.
+constexpr uint64_t fixedLengthSquaredRaw(Fixed x, Fixed y) {
+    return static_cast<uint64_t>(static_cast<int64_t>(x.raw) * x.raw) + static_cast<uint64_t>(static_cast<int64_t>(y.raw) * y.raw);
+}
+
+inline Fixed fixedAbs(Fixed value) {
+    return value.raw < 0 ? -value : value;
+}
+
+// Integer square root (floor) of a 64-bit value, one result bit per iteration
+inline uint64_t isqrt64(uint64_t value) {
+    uint64_t result = 0;
+    uint64_t bit = 1ull << 62;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+inline Fixed fixedSqrt(Fixed value) {
+    if (value.raw <= 0) {
+        return Fixed();
+    }
+    // sqrt(raw / 2^16) * 2^16 == sqrt(raw * 2^16)
+    return Fixed::fromRaw(static_cast<int32_t>(isqrt64(static_cast<uint64_t>(value.raw) << FIXED_SHIFT)));
+}
+
+// Quarter-wave sine table: round(sin(i * 2*PI / FIXED_ANGLE_STEPS) * 65536) for i = 0..256.
+// Precomputed rather than generated at startup so no libm is involved at all.
+inline const int32_t FIXED_SIN_TABLE[FIXED_ANGLE_STEPS / 4 + 1] = {
+    0, 402, 804, 1206, 1608, 2010, 2412, 2814,
+    3216, 3617, 4019, 4420, 4821, 5222, 5623, 6023,
+    6424, 6824, 7224, 7623, 8022, 8421, 8820, 9218,
+    9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391,
+    12785, 13180, 13573, 13966, 14359, 14751, 15143, 15534,
+    15924, 16314, 16703, 17091, 17479, 17867, 18253, 18639,
+    19024, 19409, 19792, 20175, 20557, 20939, 21320, 21699,
+    22078, 22457, 22834, 23210, 23586, 23961, 24335, 24708,
+    25080, 25451, 25821, 26190, 26558, 26925, 27291, 27656,
+    28020, 28383, 28745, 29106, 29466, 29824, 30182, 30538,
+    30893, 31248, 31600, 31952, 32303, 32652, 33000, 33347,
+    33692, 34037, 34380, 34721, 35062, 35401, 35738, 36075,
+    36410, 36744, 37076, 37407, 37736, 38064, 38391, 38716,
+    39040, 39362, 39683, 40002, 40320, 40636, 40951, 41264,
+    41576, 41886, 42194, 42501, 42806, 43110, 43412, 43713,
+    44011, 44308, 44604, 44898, 45190, 45480, 45769, 46056,
+    46341, 46624, 46906, 47186, 47464, 47741, 48015, 48288,
+    48559, 48828, 49095, 49361, 49624, 49886, 50146, 50404,
+    50660, 50914, 51166, 51417, 51665, 51911, 52156, 52398,
+    52639, 52878, 53114, 53349, 53581, 53812, 54040, 54267,
+    54491, 54714, 54934, 55152, 55368, 55582, 55794, 56004,
+    56212, 56418, 56621, 56823, 57022, 57219, 57414, 57607,
+    57798, 57986, 58172, 58356, 58538, 58718, 58896, 59071,
+    59244, 59415, 59583, 59750, 59914, 60075, 60235, 60392,
+    60547, 60700, 60851, 60999, 61145, 61288, 61429, 61568,
+    61705, 61839, 61971, 62101, 62228, 62353, 62476, 62596,
+    62714, 62830, 62943, 63054, 63162, 63268, 63372, 63473,
+    63572, 63668, 63763, 63854, 63944, 64031, 64115, 64197,
+    64277, 64354, 64429, 64501, 64571, 64639, 64704, 64766,
+    64827, 64884, 64940, 64993, 65043, 65091, 65137, 65180,
+    65220, 65259, 65294, 65328, 65358, 65387, 65413, 65436,
+    65457, 65476, 65492, 65505, 65516, 65525, 65531, 65535,
+    65536,
+};
+
+inline Fixed fixedSin(uint32_t angle) {
+    const uint32_t quarter = FIXED_ANGLE_STEPS / 4;
+    angle %= FIXED_ANGLE_STEPS;
+    uint32_t index = angle % quarter;
+    switch (angle / quarter) {
+    case 0: return Fixed::fromRaw(FIXED_SIN_TABLE[index]);
+    case 1: return Fixed::fromRaw(FIXED_SIN_TABLE[quarter - index]);
+    case 2: return Fixed::fromRaw(-FIXED_SIN_TABLE[index]);
+    default: return Fixed::fromRaw(-FIXED_SIN_TABLE[quarter - index]);
+    }
+}
+
+inline Fixed fixedCos(uint32_t angle) {
+    return fixedSin(angle + FIXED_ANGLE_STEPS / 4);
+}
+
+// --- Simulation Scalar ---
+// The same game code compiles against either backend.
+
+#ifdef PONG_FIXED_POINT
+
+typedef Fixed Scalar;
+typedef uint64_t ScalarSquared; // Squared lengths, Q32.32 (see fixedLengthSquaredRaw)
+
+inline Scalar scalarFromFloat(float value) { return Fixed::fromFloat(value); }
+inline float scalarToFloat(Scalar value) { return value.toFloat(); }
+inline int scalarToInt(Scalar value) { return value.toInt(); }
+inline uint32_t scalarToBits(Scalar value) { return static_cast<uint32_t>(value.raw); }
+inline Scalar scalarFromBits(uint32_t bits) { return Fixed::fromRaw(static_cast<int32_t>(bits)); }
+inline Scalar scalarAbs(Scalar value) { return fixedAbs(value); }
+inline Scalar scalarSqrt(Scalar value) { return fixedSqrt(value); }
+inline Scalar scalarSin(uint32_t angle) { return fixedSin(angle); }
+inline Scalar scalarCos(uint32_t angle) { return fixedCos(angle); }
+constexpr ScalarSquared scalarLengthSquared(Scalar x, Scalar y) { return fixedLengthSquaredRaw(x, y); }
+constexpr ScalarSquared scalarSquared(int value) { return static_cast<uint64_t>(static_cast<int64_t>(value) * value) << (2 * FIXED_SHIFT); }
+
+#else
+
+typedef float Scalar;
+typedef float ScalarSquared;
+
+inline Scalar scalarFromFloat(float value) { return value; }
+inline float scalarToFloat(Scalar value) { return value; }
+inline int scalarToInt(Scalar value) { return static_cast<int>(value); }
+inline uint32_t scalarToBits(Scalar value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+inline Scalar scalarFromBits(uint32_t bits) {
+    Scalar value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+inline Scalar scalarAbs(Scalar value) { return std::abs(value); }
+inline Scalar scalarSqrt(Scalar value) { return std::sqrt(value); }
+inline Scalar scalarSin(uint32_t angle) {
+    return std::sin(static_cast<float>(angle) * 2.0f * 3.14159265f / FIXED_ANGLE_STEPS);
+}
+inline Scalar scalarCos(uint32_t angle) {
+    return std::cos(static_cast<float>(angle) * 2.0f * 3.14159265f / FIXED_ANGLE_STEPS);
+}
+constexpr ScalarSquared scalarLengthSquared(Scalar x, Scalar y) { return x * x + y * y; }
+constexpr ScalarSquared scalarSquared(int value) { return static_cast<float>(value * value); }
+
+#endif
+
+#endif
@@ -0,0 +1,287 @@
+#include "font_atlas.h"
+#include "mapped_file.h"
+#include <cmath>    // For floor/ceil
+#include <cstring>  // For memcpy
+#include <iostream> // For error output
+
+namespace {
+
+const float MAX_TEXT_SCALE = 8.0f; // Resolved textures grow with the square of the scale
+
+const FontAtlasGlyph* findGlyph(const FontAtlas* atlas, unsigned char c) {
+    if (c >= 128 || atlas->asciiIndex[c] < 0) {
+        return nullptr;
+    }
+    return &atlas->glyphs[atlas->asciiIndex[c]];
+}
+
+int kerningAdjust(const FontAtlas* atlas, Uint16 left, Uint16 right) {
+    for (const FontAtlasKerning& pair : atlas->kerning) {
+        if (pair.left == left && pair.right == right) {
+            return pair.adjust;
+        }
+    }
+    return 0;
+}
+
+// Coverage (0-255) becomes white with alpha, so SDL_SetTextureColorMod gives any text color
+SDL_Texture* createCoverageTexture(SDL_Renderer* renderer, const Uint8* coverage, int width, int height) {
+    SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, width, height);
+    if (texture == nullptr) {
+        std::cerr << "Failed to create font atlas texture! SDL_Error: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+    std::vector<Uint32> pixels(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = (static_cast<Uint32>(coverage[i]) << 24) | 0x00FFFFFFu;
+    }
+    SDL_UpdateTexture(texture, nullptr, pixels.data(), width * static_cast<int>(sizeof(Uint32)));
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    return texture;
+}
+
+// Bilinear sample of the distance field, in atlas pixels
+float sampleDistance(const FontAtlas* atlas, float x, float y) {
+    x = x < 0.0f ? 0.0f : (x > atlas->width - 1.0f ? atlas->width - 1.0f : x);
+    y = y < 0.0f ? 0.0f : (y > atlas->height - 1.0f ? atlas->height - 1.0f : y);
+    int x0 = static_cast<int>(x);
+    int y0 = static_cast<int>(y);
+    int x1 = x0 + 1 < atlas->width ? x0 + 1 : x0;
+    int y1 = y0 + 1 < atlas->height ? y0 + 1 : y0;
+    float fx = x - x0;
+    float fy = y - y0;
+    const Uint8* d = atlas->distances.data();
+    float top = d[y0 * atlas->width + x0] + (d[y0 * atlas->width + x1] - d[y0 * atlas->width + x0]) * fx;
+    float bottom = d[y1 * atlas->width + x0] + (d[y1 * atlas->width + x1] - d[y1 * atlas->width + x0]) * fx;
+    return top + (bottom - top) * fy;
+}
+
+// CPU SDF resolve: turns the distance field into coverage at one scale. The
+// edge gets one output pixel of antialiasing whatever the scale.
+SDL_Texture* resolveSdf(SDL_Renderer* renderer, const FontAtlas* atlas, float scale) {
+    int width = static_cast<int>(std::ceil(atlas->width * scale));
+    int height = static_cast<int>(std::ceil(atlas->height * scale));
+    std::vector<Uint8> coverage(static_cast<size_t>(width) * height);
+    // Distance values are 0-255 with 128 on the outline and +-127 spanning distanceRange atlas pixels
+    float toOutputPixels = atlas->distanceRange / 127.0f * scale;
+    for (int y = 0; y < height; ++y) {
+        float sourceY = (y + 0.5f) / scale - 0.5f;
+        for (int x = 0; x < width; ++x) {
+            float sourceX = (x + 0.5f) / scale - 0.5f;
+            float distance = (sampleDistance(atlas, sourceX, sourceY) - 128.0f) * toOutputPixels;
+            float alpha = distance + 0.5f;
+            alpha = alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+            coverage[static_cast<size_t>(y) * width + x] = static_cast<Uint8>(alpha * 255.0f + 0.5f);
+        }
+    }
+    return createCoverageTexture(renderer, coverage.data(), width, height);
+}
+
+// The coverage texture to draw pointSize text with, resolving and caching it if needed
+SDL_Texture* textureForSize(SDL_Renderer* renderer, FontAtlas* atlas, float pointSize) {
+    if (!atlas->sdf) {
+        return atlas->texture;
+    }
+    atlas->drawCounter++;
+    for (FontAtlasResolvedSize& size : atlas->resolved) {
+        if (size.renderer == renderer && size.pointSize == pointSize) {
+            size.lastUsed = atlas->drawCounter;
+            return size.texture;
+        }
+    }
+
+    SDL_Texture* texture = resolveSdf(renderer, atlas, pointSize / atlas->pointSize);
+    if (texture == nullptr) {
+        return nullptr;
+    }
+    if (atlas->resolved.size() >= static_cast<size_t>(MAX_RESOLVED_FONT_SIZES)) {
+        // Evict the size drawn least recently (e.g. a menu title no longer on screen)
+        size_t oldest = 0;
+        for (size_t i = 1; i < atlas->resolved.size(); ++i) {
+            if (atlas->resolved[i].lastUsed < atlas->resolved[oldest].lastUsed) {
+                oldest = i;
+            }
+        }
+        SDL_DestroyTexture(atlas->resolved[oldest].texture);
+        atlas->resolved.erase(atlas->resolved.begin() + oldest);
+    }
+    atlas->resolved.push_back({ renderer, pointSize, texture, atlas->drawCounter });
+    return texture;
+}
+
+} // namespace
+
+FontAtlas* loadFontAtlas(SDL_Renderer* renderer, const char* path) {
+    MappedFile file;
+    if (!mapFile(path, file)) {
+        return nullptr;
+    }
+
+    FontAtlasHeader header;
+    if (file.size < sizeof(header)) {
+        std::cerr << "Font atlas " << path << " is truncated!" << std::endl;
+        unmapFile(file);
+        return nullptr;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    size_t glyphBytes = sizeof(FontAtlasGlyph) * header.glyphCount;
+    size_t kerningBytes = sizeof(FontAtlasKerning) * header.kerningCount;
+    size_t pixelBytes = static_cast<size_t>(header.atlasWidth) * header.atlasHeight;
+    if (header.magic != FONT_ATLAS_MAGIC || header.version != FONT_ATLAS_VERSION) {
+        std::cerr << "Font atlas " << path << " has the wrong format or version; rebuild it with font_atlas_builder." << std::endl;
+        unmapFile(file);
+        return nullptr;
+    }
+    if (file.size < sizeof(header) + glyphBytes + kerningBytes + pixelBytes) {
+        std::cerr << "Font atlas " << path << " is truncated!" << std::endl;
+        unmapFile(file);
+        return nullptr;
+    }
+    if (header.pointSize == 0) {
+        std::cerr << "Font atlas " << path << " has no point size!" << std::endl;
+        unmapFile(file);
+        return nullptr;
+    }
+    // Glyph rects are used as texture coordinates and to sample the distance field
+    for (Uint16 i = 0; i < header.glyphCount; ++i) {
+        FontAtlasGlyph glyph;
+        memcpy(&glyph, file.data + sizeof(header) + i * sizeof(FontAtlasGlyph), sizeof(glyph));
+        if (glyph.x + glyph.w > header.atlasWidth || glyph.y + glyph.h > header.atlasHeight) {
+            std::cerr << "Font atlas " << path << ": glyph " << glyph.codepoint << " (" << glyph.x << ", " << glyph.y << ", "
+                      << glyph.w << "x" << glyph.h << ") lies outside the " << header.atlasWidth << "x" << header.atlasHeight
+                      << " page!" << std::endl;
+            unmapFile(file);
+            return nullptr;
+        }
+    }
+
+    FontAtlas* atlas = new FontAtlas;
+    atlas->texture = nullptr;
+    atlas->pointSize = header.pointSize;
+    atlas->lineHeight = header.lineHeight;
+    atlas->ascent = header.ascent;
+    atlas->width = header.atlasWidth;
+    atlas->height = header.atlasHeight;
+    atlas->sdf = (header.flags & FONT_ATLAS_FLAG_SDF) != 0;
+    atlas->distanceRange = header.distanceRange;
+    atlas->drawCounter = 0;
+    const Uint8* p = file.data + sizeof(header);
+    atlas->glyphs.resize(header.glyphCount);
+    memcpy(atlas->glyphs.data(), p, glyphBytes);
+    p += glyphBytes;
+    atlas->kerning.resize(header.kerningCount);
+    memcpy(atlas->kerning.data(), p, kerningBytes);
+    p += kerningBytes;
+
+    for (short& index : atlas->asciiIndex) {
+        index = -1;
+    }
+    for (size_t i = 0; i < atlas->glyphs.size(); ++i) {
+        if (atlas->glyphs[i].codepoint < 128) {
+            atlas->asciiIndex[atlas->glyphs[i].codepoint] = static_cast<short>(i);
+        }
+    }
+
+    if (atlas->sdf) {
+        // Sizes are resolved on first use
+        atlas->distances.assign(p, p + pixelBytes);
+        unmapFile(file);
+        return atlas;
+    }
+    atlas->texture = createCoverageTexture(renderer, p, header.atlasWidth, header.atlasHeight);
+    unmapFile(file); // Everything needed is now in the texture and glyph table
+    if (atlas->texture == nullptr) {
+        delete atlas;
+        return nullptr;
+    }
+    return atlas;
+}
+
+void freeFontAtlas(FontAtlas* atlas) {
+    if (atlas) {
+        if (atlas->texture) {
+            SDL_DestroyTexture(atlas->texture);
+        }
+        for (FontAtlasResolvedSize& size : atlas->resolved) {
+            SDL_DestroyTexture(size.texture);
+        }
+        delete atlas;
+    }
+}
+
+void drawAtlasText(SDL_Renderer* renderer, FontAtlas* atlas, const std::string& text, int x, int y, SDL_Color color) {
+    drawAtlasTextScaled(renderer, atlas, text, x, y, static_cast<float>(atlas->pointSize), color);
+}
+
+void drawAtlasTextScaled(SDL_Renderer* renderer, FontAtlas* atlas, const std::string& text, int x, int y, float pointSize, SDL_Color color) {
+    float scale = pointSize / atlas->pointSize;
+    if (scale <= 0.0f || scale > MAX_TEXT_SCALE) {
+        return;
+    }
+    SDL_Texture* texture = textureForSize(renderer, atlas, pointSize);
+    if (texture == nullptr) {
+        return;
+    }
+
+    // One quad per glyph, all submitted in a single geometry call. UVs are
+    // normalized, so they address any resolved size of the atlas alike.
+    std::vector<SDL_Vertex>& vertices = atlas->vertices;
+    std::vector<int>& indices = atlas->indices;
+    vertices.clear();
+    indices.clear();
+    float inverseWidth = 1.0f / atlas->width;
+    float inverseHeight = 1.0f / atlas->height;
+    float penX = 0.0f;
+    const FontAtlasGlyph* previous = nullptr;
+    for (char c : text) {
+        const FontAtlasGlyph* glyph = findGlyph(atlas, static_cast<unsigned char>(c));
+        if (glyph == nullptr) {
+            continue;
+        }
+        if (previous) {
+            penX += kerningAdjust(atlas, previous->codepoint, glyph->codepoint);
+        }
+        if (glyph->w > 0 && glyph->h > 0) {
+            // Snap quads to whole pixels so the resolved coverage maps 1:1 onto the screen
+            float left = std::floor(x + (penX + glyph->offsetX) * scale + 0.5f);
+            float top = std::floor(y + glyph->offsetY * scale + 0.5f);
+            float right = left + glyph->w * scale;
+            float bottom = top + glyph->h * scale;
+            float u0 = glyph->x * inverseWidth;
+            float v0 = glyph->y * inverseHeight;
+            float u1 = (glyph->x + glyph->w) * inverseWidth;
+            float v1 = (glyph->y + glyph->h) * inverseHeight;
+
+            int base = static_cast<int>(vertices.size());
+            vertices.push_back({ { left, top }, color, { u0, v0 } });
+            vertices.push_back({ { right, top }, color, { u1, v0 } });
+            vertices.push_back({ { right, bottom }, color, { u1, v1 } });
+            vertices.push_back({ { left, bottom }, color, { u0, v1 } });
+            int quad[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+        penX += glyph->advance;
+        previous = glyph;
+    }
+    if (!indices.empty()) {
+        SDL_RenderGeometry(renderer, texture, vertices.data(), static_cast<int>(vertices.size()),
+                           indices.data(), static_cast<int>(indices.size()));
+    }
+}
+
+int measureAtlasText(const FontAtlas* atlas, const std::string& text) {
+    int width = 0;
+    const FontAtlasGlyph* previous = nullptr;
+    for (char c : text) {
+        const FontAtlasGlyph* glyph = findGlyph(atlas, static_cast<unsigned char>(c));
+        if (glyph == nullptr) {
+            continue;
+        }
+        if (previous) {
+            width += kerningAdjust(atlas, previous->codepoint, glyph->codepoint);
+        }
+        width += glyph->advance;
+        previous = glyph;
+    }
+    return width;
+}
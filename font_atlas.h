@@ -0,0 +1,110 @@
+#pragma once
+#ifndef FONT_ATLAS_H
+#define FONT_ATLAS_H
+
+#include <SDL.h>
+#include <string>
+#include <vector>
+
+// Pre-rasterized bitmap font.
+//
+// font_atlas_builder (a separate build-time tool) renders the handful of
+// glyphs the game draws with SDL_ttf and packs them into a single .fatlas
+// file. At startup the file is memory-mapped and uploaded as one texture, so
+// the game never starts FreeType or rasterizes glyphs at runtime.
+//
+// An atlas built with --sdf stores signed distances instead of coverage
+// (128 = on the outline, distanceRange atlas pixels to either side), so one
+// atlas serves every text size. SDL has no pixel shaders, so each size is
+// resolved to coverage on the CPU the first time it is drawn and kept as its
+// own texture; after that a size costs only the batched quads.
+//
+// File layout (little-endian): FontAtlasHeader, glyphCount FontAtlasGlyph
+// entries sorted by codepoint, kerningCount FontAtlasKerning entries, then
+// atlasWidth * atlasHeight 8-bit coverage (or distance) values.
+
+const Uint32 FONT_ATLAS_MAGIC = 0x4C544146; // "FATL"
+const Uint16 FONT_ATLAS_VERSION = 2;
+const Uint16 FONT_ATLAS_FLAG_SDF = 0x0001;
+
+struct FontAtlasHeader {
+    Uint32 magic;
+    Uint16 version;
+    Uint16 pointSize;
+    Uint16 glyphCount;
+    Uint16 kerningCount;
+    Uint16 atlasWidth;
+    Uint16 atlasHeight;
+    Sint16 lineHeight;
+    Sint16 ascent;
+    Uint16 flags;
+    Uint16 distanceRange; // SDF atlases only
+};
+
+struct FontAtlasGlyph {
+    Uint16 codepoint;
+    Uint16 x, y, w, h; // Rectangle in the atlas
+    Sint16 offsetX;    // From the pen position to the bitmap's left edge
+    Sint16 offsetY;    // From the top of the line to the bitmap's top edge
+    Sint16 advance;
+};
+
+struct FontAtlasKerning {
+    Uint16 left;
+    Uint16 right;
+    Sint16 adjust; // Added to the left glyph's advance
+    Uint16 padding;
+};
+
+static_assert(sizeof(FontAtlasHeader) == 24, "FontAtlasHeader must match the file layout");
+static_assert(sizeof(FontAtlasGlyph) == 16, "FontAtlasGlyph must match the file layout");
+static_assert(sizeof(FontAtlasKerning) == 8, "FontAtlasKerning must match the file layout");
+
+// One text size resolved from an SDF atlas. Textures belong to the renderer
+// they were created on, so a size is cached per renderer.
+struct FontAtlasResolvedSize {
+    SDL_Renderer* renderer;
+    float pointSize;
+    SDL_Texture* texture;
+    Uint32 lastUsed; // For evicting the least recently drawn size
+};
+
+const int MAX_RESOLVED_FONT_SIZES = 4;
+
+struct FontAtlas {
+    SDL_Texture* texture; // Coverage atlas at pointSize; nullptr for SDF atlases
+    int pointSize;
+    int lineHeight;
+    int ascent;
+    int width;
+    int height;
+    bool sdf;
+    float distanceRange;
+    std::vector<Uint8> distances; // SDF atlases keep the field for resolving new sizes
+    std::vector<FontAtlasResolvedSize> resolved;
+    Uint32 drawCounter;
+    std::vector<FontAtlasGlyph> glyphs;
+    std::vector<FontAtlasKerning> kerning;
+    short asciiIndex[128]; // Glyph index per ASCII character, -1 when not in the subset
+    std::vector<SDL_Vertex> vertices; // Reused by every draw, so drawing text does not allocate
+    std::vector<int> indices;
+};
+
+// Maps and uploads an atlas file. Returns nullptr (and prints why) on failure,
+// including glyph rectangles that do not fit on the atlas page.
+FontAtlas* loadFontAtlas(SDL_Renderer* renderer, const char* path);
+
+void freeFontAtlas(FontAtlas* atlas);
+
+// Draws text at the atlas's own size with its line top at (x, y). Characters
+// outside the subset are skipped.
+void drawAtlasText(SDL_Renderer* renderer, FontAtlas* atlas, const std::string& text, int x, int y, SDL_Color color);
+
+// Draws text at any point size as one batch of quads. Crisp at every size for
+// SDF atlases; plain atlases are stretched.
+void drawAtlasTextScaled(SDL_Renderer* renderer, FontAtlas* atlas, const std::string& text, int x, int y, float pointSize, SDL_Color color);
+
+// Width in pixels text would take up at the atlas's own size
+int measureAtlasText(const FontAtlas* atlas, const std::string& text);
+
+#endif
@@ -0,0 +1,287 @@
+// Build-time tool: subsets a TrueType font to the characters the game draws and
+// pre-rasterizes them into a .fatlas file (see font_atlas.h).
+//
+// Not part of the game project; build it as its own console program against
+// SDL2 and SDL2_ttf and rerun it whenever the font, size or text changes:
+//
+//   font_atlas_builder arial.ttf 24 arial_24.fatlas "Player 0123456789:"
+//   font_atlas_builder --sdf arial.ttf 32 arial_sdf.fatlas
+//
+// The character list defaults to the score text. Plain atlases hold one size;
+// with --sdf the glyphs are rendered at SDF_OVERSAMPLE times the point size
+// and stored as signed distance fields that draw well at any size.
+//
+// The game's arial_sdf.fatlas is checked in next to arial.ttf, built by the
+// second command above; commit the new file whenever it is rebuilt.
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include "font_atlas.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* DEFAULT_CHARACTERS = "Player 0123456789:";
+const int ATLAS_WIDTH = 256;
+const int GLYPH_PADDING = 1; // Empty pixels between glyphs so linear filtering never bleeds
+const int SDF_OVERSAMPLE = 4; // Outline resolution relative to the atlas
+const int SDF_RANGE = 4;      // Atlas pixels of distance stored on each side of the outline
+
+struct RasterGlyph {
+    FontAtlasGlyph info;
+    std::vector<Uint8> coverage; // info.w * info.h
+};
+
+// Renders one glyph and crops it to its non-empty pixels
+bool rasterizeGlyph(TTF_Font* font, Uint16 codepoint, RasterGlyph& glyph) {
+    int minX, maxX, minY, maxY, advance;
+    if (TTF_GlyphMetrics(font, codepoint, &minX, &maxX, &minY, &maxY, &advance) != 0) {
+        std::cerr << "No metrics for '" << static_cast<char>(codepoint) << "': " << TTF_GetError() << std::endl;
+        return false;
+    }
+    glyph.info = {};
+    glyph.info.codepoint = codepoint;
+    glyph.info.advance = static_cast<Sint16>(advance);
+    glyph.coverage.clear();
+
+    SDL_Color white = { 255, 255, 255, 255 };
+    SDL_Surface* surface = TTF_RenderGlyph_Blended(font, codepoint, white);
+    if (surface == nullptr) {
+        return true; // Whitespace renders nothing but still advances
+    }
+
+    // Blended glyph surfaces are ARGB8888 with the line top at row 0 and the pen at column 0
+    int left = surface->w, top = surface->h, right = -1, bottom = -1;
+    for (int y = 0; y < surface->h; ++y) {
+        const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(surface->pixels) + y * surface->pitch);
+        for (int x = 0; x < surface->w; ++x) {
+            if (row[x] >> 24) {
+                left = std::min(left, x);
+                right = std::max(right, x);
+                top = std::min(top, y);
+                bottom = std::max(bottom, y);
+            }
+        }
+    }
+    if (right >= left) {
+        glyph.info.w = static_cast<Uint16>(right - left + 1);
+        glyph.info.h = static_cast<Uint16>(bottom - top + 1);
+        glyph.info.offsetX = static_cast<Sint16>(left);
+        glyph.info.offsetY = static_cast<Sint16>(top);
+        glyph.coverage.resize(glyph.info.w * glyph.info.h);
+        for (int y = 0; y < glyph.info.h; ++y) {
+            const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(surface->pixels) + (top + y) * surface->pitch);
+            for (int x = 0; x < glyph.info.w; ++x) {
+                glyph.coverage[y * glyph.info.w + x] = static_cast<Uint8>(row[left + x] >> 24);
+            }
+        }
+    }
+    SDL_FreeSurface(surface);
+    return true;
+}
+
+// Converts a glyph rendered SDF_OVERSAMPLE times too large into a distance field
+// at atlas resolution, SDF_RANGE pixels bigger on every side. Brute force, but
+// this only runs at build time over a few dozen glyphs.
+void makeDistanceField(const RasterGlyph& large, RasterGlyph& glyph) {
+    const int search = SDF_RANGE * SDF_OVERSAMPLE;
+    auto insideAt = [&](int x, int y) {
+        x -= large.info.offsetX;
+        y -= large.info.offsetY;
+        if (x < 0 || y < 0 || x >= large.info.w || y >= large.info.h) {
+            return false;
+        }
+        return large.coverage[y * large.info.w + x] >= 128;
+    };
+
+    int left = static_cast<int>(std::floor(static_cast<float>(large.info.offsetX) / SDF_OVERSAMPLE)) - SDF_RANGE;
+    int top = static_cast<int>(std::floor(static_cast<float>(large.info.offsetY) / SDF_OVERSAMPLE)) - SDF_RANGE;
+    int right = static_cast<int>(std::ceil(static_cast<float>(large.info.offsetX + large.info.w) / SDF_OVERSAMPLE)) + SDF_RANGE;
+    int bottom = static_cast<int>(std::ceil(static_cast<float>(large.info.offsetY + large.info.h) / SDF_OVERSAMPLE)) + SDF_RANGE;
+    glyph.info.offsetX = static_cast<Sint16>(left);
+    glyph.info.offsetY = static_cast<Sint16>(top);
+    glyph.info.w = static_cast<Uint16>(right - left);
+    glyph.info.h = static_cast<Uint16>(bottom - top);
+    glyph.coverage.assign(glyph.info.w * glyph.info.h, 0);
+
+    for (int y = 0; y < glyph.info.h; ++y) {
+        for (int x = 0; x < glyph.info.w; ++x) {
+            // Centre of this atlas pixel in the large rendering
+            int centerX = (left + x) * SDF_OVERSAMPLE + SDF_OVERSAMPLE / 2;
+            int centerY = (top + y) * SDF_OVERSAMPLE + SDF_OVERSAMPLE / 2;
+            bool inside = insideAt(centerX, centerY);
+            int best = search * search;
+            for (int dy = -search; dy <= search; ++dy) {
+                for (int dx = -search; dx <= search; ++dx) {
+                    int distanceSquared = dx * dx + dy * dy;
+                    if (distanceSquared < best && insideAt(centerX + dx, centerY + dy) != inside) {
+                        best = distanceSquared;
+                    }
+                }
+            }
+            float distance = std::sqrt(static_cast<float>(best)) / SDF_OVERSAMPLE; // Atlas pixels
+            float value = 128.0f + (inside ? distance : -distance) / SDF_RANGE * 127.0f;
+            value = value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value);
+            glyph.coverage[y * glyph.info.w + x] = static_cast<Uint8>(value + 0.5f);
+        }
+    }
+}
+
+// Shelf packing, tallest glyphs first. Returns the atlas height (a power of two).
+int packGlyphs(std::vector<RasterGlyph>& glyphs) {
+    std::vector<RasterGlyph*> order;
+    for (RasterGlyph& glyph : glyphs) {
+        order.push_back(&glyph);
+    }
+    std::sort(order.begin(), order.end(), [](const RasterGlyph* a, const RasterGlyph* b) { return a->info.h > b->info.h; });
+
+    int x = GLYPH_PADDING, y = GLYPH_PADDING, shelfHeight = 0;
+    for (RasterGlyph* glyph : order) {
+        if (glyph->info.w == 0) {
+            continue;
+        }
+        if (x + glyph->info.w + GLYPH_PADDING > ATLAS_WIDTH) {
+            x = GLYPH_PADDING;
+            y += shelfHeight + GLYPH_PADDING;
+            shelfHeight = 0;
+        }
+        glyph->info.x = static_cast<Uint16>(x);
+        glyph->info.y = static_cast<Uint16>(y);
+        x += glyph->info.w + GLYPH_PADDING;
+        shelfHeight = std::max(shelfHeight, static_cast<int>(glyph->info.h));
+    }
+    int used = y + shelfHeight + GLYPH_PADDING;
+    int height = 1;
+    while (height < used) {
+        height *= 2;
+    }
+    return height;
+}
+
+} // namespace
+
+int main(int argc, char* args[]) {
+    bool sdf = argc > 1 && std::string(args[1]) == "--sdf";
+    if (sdf) {
+        args++;
+        argc--;
+    }
+    if (argc < 4) {
+        std::cerr << "Usage: font_atlas_builder [--sdf] <font.ttf> <point size> <output.fatlas> [characters]" << std::endl;
+        return 1;
+    }
+    const char* fontPath = args[1];
+    int pointSize = atoi(args[2]);
+    const char* outputPath = args[3];
+    std::string characters = argc > 4 ? args[4] : DEFAULT_CHARACTERS;
+
+    // Subset: each printable ASCII character once, sorted by codepoint
+    std::sort(characters.begin(), characters.end());
+    characters.erase(std::unique(characters.begin(), characters.end()), characters.end());
+    characters.erase(std::remove_if(characters.begin(), characters.end(),
+                                    [](char c) { return static_cast<unsigned char>(c) < 32 || static_cast<unsigned char>(c) >= 127; }),
+                     characters.end());
+
+    if (TTF_Init() == -1) {
+        std::cerr << "SDL_ttf could not initialize! SDL_ttf Error: " << TTF_GetError() << std::endl;
+        return 1;
+    }
+    TTF_Font* font = TTF_OpenFont(fontPath, pointSize);
+    if (font == nullptr) {
+        std::cerr << "Failed to load font! SDL_ttf Error: " << TTF_GetError() << std::endl;
+        TTF_Quit();
+        return 1;
+    }
+    TTF_Font* largeFont = nullptr;
+    if (sdf) {
+        largeFont = TTF_OpenFont(fontPath, pointSize * SDF_OVERSAMPLE);
+        if (largeFont == nullptr) {
+            std::cerr << "Failed to load font! SDL_ttf Error: " << TTF_GetError() << std::endl;
+            TTF_CloseFont(font);
+            TTF_Quit();
+            return 1;
+        }
+    }
+
+    std::vector<RasterGlyph> glyphs;
+    for (char c : characters) {
+        Uint16 codepoint = static_cast<Uint16>(c);
+        if (!TTF_GlyphIsProvided(font, codepoint)) {
+            std::cerr << "Font has no glyph for '" << c << "', skipping." << std::endl;
+            continue;
+        }
+        RasterGlyph glyph;
+        if (!rasterizeGlyph(font, codepoint, glyph)) {
+            continue;
+        }
+        if (sdf) {
+            // Metrics come from the real size, the outline from the large rendering
+            RasterGlyph large;
+            if (!rasterizeGlyph(largeFont, codepoint, large)) {
+                continue;
+            }
+            if (large.info.w > 0) {
+                makeDistanceField(large, glyph);
+            }
+        }
+        glyphs.push_back(glyph);
+    }
+
+    std::vector<FontAtlasKerning> kerning;
+    for (const RasterGlyph& left : glyphs) {
+        for (const RasterGlyph& right : glyphs) {
+            int adjust = TTF_GetFontKerningSizeGlyphs(font, left.info.codepoint, right.info.codepoint);
+            if (adjust != 0) {
+                kerning.push_back({ left.info.codepoint, right.info.codepoint, static_cast<Sint16>(adjust), 0 });
+            }
+        }
+    }
+
+    int atlasHeight = packGlyphs(glyphs);
+    std::vector<Uint8> pixels(static_cast<size_t>(ATLAS_WIDTH) * atlasHeight, 0);
+    for (const RasterGlyph& glyph : glyphs) {
+        for (int y = 0; y < glyph.info.h; ++y) {
+            std::copy(glyph.coverage.begin() + y * glyph.info.w, glyph.coverage.begin() + (y + 1) * glyph.info.w,
+                      pixels.begin() + (glyph.info.y + y) * ATLAS_WIDTH + glyph.info.x);
+        }
+    }
+
+    FontAtlasHeader header = {};
+    header.magic = FONT_ATLAS_MAGIC;
+    header.version = FONT_ATLAS_VERSION;
+    header.pointSize = static_cast<Uint16>(pointSize);
+    header.glyphCount = static_cast<Uint16>(glyphs.size());
+    header.kerningCount = static_cast<Uint16>(kerning.size());
+    header.atlasWidth = ATLAS_WIDTH;
+    header.atlasHeight = static_cast<Uint16>(atlasHeight);
+    header.lineHeight = static_cast<Sint16>(TTF_FontLineSkip(font));
+    header.ascent = static_cast<Sint16>(TTF_FontAscent(font));
+    header.flags = sdf ? FONT_ATLAS_FLAG_SDF : 0;
+    header.distanceRange = sdf ? SDF_RANGE : 0;
+    if (largeFont) {
+        TTF_CloseFont(largeFont);
+    }
+    TTF_CloseFont(font);
+    TTF_Quit();
+
+    std::ofstream out(outputPath, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const RasterGlyph& glyph : glyphs) {
+        out.write(reinterpret_cast<const char*>(&glyph.info), sizeof(glyph.info));
+    }
+    out.write(reinterpret_cast<const char*>(kerning.data()), sizeof(FontAtlasKerning) * kerning.size());
+    out.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+    if (!out) {
+        std::cerr << "Failed to write " << outputPath << "!" << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << outputPath << ": " << glyphs.size() << " glyphs, " << kerning.size() << " kerning pairs, "
+              << ATLAS_WIDTH << "x" << atlasHeight << " atlas." << std::endl;
+    return 0;
+}
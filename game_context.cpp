@@ -0,0 +1,915 @@
+#include "game_context.h"
+#include "replay.h"      // REPLAY_* input bits, shared with lockstep spectators
+#include "sound_synth.h" // Procedurally generated sound effects
+#include <SDL_ttf.h>     // Font fallback when the atlas is missing
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring> // For memcpy, memmove, memset
+#include <iostream>
+
+namespace {
+
+const float COIN_SOUND_GAIN = 0.7f;     // Leaves headroom when many voices overlap
+const float HIT_SOUND_GAIN = 0.6f;
+const float COIN_SOUND_PITCH_VARIATION = 0.05f; // +-5% so repeated hits do not sound identical
+const float HIT_STREAK_PITCH_STEP = 0.12f;      // Each consecutive hit by the same player sounds higher
+
+const float SCORE_TEXT_SIZE = 24.0f; // Point size; any size draws from the same SDF atlas
+const SDL_Color TEXT_COLOR = { 255, 255, 255, 255 }; // White color for text
+
+const SDL_Color BALL_COLOR = { 0xFF, 0x00, 0x00, 0xFF };         // Red ball
+const SDL_Color LEFT_PADDLE_COLOR = { 0x00, 0x00, 0xFF, 0xFF };  // Blue for left paddle
+const SDL_Color RIGHT_PADDLE_COLOR = { 0x00, 0xFF, 0x00, 0xFF }; // Green for right paddle
+
+const uint32_t REMOTE_DUMP_RETRY_MS = 250;    // State requests are plain datagrams; ask again if lost
+const uint32_t REMOTE_DUMP_TIMEOUT_MS = 2000; // The host remembers DESYNC_HISTORY ticks, about 2 s
+
+// Queues a filled circle as one rectangle per row; the fallback without a ball texture
+void queueFilledCircle(RenderQueue& queue, Uint8 layer, int centerX, int centerY, int radius, SDL_Color color) {
+    for (int y = -radius; y <= radius; y++) {
+        int x = static_cast<int>(sqrt(static_cast<float>(radius * radius - y * y)));
+        SDL_FRect row = { static_cast<float>(centerX - x), static_cast<float>(centerY + y), static_cast<float>(2 * x + 1), 1.0f };
+        queueFillRect(queue, layer, row, color);
+    }
+}
+
+SDL_FRect toFRect(const SDL_Rect& rect) {
+    return { static_cast<float>(rect.x), static_cast<float>(rect.y), static_cast<float>(rect.w), static_cast<float>(rect.h) };
+}
+
+// Rasterizes the same circle as queueFilledCircle once, so each ball is drawn as a
+// single textured quad that batches with everything else on the renderer
+SDL_Texture* createCircleTexture(SDL_Renderer* renderer, int radius, Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    int size = 2 * radius + 1;
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, size, size, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (surface == nullptr) {
+        std::cerr << "Failed to create ball surface! SDL_Error: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+    Uint32 color = (static_cast<Uint32>(a) << 24) | (r << 16) | (g << 8) | b;
+    for (int y = -radius; y <= radius; y++) {
+        Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels) + (y + radius) * surface->pitch);
+        int x = static_cast<int>(sqrt(static_cast<float>(radius * radius - y * y)));
+        for (int column = 0; column < size; column++) {
+            row[column] = (column >= radius - x && column <= radius + x) ? color : 0;
+        }
+    }
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    if (texture == nullptr) {
+        std::cerr << "Failed to create ball texture! SDL_Error: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    return texture;
+}
+
+constexpr bool checkCircleRectCollision(Scalar circleX, Scalar circleY, int circleRadius, const SDL_Rect& rect) {
+    Scalar closestX = std::max(Scalar(rect.x), std::min(circleX, Scalar(rect.x + rect.w)));
+    Scalar closestY = std::max(Scalar(rect.y), std::min(circleY, Scalar(rect.y + rect.h)));
+
+    Scalar distanceX = circleX - closestX;
+    Scalar distanceY = circleY - closestY;
+
+    return scalarLengthSquared(distanceX, distanceY) < scalarSquared(circleRadius);
+}
+
+// Far-away balls must miss in both backends (Fixed products overflow from a distance of 182)
+constexpr SDL_Rect TEST_PADDLE = { 0, 0, PADDLE_WIDTH, PADDLE_HEIGHT };
+static_assert(!checkCircleRectCollision(Scalar(PADDLE_WIDTH + 182), Scalar(50), BALL_RADIUS, TEST_PADDLE), "Ball 182 px away must miss");
+static_assert(!checkCircleRectCollision(Scalar(PADDLE_WIDTH + 200), Scalar(PADDLE_HEIGHT + 200), BALL_RADIUS, TEST_PADDLE), "Ball far away diagonally must miss");
+static_assert(!checkCircleRectCollision(Scalar(WINDOW_WIDTH), Scalar(WINDOW_HEIGHT), BALL_RADIUS, TEST_PADDLE), "Ball across the field must miss");
+static_assert(checkCircleRectCollision(Scalar(PADDLE_WIDTH + BALL_RADIUS - 1), Scalar(50), BALL_RADIUS, TEST_PADDLE), "Touching ball must hit");
+
+bool checkRectRectCollision(const SDL_Rect& rect1, const SDL_Rect& rect2) {
+    return SDL_HasIntersection(&rect1, &rect2);
+}
+
+// xorshift32: tiny, fast and identical on every platform (unlike rand())
+uint32_t gameRandom(MatchContext& match) {
+    match.rngState ^= match.rngState << 13;
+    match.rngState ^= match.rngState >> 17;
+    match.rngState ^= match.rngState << 5;
+    return match.rngState;
+}
+
+// Random angle in steps of a full turn (see FIXED_ANGLE_STEPS)
+uint32_t gameRandomAngle(MatchContext& match) {
+    return gameRandom(match) % FIXED_ANGLE_STEPS;
+}
+
+// Points the ball in a random direction that is neither too flat nor too steep (to keep gameplay engaging)
+void serveBallInRandomDirection(MatchContext& match) {
+    uint32_t angle;
+    do {
+        angle = gameRandomAngle(match);
+    } while (scalarAbs(scalarSin(angle)) < MIN_SERVE_COMPONENT || scalarAbs(scalarCos(angle)) < MIN_SERVE_COMPONENT);
+
+    match.ballDX = scalarCos(angle);
+    match.ballDY = scalarSin(angle);
+
+    // Normalize the direction vector to maintain a consistent speed
+    Scalar magnitude = scalarSqrt(match.ballDX * match.ballDX + match.ballDY * match.ballDY);
+    if (magnitude != 0) {
+        match.ballDX /= magnitude;
+        match.ballDY /= magnitude;
+    }
+}
+
+void spawnCoin(MatchContext& match) {
+    // Ensure coin is spawned within bounds and not too close to paddles
+    int coinEffectiveWidth = COIN_COLLISION_WIDTH;
+    int coinEffectiveHeight = COIN_COLLISION_HEIGHT;
+
+    // Random X position: from PADDLE_WIDTH + coinEffectiveWidth/2 to WINDOW_WIDTH - PADDLE_WIDTH - coinEffectiveWidth/2
+    float coin_x = static_cast<float>(gameRandom(match) % (WINDOW_WIDTH - 2 * PADDLE_WIDTH - coinEffectiveWidth) + PADDLE_WIDTH + coinEffectiveWidth / 2);
+    // Random Y position: from coinEffectiveHeight/2 to WINDOW_HEIGHT - coinEffectiveHeight/2
+    float coin_y = static_cast<float>(gameRandom(match) % (WINDOW_HEIGHT - coinEffectiveHeight) + coinEffectiveHeight / 2);
+
+    match.coins.push_back({ coin_x, coin_y, COIN_DURATION_FRAMES, match.nextCoinId++ });
+}
+
+// Plays the paddle hit blip panned towards x, pitched up by the hitter's streak
+void playHitSound(const EngineContext& engine, float x, int streak) {
+    if (engine.hitMixerSound) {
+        float pitch = 1.0f + HIT_STREAK_PITCH_STEP * (streak > 1 ? streak - 1 : 0);
+        playMixerSound(engine.hitMixerSound, HIT_SOUND_GAIN, panFromScreenX(x, WINDOW_WIDTH), pitch);
+    }
+    else if (engine.coinSound) {
+        Mix_PlayChannel(-1, engine.coinSound, 0); // Fallback: the old sample for every event
+    }
+}
+
+// Plays the coin sound panned towards horizontal position x
+void playCoinSound(const EngineContext& engine, float x) {
+    if (engine.coinMixerSound) {
+        // Cosmetic only, so this uses rand() rather than the simulation's generator
+        float pitch = 1.0f + COIN_SOUND_PITCH_VARIATION * (static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f);
+        playMixerSound(engine.coinMixerSound, COIN_SOUND_GAIN, panFromScreenX(x, WINDOW_WIDTH), pitch);
+    }
+    else if (engine.coinSound) {
+        Mix_PlayChannel(-1, engine.coinSound, 0); // Fallback: first available SDL_mixer channel, no panning
+    }
+}
+
+// Queues a sound for the caller of updateMatch; extras in a crowded tick are dropped
+void addMatchSound(MatchSounds& sounds, MatchSoundType type, float x, int streak = 1) {
+    if (sounds.count < MAX_MATCH_SOUNDS) {
+        sounds.sounds[sounds.count++] = { type, x, streak };
+    }
+}
+
+// Spawns a new coin every COIN_APPEAR_INTERVAL_FRAMES frames for as long as the match runs
+Script coinSpawnScript(MatchContext& match) {
+    for (;;) {
+        co_await wait_ticks(COIN_APPEAR_INTERVAL_FRAMES);
+        spawnCoin(match);
+    }
+}
+
+// Keeps the ball boosted for BALL_BOOST_DURATION_FRAMES frames.
+// If another boost starts (or the boost is cancelled) in the meantime, the
+// generation no longer matches and this script leaves the speed alone.
+Script ballBoostScript(MatchContext& match, unsigned int generation) {
+    match.currentBallSpeed = INITIAL_BALL_SPEED * BALL_BOOST_FACTOR; // Apply speed boost
+    co_await wait_ticks(BALL_BOOST_DURATION_FRAMES);
+    if (generation == match.ballBoostGeneration) {
+        match.currentBallSpeed = INITIAL_BALL_SPEED; // Revert to initial speed when the boost expires
+    }
+}
+
+void startBallBoost(MatchContext& match) {
+    match.ballBoostGeneration++;
+    match.scripts.startScript(ballBoostScript(match, match.ballBoostGeneration));
+}
+
+void cancelBallBoost(MatchContext& match) {
+    match.ballBoostGeneration++; // Any running boost script will expire without touching the speed
+    match.currentBallSpeed = INITIAL_BALL_SPEED;
+}
+
+// Puts the ball back in the center with a new serve direction after a point
+void resetBallAfterPoint(MatchContext& match) {
+    // Reset ball to center of the screen
+    match.ballX = Scalar(WINDOW_WIDTH) / 2;
+    match.ballY = Scalar(WINDOW_HEIGHT) / 2;
+    // Set a new random initial direction for the next serve
+    serveBallInRandomDirection(match);
+
+    cancelBallBoost(match); // Reset ball speed and clear any speed boost
+    match.leftConsecutiveHits = 0; // Reset consecutive hit counters
+    match.rightConsecutiveHits = 0;
+    match.lastBallHit = LastHit::None; // Reset last hit
+}
+
+void renderText(const EngineContext& engine, SDL_Renderer* renderer, const std::string& text, int x, int y, SDL_Color color) {
+    if (engine.fontAtlas) {
+        drawAtlasTextScaled(renderer, engine.fontAtlas, text, x, y, SCORE_TEXT_SIZE, color);
+        return;
+    }
+    if (!engine.glyphCache) {
+        std::cerr << "Font not loaded! Cannot render text." << std::endl;
+        return;
+    }
+    drawGlyphCacheText(renderer, engine.glyphCache, text, x, y, color);
+}
+
+// Re-simulates the spectated match from the host's seed and inputs and checks
+// our hash of every tick against the host's. Once that cannot go on (joined
+// after the start, too many packets lost, or desynced) the match mirrors the
+// snapshots like any spectator. After a desync the detector is kept until
+// the host's state of the tick has been dumped (see fetchRemoteDump).
+void followLockstepStream(MatchContext& match, uint32_t nowMs) {
+    thread_local std::vector<SpectatorLockstep> received;
+    received.clear();
+    PongSnapshot snapshot;
+    bool haveSnapshot = match.spectatorClient->receiveLatest(snapshot, nowMs, &received);
+
+    const char* stopReason = nullptr;
+    if (haveSnapshot && received.empty()) {
+        stopReason = "the host does not send state hashes; start it with --desync-check";
+    }
+    for (const SpectatorLockstep& lockstep : received) {
+        if (lockstep.tick > match.gameTick + SPECTATOR_INPUT_HISTORY) {
+            stopReason = match.gameTick == 0 ? "joined after the start of the match" : "too many packets lost";
+            break;
+        }
+        if (match.gameTick == 0) {
+            match.seed = lockstep.seed;
+            match.rngState = lockstep.seed | 1u; // As startMatch; nothing else depends on the seed yet
+        }
+        while (match.gameTick < lockstep.tick) {
+            uint8_t recorded = lockstep.inputs[lockstep.tick - match.gameTick - 1];
+            if (recorded & REPLAY_LAUNCH) {
+                launchBall(match);
+            }
+            updateMatch(match, unpackReplayTick(recorded)); // Records our hash of the tick; spectators stay silent
+        }
+        if (!match.desyncDetector->checkRemoteHash(lockstep.tick, lockstep.hash)) {
+            stopReason = "desynced";
+            break;
+        }
+    }
+    if (stopReason == nullptr) {
+        return;
+    }
+    std::cerr << "Desync check stopped at tick " << match.gameTick << " (" << stopReason << "); mirroring the host instead." << std::endl;
+    if (match.desyncDetector->hasDesynced()) {
+        match.spectatorClient->requestState(match.desyncDetector->firstDesyncTick());
+        match.remoteDumpRequestMs = nowMs;
+        match.remoteDumpDeadlineMs = nowMs + REMOTE_DUMP_TIMEOUT_MS;
+    }
+    else {
+        delete match.desyncDetector;
+        match.desyncDetector = nullptr;
+    }
+    if (haveSnapshot) {
+        applyPongSnapshot(match, snapshot);
+    }
+}
+
+// Mirrors the host while waiting for its state of the desynced tick, then
+// dumps it next to ours and drops the detector
+void fetchRemoteDump(MatchContext& match, uint32_t nowMs) {
+    PongSnapshot snapshot;
+    if (match.spectatorClient->receiveLatest(snapshot, nowMs)) {
+        applyPongSnapshot(match, snapshot);
+    }
+    DesyncDetector* detector = match.desyncDetector;
+    uint32_t tick;
+    const uint8_t* data;
+    size_t size;
+    bool done = false;
+    if (match.spectatorClient->takeRemoteState(tick, data, size) && tick == detector->firstDesyncTick()) {
+        detector->receiveRemoteState(tick, data, size);
+        done = true;
+    }
+    else if (static_cast<int32_t>(nowMs - match.remoteDumpDeadlineMs) >= 0) {
+        std::cerr << "The host did not send its state of tick " << detector->firstDesyncTick() << "; only ours was dumped." << std::endl;
+        done = true;
+    }
+    else if (nowMs - match.remoteDumpRequestMs >= REMOTE_DUMP_RETRY_MS) {
+        match.spectatorClient->requestState(detector->firstDesyncTick());
+        match.remoteDumpRequestMs = nowMs;
+    }
+    if (done) {
+        delete match.desyncDetector;
+        match.desyncDetector = nullptr;
+    }
+}
+
+// Sends spectators that found a desync our state of the tick they ask for
+void answerStateRequests(MatchContext& match) {
+    SpectatorStateRequest request;
+    while (match.broadcaster->takeStateRequest(request)) {
+        const uint8_t* data;
+        size_t size;
+        if (match.desyncDetector && match.desyncDetector->getLocalState(request.tick, data, size)) {
+            match.broadcaster->sendState(request, data, size);
+        }
+    }
+}
+
+} // namespace
+
+// --- Engine ---
+
+bool initEngine(EngineContext& engine, SDL_Renderer* renderer, SDL_Surface* softwareTarget) {
+    engine.renderer = renderer;
+
+    // Initialize the coin system (this will load coin_01.png to coin_08.png)
+    if (!initCoinSystem(engine.coins, renderer)) {
+        std::cerr << "Failed to initialize coin system." << std::endl;
+        return false;
+    }
+    if (softwareTarget) {
+        setCoinSoftwareTarget(engine.coins, softwareTarget); // RLE blits: transparent runs skipped, opaque runs copied
+    }
+
+    // The ball is drawn from a texture when possible; queueFilledCircle is the fallback
+    if (renderer) {
+        engine.ballTexture = createCircleTexture(renderer, BALL_RADIUS, BALL_COLOR.r, BALL_COLOR.g, BALL_COLOR.b, BALL_COLOR.a);
+    }
+
+    // Synthesize the sound effects (no decoding); fall back to the mp3 through SDL_mixer channels
+    if (isAudioMixerActive()) {
+        engine.coinMixerSound = synthesizeSound(COIN_SYNTH, getMixerSampleRate());
+        engine.hitMixerSound = synthesizeSound(PADDLE_HIT_SYNTH, getMixerSampleRate());
+    }
+    else if (Mix_QuerySpec(nullptr, nullptr, nullptr)) { // Offline tools never open an audio device
+        engine.coinSound = Mix_LoadWAV("coin_sound.mp3");
+        if (engine.coinSound == nullptr) {
+            std::cerr << "Failed to load coin_sound.mp3! SDL_mixer Error: " << Mix_GetError() << std::endl;
+            // The game can continue without sound if it fails to load
+        }
+    }
+
+    // Load the pre-rasterized score font; SDL_ttf (FreeType) is only started if the atlas is missing
+    engine.fontAtlas = loadFontAtlas(renderer, FONT_ATLAS_FILE);
+    if (engine.fontAtlas == nullptr) {
+        if (TTF_Init() == -1) {
+            std::cerr << "SDL_ttf could not initialize! SDL_ttf Error: " << TTF_GetError() << std::endl;
+        }
+        else {
+            TTF_Font* font = TTF_OpenFont("arial.ttf", 24); // Make sure "arial.ttf" is accessible, or use your own font file
+            if (font == nullptr) {
+                std::cerr << "Failed to load font! SDL_ttf Error: " << TTF_GetError() << std::endl;
+                // The game can continue without text if font fails to load
+            }
+            else if ((engine.glyphCache = createGlyphCache(renderer, font)) == nullptr) {
+                TTF_CloseFont(font);
+            }
+            else {
+                requestGlyphs(engine.glyphCache, "Player 0123456789:"); // Warm up the score text before the first frame
+            }
+        }
+    }
+    return true;
+}
+
+void closeEngine(EngineContext& engine) {
+    freeGlyphCache(engine.glyphCache); // Stops the rasterizer thread and closes the font
+    engine.glyphCache = nullptr;
+    freeFontAtlas(engine.fontAtlas);
+    engine.fontAtlas = nullptr;
+    closeCoinSystem(engine.coins); // Clean up all coin textures
+    if (engine.ballTexture) {
+        SDL_DestroyTexture(engine.ballTexture);
+        engine.ballTexture = nullptr;
+    }
+    // The audio mixer must already be closed: it may still be playing these
+    freeMixerSound(engine.coinMixerSound);
+    freeMixerSound(engine.hitMixerSound);
+    engine.coinMixerSound = engine.hitMixerSound = nullptr;
+    if (engine.coinSound) {
+        Mix_FreeChunk(engine.coinSound); // Free the loaded sound effect
+        engine.coinSound = nullptr;
+    }
+    engine.renderer = nullptr;
+}
+
+// --- Match ---
+
+MatchContext::MatchContext(const EngineContext* engine)
+    : engine(engine),
+      ballX(Scalar(WINDOW_WIDTH) / 2),
+      ballY(Scalar(WINDOW_HEIGHT) / 2),
+      ballDX(0),
+      ballDY(0),
+      currentBallSpeed(INITIAL_BALL_SPEED),
+      ballBoostGeneration(0),
+      leftPaddle{ 0, (WINDOW_HEIGHT - PADDLE_HEIGHT) / 2, PADDLE_WIDTH, PADDLE_HEIGHT },
+      rightPaddle{ WINDOW_WIDTH - PADDLE_WIDTH, (WINDOW_HEIGHT - PADDLE_HEIGHT) / 2, PADDLE_WIDTH, PADDLE_HEIGHT },
+      nextCoinId(0),
+      leftScore(0),
+      rightScore(0),
+      lastBallHit(LastHit::None),
+      leftConsecutiveHits(0),
+      rightConsecutiveHits(0),
+      rngState(1),
+      gameTick(0),
+      seed(0),
+      recentInputs(),
+      launchedBeforeTick(false),
+      desyncDetector(nullptr),
+      remoteDumpRequestMs(0),
+      remoteDumpDeadlineMs(0),
+      broadcaster(nullptr),
+      spectatorClient(nullptr),
+      broadcastSequence(0) {
+}
+
+void startMatch(MatchContext& match, uint32_t seed) {
+    match.seed = seed;
+    match.rngState = seed | 1u; // xorshift must not start at 0
+
+    // Start the long-running gameplay scripts
+    match.scripts.startScript(coinSpawnScript(match));
+}
+
+void closeMatch(MatchContext& match) {
+    match.scripts.clearScripts(); // Free any suspended scripts
+    delete match.broadcaster; // Closes the socket
+    match.broadcaster = nullptr;
+    delete match.spectatorClient;
+    match.spectatorClient = nullptr;
+    delete match.desyncDetector;
+    match.desyncDetector = nullptr;
+}
+
+void enableDesyncCheck(MatchContext& match) {
+    if (match.desyncDetector == nullptr) {
+        match.desyncDetector = new DesyncDetector(describeCanonicalState);
+    }
+}
+
+bool openMatchBroadcast(MatchContext& match, uint16_t port) {
+    SpectatorBroadcaster* broadcaster = new SpectatorBroadcaster();
+    if (!broadcaster->open(port)) {
+        delete broadcaster;
+        return false;
+    }
+    delete match.broadcaster;
+    match.broadcaster = broadcaster;
+    return true;
+}
+
+bool connectMatchSpectator(MatchContext& match, const char* host, uint16_t port) {
+    SpectatorClient* client = new SpectatorClient();
+    if (!client->connect(host, port)) {
+        delete client;
+        return false;
+    }
+    delete match.spectatorClient;
+    match.spectatorClient = client;
+    return true;
+}
+
+bool isSpectating(const MatchContext& match) {
+    return match.spectatorClient != nullptr && match.spectatorClient->isOpen();
+}
+
+MatchInput readKeyboardInput() {
+    const Uint8* currentKeyStates = SDL_GetKeyboardState(NULL);
+    MatchInput input;
+    input.leftUp = currentKeyStates[SDL_SCANCODE_W] != 0;
+    input.leftDown = currentKeyStates[SDL_SCANCODE_S] != 0;
+    input.rightUp = currentKeyStates[SDL_SCANCODE_UP] != 0;
+    input.rightDown = currentKeyStates[SDL_SCANCODE_DOWN] != 0;
+    return input;
+}
+
+MatchSounds advanceMatch(MatchContext& match, const MatchInput& input, uint32_t nowMs) {
+    if (isSpectating(match)) {
+        if (match.desyncDetector && match.desyncDetector->hasDesynced()) {
+            fetchRemoteDump(match, nowMs);
+            return {};
+        }
+        if (match.desyncDetector) {
+            followLockstepStream(match, nowMs);
+            return {};
+        }
+        // --- Spectating: mirror the host's latest state instead of simulating ---
+        PongSnapshot snapshot;
+        if (match.spectatorClient->receiveLatest(snapshot, nowMs)) {
+            applyPongSnapshot(match, snapshot);
+        }
+        return {};
+    }
+
+    MatchSounds sounds = updateMatch(match, input);
+    memmove(match.recentInputs + 1, match.recentInputs, SPECTATOR_INPUT_HISTORY - 1);
+    match.recentInputs[0] = packReplayTick(input, match.launchedBeforeTick);
+    match.launchedBeforeTick = false;
+
+    // --- Spectator Broadcast ---
+    if (match.broadcaster && match.broadcaster->isOpen()) {
+        PongSnapshot snapshot = capturePongSnapshot(match, match.broadcastSequence++);
+        SpectatorLockstep lockstep;
+        if (match.desyncDetector && match.desyncDetector->getLocalHash(match.gameTick, lockstep.hash)) {
+            lockstep.seed = match.seed;
+            lockstep.tick = match.gameTick;
+            memcpy(lockstep.inputs, match.recentInputs, SPECTATOR_INPUT_HISTORY);
+            match.broadcaster->broadcast(snapshot, nowMs, &lockstep);
+        }
+        else {
+            match.broadcaster->broadcast(snapshot, nowMs);
+        }
+        answerStateRequests(match);
+    }
+    return sounds;
+}
+
+MatchSounds updateMatch(MatchContext& match, const MatchInput& input) {
+    MatchSounds sounds;
+
+    // --- Paddle Movement ---
+    // Left paddle movement (W, S keys)
+    if (input.leftUp) {
+        match.leftPaddle.y -= PADDLE_SPEED;
+    }
+    if (input.leftDown) {
+        match.leftPaddle.y += PADDLE_SPEED;
+    }
+
+    // Right paddle movement (Up, Down arrow keys)
+    if (input.rightUp) {
+        match.rightPaddle.y -= PADDLE_SPEED;
+    }
+    if (input.rightDown) {
+        match.rightPaddle.y += PADDLE_SPEED;
+    }
+
+    // Clamp paddles within vertical bounds of the window
+    if (match.leftPaddle.y < 0) match.leftPaddle.y = 0;
+    if (match.leftPaddle.y + PADDLE_HEIGHT > WINDOW_HEIGHT) match.leftPaddle.y = WINDOW_HEIGHT - PADDLE_HEIGHT;
+
+    if (match.rightPaddle.y < 0) match.rightPaddle.y = 0;
+    if (match.rightPaddle.y + PADDLE_HEIGHT > WINDOW_HEIGHT) match.rightPaddle.y = WINDOW_HEIGHT - PADDLE_HEIGHT;
+
+    // --- Ball Movement ---
+    match.ballX += match.ballDX * match.currentBallSpeed;
+    match.ballY += match.ballDY * match.currentBallSpeed;
+
+    bool reflected_this_frame = false;
+
+    // --- Wall Collisions (top and bottom) ---
+    if (match.ballY + BALL_RADIUS > WINDOW_HEIGHT) {
+        match.ballY = WINDOW_HEIGHT - BALL_RADIUS; // Reposition to prevent sticking
+        match.ballDY = -scalarAbs(match.ballDY); // Reverse Y direction
+        reflected_this_frame = true;
+    }
+    else if (match.ballY - BALL_RADIUS < 0) {
+        match.ballY = BALL_RADIUS; // Reposition
+        match.ballDY = scalarAbs(match.ballDY); // Reverse Y direction
+        reflected_this_frame = true;
+    }
+
+    // --- Paddle Collisions ---
+    // Left Paddle Collision
+    if (match.ballDX < 0 && checkCircleRectCollision(match.ballX, match.ballY, BALL_RADIUS, match.leftPaddle)) {
+        match.ballX = match.leftPaddle.x + PADDLE_WIDTH + BALL_RADIUS; // Push ball out to prevent sticking
+        match.ballDX = scalarAbs(match.ballDX); // Reverse X direction
+        reflected_this_frame = true;
+        addMatchSound(sounds, MatchSoundType::PaddleHit, scalarToFloat(match.ballX), match.lastBallHit == LastHit::LeftPaddle ? match.leftConsecutiveHits + 1 : 1);
+
+        // Scoring Rule 1: Consecutive hits for the left player
+        if (match.lastBallHit == LastHit::LeftPaddle) {
+            match.leftConsecutiveHits++;
+            if (match.leftConsecutiveHits >= 2) {
+                match.leftScore++; // Award point for 2 consecutive hits
+                match.leftConsecutiveHits = 0; // Reset after scoring
+            }
+        }
+        else {
+            match.leftConsecutiveHits = 1; // Start a new consecutive streak
+            match.rightConsecutiveHits = 0; // Reset opponent's streak
+        }
+        match.lastBallHit = LastHit::LeftPaddle;
+
+    }
+    // Right Paddle Collision
+    else if (match.ballDX > 0 && checkCircleRectCollision(match.ballX, match.ballY, BALL_RADIUS, match.rightPaddle)) {
+        match.ballX = match.rightPaddle.x - BALL_RADIUS; // Push ball out to prevent sticking
+        match.ballDX = -scalarAbs(match.ballDX); // Reverse X direction
+        reflected_this_frame = true;
+        addMatchSound(sounds, MatchSoundType::PaddleHit, scalarToFloat(match.ballX), match.lastBallHit == LastHit::RightPaddle ? match.rightConsecutiveHits + 1 : 1);
+
+        // Scoring Rule 1: Consecutive hits for the right player
+        if (match.lastBallHit == LastHit::RightPaddle) {
+            match.rightConsecutiveHits++;
+            if (match.rightConsecutiveHits >= 2) {
+                match.rightScore++; // Award point for 2 consecutive hits
+                match.rightConsecutiveHits = 0; // Reset after scoring
+            }
+        }
+        else {
+            match.rightConsecutiveHits = 1; // Start a new consecutive streak
+            match.leftConsecutiveHits = 0; // Reset opponent's streak
+        }
+        match.lastBallHit = LastHit::RightPaddle;
+    }
+
+    // --- Out of Bounds (Scoring and Ball Reset) ---
+    // Ball goes past left paddle (right player scores)
+    if (match.ballX - BALL_RADIUS < 0) {
+        match.rightScore++;
+        resetBallAfterPoint(match);
+    }
+    // Ball goes past right paddle (left player scores)
+    else if (match.ballX + BALL_RADIUS > WINDOW_WIDTH) {
+        match.leftScore++;
+        resetBallAfterPoint(match);
+    }
+
+
+    // --- Ball Speed Boost Logic ---
+    if (reflected_this_frame) {
+        startBallBoost(match);
+    }
+
+    // --- Scripts (boost expiry, coin spawning) ---
+    match.scripts.runScripts();
+
+    // --- Coin Logic ---
+
+    // The coin's hitbox is a simulation constant, whatever art is loaded
+    int coinEffectiveWidth = COIN_COLLISION_WIDTH;
+    int coinEffectiveHeight = COIN_COLLISION_HEIGHT;
+
+    // Iterate through all active coins to check for expiry and collisions
+    for (auto it = match.coins.begin(); it != match.coins.end(); ) {
+        // Decrement coin's internal timer
+        it->timer--;
+        if (it->timer <= 0) {
+            it = match.coins.erase(it); // Remove coin if its timer has run out
+            continue; // Move to the next element (iterator is already advanced by erase)
+        }
+
+        // Create an SDL_Rect representing the coin's bounding box for collision checks
+        SDL_Rect coinRect = {
+            static_cast<int>(it->x - coinEffectiveWidth / 2),
+            static_cast<int>(it->y - coinEffectiveHeight / 2),
+            coinEffectiveWidth,
+            coinEffectiveHeight
+        };
+
+        bool coin_collected = false; // Flag to check if the coin was collected this frame
+
+        // Collision with ball (Scoring Rule 3: Ball collects coin)
+        if (checkCircleRectCollision(match.ballX, match.ballY, BALL_RADIUS, coinRect)) {
+            // Award score to the player who last hit the ball
+            if (match.lastBallHit == LastHit::LeftPaddle) {
+                match.leftScore++;
+            }
+            else if (match.lastBallHit == LastHit::RightPaddle) {
+                match.rightScore++;
+            }
+            addMatchSound(sounds, MatchSoundType::Coin, it->x); // Coin collection sound
+            coin_collected = true;
+        }
+
+        // Collision with left paddle (Scoring Rule 2: Paddle collects coin)
+        // Only check if coin hasn't already been collected by the ball
+        if (!coin_collected && checkRectRectCollision(match.leftPaddle, coinRect)) {
+            match.leftScore++;
+            addMatchSound(sounds, MatchSoundType::Coin, it->x);
+            coin_collected = true;
+        }
+
+        // Collision with right paddle (Scoring Rule 2: Paddle collects coin)
+        // Only check if coin hasn't already been collected by ball or left paddle
+        if (!coin_collected && checkRectRectCollision(match.rightPaddle, coinRect)) {
+            match.rightScore++;
+            addMatchSound(sounds, MatchSoundType::Coin, it->x);
+            coin_collected = true;
+        }
+
+        if (coin_collected) {
+            it = match.coins.erase(it); // Remove the collected coin from the vector
+        }
+        else {
+            ++it; // Move to the next coin if it was not collected this frame
+        }
+    }
+
+    // --- Desync Check ---
+    match.gameTick++;
+    if (match.desyncDetector) {
+        recordGameStateHash(match);
+    }
+    return sounds;
+}
+
+void playMatchSounds(const EngineContext& engine, const MatchSounds& sounds) {
+    for (int i = 0; i < sounds.count; i++) {
+        const MatchSound& sound = sounds.sounds[i];
+        if (sound.type == MatchSoundType::PaddleHit) {
+            playHitSound(engine, sound.x, sound.streak);
+        }
+        else {
+            playCoinSound(engine, sound.x);
+        }
+    }
+}
+
+bool handleMatchClick(MatchContext& match, int x, int y) {
+    // Ball launch logic on click (only if the ball is currently stationary)
+    if (isSpectating(match) || match.ballDX != 0 || match.ballDY != 0) {
+        return false;
+    }
+    // Check if the click was on the ball (squared distance, so no sqrt is needed)
+    Scalar offsetX = Scalar(x) - match.ballX;
+    Scalar offsetY = Scalar(y) - match.ballY;
+    if (scalarLengthSquared(offsetX, offsetY) > scalarSquared(BALL_RADIUS)) {
+        return false;
+    }
+    launchBall(match);
+    return true;
+}
+
+void launchBall(MatchContext& match) {
+    match.launchedBeforeTick = true;
+    serveBallInRandomDirection(match);
+    cancelBallBoost(match); // Reset to initial speed on launch
+}
+
+void renderMatch(EngineContext& engine, const MatchContext& match, SDL_Renderer* renderer, Uint32 currentTime,
+                 CachedLayer* scoreLayer) {
+    if (engine.glyphCache) {
+        updateGlyphCache(engine.glyphCache); // Upload glyphs rasterized since the last frame
+    }
+    queueMatchSprites(engine, match, engine.renderQueue, currentTime);
+    flushRenderQueue(engine.renderQueue, renderer);
+    if (engine.coins.softwareTarget) {
+        // RLE blits go straight into the surface, after everything queued so far
+        for (const auto& coin : match.coins) {
+            draw_Coin(engine.coins, static_cast<int>(coin.x), static_cast<int>(coin.y), COIN_DRAW_SCALE, renderer, currentTime);
+        }
+    }
+
+    if (scoreLayer == nullptr) {
+        renderMatchScores(engine, match, renderer);
+        return;
+    }
+    // Placeholder glyphs turn into real ones as the glyph cache fills, so that counts as a change too
+    Uint64 version = (static_cast<Uint64>(static_cast<Uint32>(match.leftScore)) << 32) | static_cast<Uint32>(match.rightScore);
+    if (engine.glyphCache) {
+        version ^= static_cast<Uint64>(getGlyphCacheRevision(engine.glyphCache)) << 20;
+    }
+    if (beginCachedLayer(*scoreLayer, renderer, version)) {
+        renderMatchScores(engine, match, renderer);
+        endCachedLayer(*scoreLayer, renderer);
+    }
+    drawCachedLayer(*scoreLayer, renderer);
+}
+
+bool initScoreLayer(CachedLayer& layer, SDL_Renderer* renderer) {
+    // The panel starts at the top-left corner, so score text keeps its field coordinates
+    SDL_Rect panel = { 0, 0, WINDOW_WIDTH, SCORE_PANEL_HEIGHT };
+    return initCachedLayer(layer, renderer, panel);
+}
+
+void queueMatchSprites(const EngineContext& engine, const MatchContext& match, RenderQueue& queue, Uint32 currentTime) {
+    Uint8 ballLayer = static_cast<Uint8>(MatchLayer::Ball);
+    if (engine.ballTexture) {
+        SDL_Rect ballRect = { scalarToInt(match.ballX) - BALL_RADIUS, scalarToInt(match.ballY) - BALL_RADIUS, 2 * BALL_RADIUS + 1, 2 * BALL_RADIUS + 1 };
+        queueTexture(queue, ballLayer, engine.ballTexture, nullptr, toFRect(ballRect));
+    }
+    else {
+        queueFilledCircle(queue, ballLayer, scalarToInt(match.ballX), scalarToInt(match.ballY), BALL_RADIUS, BALL_COLOR);
+    }
+
+    Uint8 paddleLayer = static_cast<Uint8>(MatchLayer::Paddles);
+    queueFillRect(queue, paddleLayer, toFRect(match.leftPaddle), LEFT_PADDLE_COLOR);
+    queueFillRect(queue, paddleLayer, toFRect(match.rightPaddle), RIGHT_PADDLE_COLOR);
+
+    if (engine.coins.softwareTarget == nullptr) {
+        for (const auto& coin : match.coins) {
+            queueCoin(engine.coins, queue, static_cast<Uint8>(MatchLayer::Coins), static_cast<int>(coin.x), static_cast<int>(coin.y),
+                      COIN_DRAW_SCALE, currentTime);
+        }
+    }
+}
+
+void renderMatchScores(const EngineContext& engine, const MatchContext& match, SDL_Renderer* renderer) {
+    // Render scores for both players
+    renderText(engine, renderer, "Player 1: " + std::to_string(match.leftScore), 50, 20, TEXT_COLOR);
+    renderText(engine, renderer, "Player 2: " + std::to_string(match.rightScore), WINDOW_WIDTH - 200, 20, TEXT_COLOR);
+}
+
+// Quantizes the current game state for replication.
+// Coins are appended in spawn order and erased in place, so the vector is already sorted by id.
+PongSnapshot capturePongSnapshot(const MatchContext& match, uint16_t sequence) {
+    PongSnapshot snapshot;
+    snapshot.sequence = sequence;
+    snapshot.ballX = quantizePosition(scalarToFloat(match.ballX));
+    snapshot.ballY = quantizePosition(scalarToFloat(match.ballY));
+    snapshot.ballDX = quantizeDirection(scalarToFloat(match.ballDX));
+    snapshot.ballDY = quantizeDirection(scalarToFloat(match.ballDY));
+    snapshot.ballBoosted = match.currentBallSpeed > INITIAL_BALL_SPEED ? 1 : 0;
+    snapshot.lastHit = static_cast<uint8_t>(match.lastBallHit);
+    snapshot.leftPaddleY = quantizePosition(static_cast<float>(match.leftPaddle.y));
+    snapshot.rightPaddleY = quantizePosition(static_cast<float>(match.rightPaddle.y));
+    snapshot.leftScore = static_cast<uint16_t>(match.leftScore);
+    snapshot.rightScore = static_cast<uint16_t>(match.rightScore);
+    snapshot.numCoins = 0;
+    for (const Coin& coin : match.coins) {
+        if (snapshot.numCoins >= MAX_NET_COINS) {
+            break;
+        }
+        NetCoin& netCoin = snapshot.coins[snapshot.numCoins++];
+        netCoin.id = coin.id;
+        netCoin.x = quantizePosition(coin.x);
+        netCoin.y = quantizePosition(coin.y);
+    }
+    return snapshot;
+}
+
+// Replaces the match state with a replicated snapshot (used when spectating)
+void applyPongSnapshot(MatchContext& match, const PongSnapshot& snapshot) {
+    match.ballX = scalarFromFloat(dequantizePosition(snapshot.ballX));
+    match.ballY = scalarFromFloat(dequantizePosition(snapshot.ballY));
+    match.ballDX = scalarFromFloat(dequantizeDirection(snapshot.ballDX));
+    match.ballDY = scalarFromFloat(dequantizeDirection(snapshot.ballDY));
+    match.currentBallSpeed = snapshot.ballBoosted ? INITIAL_BALL_SPEED * BALL_BOOST_FACTOR : INITIAL_BALL_SPEED;
+    match.lastBallHit = static_cast<LastHit>(snapshot.lastHit);
+    match.leftPaddle.y = static_cast<int>(dequantizePosition(snapshot.leftPaddleY));
+    match.rightPaddle.y = static_cast<int>(dequantizePosition(snapshot.rightPaddleY));
+    match.leftScore = snapshot.leftScore;
+    match.rightScore = snapshot.rightScore;
+    match.coins.clear();
+    for (int i = 0; i < snapshot.numCoins; ++i) {
+        const NetCoin& netCoin = snapshot.coins[i];
+        match.coins.push_back({ dequantizePosition(netCoin.x), dequantizePosition(netCoin.y), COIN_DURATION_FRAMES, netCoin.id });
+    }
+}
+
+// Fills state with the current simulation state and returns how many bytes of it are in use
+size_t captureCanonicalState(const MatchContext& match, CanonicalPongState& state) {
+    state.tick = match.gameTick;
+    state.rngState = match.rngState;
+    state.ballX = scalarToBits(match.ballX);
+    state.ballY = scalarToBits(match.ballY);
+    state.ballDX = scalarToBits(match.ballDX);
+    state.ballDY = scalarToBits(match.ballDY);
+    state.ballSpeed = scalarToBits(match.currentBallSpeed);
+    state.leftPaddleY = match.leftPaddle.y;
+    state.rightPaddleY = match.rightPaddle.y;
+    state.leftScore = match.leftScore;
+    state.rightScore = match.rightScore;
+    state.lastHit = static_cast<int32_t>(match.lastBallHit);
+    state.leftConsecutiveHits = match.leftConsecutiveHits;
+    state.rightConsecutiveHits = match.rightConsecutiveHits;
+    state.ballBoostGeneration = match.ballBoostGeneration;
+    state.scriptTick = static_cast<uint32_t>(match.scripts.currentTick());
+    memset(state.scriptTimers, 0, sizeof(state.scriptTimers));
+    state.numScriptTimers = static_cast<uint32_t>(match.scripts.getTimedWaits(state.scriptTimers, MAX_CANONICAL_SCRIPT_TIMERS));
+    state.numScriptConditions = static_cast<uint32_t>(match.scripts.predicateWaitCount());
+    state.numCoins = 0;
+    for (const Coin& coin : match.coins) {
+        if (state.numCoins >= MAX_CANONICAL_COINS) {
+            break;
+        }
+        state.coins[state.numCoins].x = coin.x;
+        state.coins[state.numCoins].y = coin.y;
+        state.coins[state.numCoins].timer = coin.timer;
+        state.coins[state.numCoins].id = coin.id;
+        state.numCoins++;
+    }
+    return offsetof(CanonicalPongState, coins) + state.numCoins * sizeof(state.coins[0]);
+}
+
+// Hashes this tick's state for the desync detector; the result is what gets sent to lockstep peers
+uint64_t recordGameStateHash(MatchContext& match) {
+    if (match.desyncDetector == nullptr) {
+        return 0;
+    }
+    CanonicalPongState state;
+    size_t size = captureCanonicalState(match, state);
+    return match.desyncDetector->recordLocalState(match.gameTick, &state, size);
+}
+
+// Turns a recorded CanonicalPongState back into readable fields for desync dumps
+void describeCanonicalState(const uint8_t* data, size_t size, std::ostream& out) {
+    CanonicalPongState state = {};
+    memcpy(&state, data, std::min(size, sizeof(state)));
+    out << "rng_state " << state.rngState << "\n";
+    out << "ball " << scalarToFloat(scalarFromBits(state.ballX)) << " " << scalarToFloat(scalarFromBits(state.ballY))
+        << " dir " << scalarToFloat(scalarFromBits(state.ballDX)) << " " << scalarToFloat(scalarFromBits(state.ballDY))
+        << " speed " << scalarToFloat(scalarFromBits(state.ballSpeed)) << "\n";
+    out << "paddles " << state.leftPaddleY << " " << state.rightPaddleY << "\n";
+    out << "scores " << state.leftScore << " " << state.rightScore << "\n";
+    out << "last_hit " << state.lastHit << " streaks " << state.leftConsecutiveHits << " " << state.rightConsecutiveHits << "\n";
+    out << "boost_generation " << state.ballBoostGeneration << "\n";
+    out << "script_tick " << state.scriptTick << " conditions " << state.numScriptConditions << " timers " << state.numScriptTimers << ":";
+    for (uint32_t i = 0; i < state.numScriptTimers && i < MAX_CANONICAL_SCRIPT_TIMERS; ++i) {
+        out << " " << state.scriptTimers[i];
+    }
+    out << "\n";
+    for (uint32_t i = 0; i < state.numCoins && i < MAX_CANONICAL_COINS; ++i) {
+        out << "coin " << state.coins[i].id << " " << state.coins[i].x << " " << state.coins[i].y
+            << " timer " << state.coins[i].timer << "\n";
+    }
+}
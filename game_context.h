@@ -0,0 +1,277 @@
+#pragma once
+#ifndef GAME_CONTEXT_H
+#define GAME_CONTEXT_H
+
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "audio_mixer.h" // MixerSound
+#include "coin.h"        // CoinSystem
+#include "fixedmath.h"   // Scalar
+#include "font_atlas.h"
+#include "glyph_cache.h"
+#include "layer_cache.h"  // CachedLayer
+#include "render_queue.h"
+#include "replication.h" // PongSnapshot
+#include "script.h"
+#include "spectator.h"
+#include "statehash.h"   // DesyncDetector
+
+// Engine and match contexts.
+//
+// Everything a running game touches lives in one of two objects instead of in
+// process-wide globals, so one process can host any number of matches for
+// batch simulation, split-screen or servers:
+//
+//   EngineContext  Assets shared by every match: coin frames, sound effects
+//                  and the score font. Loaded once per renderer.
+//   MatchContext   One game: ball, paddles, coins, scores, scripts, random
+//                  generator, desync detector and spectator connections.
+//
+// A match only reads its engine, so any number of matches can share one, and
+// its simulation never does: hitboxes are constants and sounds are returned
+// to the caller, so a headless host plays exactly as a window does. The
+// audio device and music stream stay process-wide (there is one of each).
+// The desync detector and spectator connections are allocated only when a
+// match uses them, which keeps an idle match at a few KB (see match_host.h).
+
+// --- Constants ---
+const int WINDOW_WIDTH = 800;   // Size of the playing field (and of the window)
+const int WINDOW_HEIGHT = 600;
+
+const int BALL_DIAMETER = 30;
+const int BALL_RADIUS = BALL_DIAMETER / 2;
+const Scalar INITIAL_BALL_SPEED = scalarFromFloat(4.0f);
+const Scalar BALL_BOOST_FACTOR = scalarFromFloat(1.2f);
+const Scalar MIN_SERVE_COMPONENT = scalarFromFloat(0.2f); // Serves avoid angles too close to 0, 90, 180, 270 degrees
+const int BALL_BOOST_DURATION_FRAMES = 30;
+
+const int PADDLE_WIDTH = 20;
+const int PADDLE_HEIGHT = 100;
+const float PADDLE_SPEED = 6.0f;
+
+const int SCORE_PANEL_HEIGHT = 60; // Top strip of the field holding the score text
+const char* const FONT_ATLAS_FILE = "arial_sdf.fatlas"; // Score font; arial.ttf through a glyph cache without it
+
+const float COIN_DRAW_SCALE = 0.8f; // Scale for drawing coins
+// Coin hitbox: the 45x48 coin frames at COIN_DRAW_SCALE. Fixed rather than
+// read from the loaded art, so every build and the headless host simulate alike.
+const int COIN_COLLISION_WIDTH = 36;
+const int COIN_COLLISION_HEIGHT = 38;
+const int COIN_APPEAR_INTERVAL_FRAMES = 300; // Roughly 5 seconds at 60 FPS
+const int COIN_DURATION_FRAMES = 600; // Roughly 10 seconds at 60 FPS
+
+struct Coin {
+    float x, y;
+    int timer;
+    unsigned int id; // Stable identity for replication; increases with every spawn
+    // 'active' is now implicit: if it's in the vector, it's active.
+    // If its timer runs out, it's removed from the vector.
+};
+
+// For scoring rule 1: consecutive hits
+enum class LastHit { None, LeftPaddle, RightPaddle };
+
+// Fixed layout of everything the simulation depends on, hashed once per tick.
+// All fields are 4 bytes wide so the struct has no padding bytes; ball values
+// hold the raw bits of the Scalar backend in use. Script timers are stored as
+// ticks left, smallest first, since that is all of a waiting script's state
+// the simulation can observe.
+const int MAX_CANONICAL_COINS = 32;
+const int MAX_CANONICAL_SCRIPT_TIMERS = 16;
+struct CanonicalPongState {
+    uint32_t tick;
+    uint32_t rngState;
+    uint32_t ballX, ballY, ballDX, ballDY, ballSpeed;
+    int32_t leftPaddleY, rightPaddleY;
+    int32_t leftScore, rightScore;
+    int32_t lastHit, leftConsecutiveHits, rightConsecutiveHits;
+    uint32_t ballBoostGeneration;
+    uint32_t scriptTick;
+    uint32_t numScriptTimers, numScriptConditions;
+    uint32_t scriptTimers[MAX_CANONICAL_SCRIPT_TIMERS]; // Unused entries are 0
+    uint32_t numCoins;
+    struct {
+        float x, y;
+        int32_t timer;
+        uint32_t id;
+    } coins[MAX_CANONICAL_COINS];
+};
+
+// Paddle controls for one tick
+struct MatchInput {
+    bool leftUp, leftDown;   // W, S
+    bool rightUp, rightDown; // Up, Down
+};
+
+// Sounds a tick asks for. The simulation only reports them; whoever runs the
+// match decides whether to play them (see playMatchSounds).
+enum class MatchSoundType { PaddleHit, Coin };
+
+struct MatchSound {
+    MatchSoundType type;
+    float x;    // Horizontal position, for panning
+    int streak; // Paddle hits: the hitter's consecutive hits including this one
+};
+
+const int MAX_MATCH_SOUNDS = 8; // Per tick; any more would be drowned out anyway
+
+struct MatchSounds {
+    MatchSound sounds[MAX_MATCH_SOUNDS];
+    int count = 0;
+};
+
+// Parts of a match drawing, back to front; the render queue layers of its sprites.
+// Queued layers are painted in order across every match in the queue, so
+// balls, paddles and coins of a whole wall each go out in one batch.
+enum class MatchLayer { Ball, Paddles, Coins, Scores };
+
+// --- Engine ---
+struct EngineContext {
+    SDL_Renderer* renderer = nullptr; // nullptr for headless simulation
+    CoinSystem coins;
+    SDL_Texture* ballTexture = nullptr; // Rasterized at startup; nullptr draws the ball as rows of rectangles
+    RenderQueue renderQueue;            // Reused by renderMatch every frame
+
+    // Audio
+    MixerSound* coinMixerSound = nullptr; // Synthesized at startup (COIN_SYNTH)
+    MixerSound* hitMixerSound = nullptr;  // Synthesized at startup (PADDLE_HIT_SYNTH)
+    Mix_Chunk* coinSound = nullptr;       // Decoded coin_sound.mp3, only loaded if the mixer is unavailable
+
+    // Text Rendering
+    FontAtlas* fontAtlas = nullptr;   // Built by font_atlas_builder --sdf; preferred over glyphCache
+    GlyphCache* glyphCache = nullptr; // Fallback when the atlas is missing: arial.ttf rasterized in the background
+};
+
+// Loads the shared assets for renderer. softwareTarget is the surface a
+// software renderer draws into (nullptr for accelerated renderers). Sounds are
+// synthesized only if the audio mixer is already running, and the fallback
+// sample is only loaded if SDL_mixer has an open device. Returns false (and
+// prints why) if the coin frames cannot be loaded.
+bool initEngine(EngineContext& engine, SDL_Renderer* renderer, SDL_Surface* softwareTarget);
+
+void closeEngine(EngineContext& engine);
+
+// --- Match ---
+struct MatchContext {
+    explicit MatchContext(const EngineContext* engine);
+    MatchContext(const MatchContext&) = delete;
+    MatchContext& operator=(const MatchContext&) = delete;
+
+    const EngineContext* engine; // Shared, read-only
+
+    // Simulation values use Scalar so the fixed-point build stays bit-identical across machines
+    Scalar ballX, ballY;
+    Scalar ballDX, ballDY;
+    Scalar currentBallSpeed;
+    unsigned int ballBoostGeneration; // Bumped whenever a boost starts or is cancelled
+
+    SDL_Rect leftPaddle;
+    SDL_Rect rightPaddle;
+
+    std::vector<Coin> coins;
+    unsigned int nextCoinId;
+
+    int leftScore;
+    int rightScore;
+    LastHit lastBallHit;
+    int leftConsecutiveHits;
+    int rightConsecutiveHits;
+
+    ScriptScheduler scripts; // Resumed once per tick, drives coin spawning and ball boosts
+
+    // The simulation draws from its own xorshift generator instead of rand(), so the
+    // generator state is part of the game state and can be hashed and replicated.
+    uint32_t rngState;
+    uint32_t gameTick;
+    uint32_t seed; // As given to startMatch
+
+    // REPLAY_* input bits of the latest ticks, newest first, for lockstep spectators
+    uint8_t recentInputs[SPECTATOR_INPUT_HISTORY];
+    bool launchedBeforeTick; // Set by launchBall, recorded with the next tick's input
+
+    DesyncDetector* desyncDetector; // Set by enableDesyncCheck; hashes go to spectators, or are checked against the host's
+    uint32_t remoteDumpRequestMs;   // After a desync: when the host's state of the tick was last asked for
+    uint32_t remoteDumpDeadlineMs;  // and when to stop asking
+
+    SpectatorBroadcaster* broadcaster; // Set while this match is streamed to spectators
+    SpectatorClient* spectatorClient;  // Set while this match mirrors one streamed by another process
+    uint16_t broadcastSequence;
+};
+
+// Seeds the random generator (any value) and starts the gameplay scripts
+void startMatch(MatchContext& match, uint32_t seed);
+
+// Stops the scripts, closes any spectator connections and frees the desync history
+void closeMatch(MatchContext& match);
+
+// Hashes the state every tick from now on, keeping DESYNC_HISTORY ticks for dumps.
+// A broadcast match sends the hashes to its spectators; a spectating match
+// re-simulates the host's match from its inputs and checks them instead.
+void enableDesyncCheck(MatchContext& match);
+
+// Streams the match to spectators on port. Returns false (and prints why) on failure.
+bool openMatchBroadcast(MatchContext& match, uint16_t port);
+
+// Makes the match mirror one streamed from host:port instead of simulating.
+// Returns false (and prints why) on failure.
+bool connectMatchSpectator(MatchContext& match, const char* host, uint16_t port);
+
+bool isSpectating(const MatchContext& match);
+
+// Current W/S and Up/Down state from the SDL keyboard
+MatchInput readKeyboardInput();
+
+// Advances the match by one tick: simulates it and broadcasts the result, or
+// mirrors the latest snapshot when spectating (re-simulates and checks the
+// host's ticks when spectating with a desync check). Returns the sounds of
+// the simulated tick; spectated ticks are silent.
+MatchSounds advanceMatch(MatchContext& match, const MatchInput& input, uint32_t nowMs);
+
+// Simulates one tick: paddles, ball, scoring, scripts and coins. Touches no
+// assets or devices; the tick's sounds are returned for the caller to play.
+MatchSounds updateMatch(MatchContext& match, const MatchInput& input);
+
+// Plays sounds returned by updateMatch with the engine's mixer sounds, if any
+void playMatchSounds(const EngineContext& engine, const MatchSounds& sounds);
+
+// Serves a stationary ball in a random direction
+void launchBall(MatchContext& match);
+
+// Launches a stationary ball if (x, y) is on it. Returns true if it was launched.
+bool handleMatchClick(MatchContext& match, int x, int y);
+
+// Draws the ball, paddles, coins and scores (the caller clears and presents).
+// Drawing updates the engine's caches, so it takes the engine separately.
+// Sprites go through the engine's render queue, so the ball, both paddles and
+// every coin take two or three draw calls however many there are.
+// With a scoreLayer (see initScoreLayer) the score text is only re-rendered
+// when a score changes, and composited with one copy otherwise.
+void renderMatch(EngineContext& engine, const MatchContext& match, SDL_Renderer* renderer, Uint32 currentTime,
+                 CachedLayer* scoreLayer = nullptr);
+
+// Prepares layer to cache the score panel of one match view
+bool initScoreLayer(CachedLayer& layer, SDL_Renderer* renderer);
+
+// Queues the ball, paddles and coins in their MatchLayer. Coins are left out
+// when the engine blits them into a software target; draw those with draw_Coin
+// after flushing.
+void queueMatchSprites(const EngineContext& engine, const MatchContext& match, RenderQueue& queue, Uint32 currentTime);
+
+// Draws the score text directly. The caller uploads pending glyph cache text
+// first (updateGlyphCache).
+void renderMatchScores(const EngineContext& engine, const MatchContext& match, SDL_Renderer* renderer);
+
+// Replication and desync detection
+PongSnapshot capturePongSnapshot(const MatchContext& match, uint16_t sequence);
+void applyPongSnapshot(MatchContext& match, const PongSnapshot& snapshot);
+size_t captureCanonicalState(const MatchContext& match, CanonicalPongState& state);
+uint64_t recordGameStateHash(MatchContext& match);
+void describeCanonicalState(const uint8_t* state, size_t size, std::ostream& out);
+
+#endif
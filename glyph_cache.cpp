@@ -0,0 +1,368 @@
+#include "glyph_cache.h"
+#include <condition_variable> // For waking the worker
+#include <iostream>           // For error output
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int GLYPH_ATLAS_SIZE = 256;
+const int GLYPH_PADDING = 1;
+const int MAX_UPLOADS_PER_FRAME = 8; // Bounds the texture update cost of any one frame
+const int GLYPH_CODEPOINTS = 128;    // ASCII
+const Uint8 PLACEHOLDER_ALPHA = 48;
+const Uint32 GLYPH_IDLE_FRAMES = 120;   // Glyphs not drawn for this long are evicted when the atlas fills up
+const Uint32 REPACK_INTERVAL_FRAMES = 60; // Glyphs left without room wait this long before the next attempt
+
+enum GlyphState : Uint8 {
+    GLYPH_MISSING,
+    GLYPH_PENDING,
+    GLYPH_READY,
+    GLYPH_NO_ROOM, // Rasterized but the atlas is full; drawn as a placeholder until a repack makes room
+    GLYPH_FAILED   // Not in the font, or bigger than the whole atlas
+};
+
+struct CachedGlyph {
+    GlyphState state;
+    SDL_Rect source; // In the atlas
+    int offsetX;     // From the pen position to the bitmap's left edge
+    int offsetY;     // From the top of the line to the bitmap's top edge
+    int advance;
+    Uint32 lastDrawn; // GlyphCache::frame of the last draw
+};
+
+// Worker output, waiting to be packed and uploaded
+struct RasterizedGlyph {
+    Uint16 codepoint;
+    bool provided;
+    int width;
+    int height;
+    int offsetX;
+    int offsetY;
+    int advance;
+    std::vector<Uint32> pixels; // White with coverage alpha, ready for SDL_UpdateTexture
+};
+
+} // namespace
+
+struct GlyphCache {
+    SDL_Texture* atlas;
+    CachedGlyph glyphs[GLYPH_CODEPOINTS];
+    int placeholderAdvance;
+    int placeholderHeight;
+    int packX;
+    int packY;
+    int shelfHeight;
+    bool reportedFull;
+    Uint32 revision; // Bumped whenever glyphs are uploaded
+    Uint32 frame;    // Counts updateGlyphCache calls
+    Uint32 nextRepackFrame;
+    RasterizedGlyph bitmaps[GLYPH_CODEPOINTS]; // Pixels of every READY and NO_ROOM glyph, for repacking
+
+    // Shared with the worker; the render thread only ever try-locks
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Uint16> requests;
+    std::vector<RasterizedGlyph> finished;
+    bool running;
+
+    TTF_Font* font; // Worker only after creation
+    std::thread worker;
+};
+
+namespace {
+
+RasterizedGlyph rasterizeGlyph(TTF_Font* font, Uint16 codepoint) {
+    RasterizedGlyph glyph = { codepoint, false, 0, 0, 0, 0, 0, {} };
+    int minX, maxX, minY, maxY;
+    if (!TTF_GlyphIsProvided(font, codepoint) ||
+        TTF_GlyphMetrics(font, codepoint, &minX, &maxX, &minY, &maxY, &glyph.advance) != 0) {
+        return glyph;
+    }
+    glyph.provided = true;
+
+    SDL_Color white = { 255, 255, 255, 255 };
+    SDL_Surface* surface = TTF_RenderGlyph_Blended(font, codepoint, white);
+    if (surface == nullptr) {
+        return glyph; // Whitespace: advance only
+    }
+
+    // Crop to the covered pixels. Blended glyph surfaces are ARGB8888 with the
+    // line top at row 0 and the pen at column 0.
+    int left = surface->w, top = surface->h, right = -1, bottom = -1;
+    for (int y = 0; y < surface->h; ++y) {
+        const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(surface->pixels) + y * surface->pitch);
+        for (int x = 0; x < surface->w; ++x) {
+            if (row[x] >> 24) {
+                left = x < left ? x : left;
+                right = x > right ? x : right;
+                top = y < top ? y : top;
+                bottom = y > bottom ? y : bottom;
+            }
+        }
+    }
+    if (right >= left) {
+        glyph.width = right - left + 1;
+        glyph.height = bottom - top + 1;
+        glyph.offsetX = left;
+        glyph.offsetY = top;
+        glyph.pixels.resize(static_cast<size_t>(glyph.width) * glyph.height);
+        for (int y = 0; y < glyph.height; ++y) {
+            const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(surface->pixels) + (top + y) * surface->pitch);
+            for (int x = 0; x < glyph.width; ++x) {
+                glyph.pixels[static_cast<size_t>(y) * glyph.width + x] = (row[left + x] & 0xFF000000u) | 0x00FFFFFFu;
+            }
+        }
+    }
+    SDL_FreeSurface(surface);
+    return glyph;
+}
+
+void glyphWorker(GlyphCache* cache) {
+    std::vector<Uint16> work;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(cache->mutex);
+            cache->wake.wait(lock, [cache] { return !cache->requests.empty() || !cache->running; });
+            if (!cache->running) {
+                return;
+            }
+            work.swap(cache->requests);
+        }
+        for (Uint16 codepoint : work) {
+            RasterizedGlyph glyph = rasterizeGlyph(cache->font, codepoint); // The slow part, outside the lock
+            std::lock_guard<std::mutex> lock(cache->mutex);
+            cache->finished.push_back(std::move(glyph));
+        }
+        work.clear();
+    }
+}
+
+void clearAtlas(SDL_Texture* atlas) {
+    std::vector<Uint32> clear(static_cast<size_t>(GLYPH_ATLAS_SIZE) * GLYPH_ATLAS_SIZE, 0x00FFFFFFu);
+    SDL_UpdateTexture(atlas, nullptr, clear.data(), GLYPH_ATLAS_SIZE * static_cast<int>(sizeof(Uint32)));
+}
+
+// Shelf-packs a rasterized glyph into the atlas and uploads just its rectangle.
+// Returns false, leaving the glyph NO_ROOM, if the atlas has no space left.
+bool placeGlyph(GlyphCache* cache, Uint16 codepoint) {
+    CachedGlyph& cached = cache->glyphs[codepoint];
+    const RasterizedGlyph& glyph = cache->bitmaps[codepoint];
+    cached.source = { 0, 0, glyph.width, glyph.height };
+    if (glyph.width > 0) {
+        int packX = cache->packX;
+        int packY = cache->packY;
+        int shelfHeight = cache->shelfHeight;
+        if (packX + glyph.width + GLYPH_PADDING > GLYPH_ATLAS_SIZE) {
+            packX = GLYPH_PADDING;
+            packY += shelfHeight + GLYPH_PADDING;
+            shelfHeight = 0;
+        }
+        if (packY + glyph.height + GLYPH_PADDING > GLYPH_ATLAS_SIZE) {
+            cached.state = GLYPH_NO_ROOM;
+            return false;
+        }
+        cached.source.x = packX;
+        cached.source.y = packY;
+        SDL_UpdateTexture(cache->atlas, &cached.source, glyph.pixels.data(), glyph.width * static_cast<int>(sizeof(Uint32)));
+        cache->packX = packX + glyph.width + GLYPH_PADDING;
+        cache->packY = packY;
+        cache->shelfHeight = glyph.height > shelfHeight ? glyph.height : shelfHeight;
+    }
+    cached.state = GLYPH_READY;
+    return true;
+}
+
+bool isRepackDue(const GlyphCache* cache) {
+    return static_cast<Sint32>(cache->frame - cache->nextRepackFrame) >= 0;
+}
+
+// Makes room in a full atlas: glyphs not drawn for GLYPH_IDLE_FRAMES are
+// dropped (and rasterized again if they are ever drawn), and everything else
+// is packed again from the kept pixels, glyphs in use first
+void repackGlyphCache(GlyphCache* cache) {
+    cache->nextRepackFrame = cache->frame + REPACK_INTERVAL_FRAMES;
+    for (int codepoint = 0; codepoint < GLYPH_CODEPOINTS; ++codepoint) {
+        CachedGlyph& cached = cache->glyphs[codepoint];
+        if (cached.state == GLYPH_READY && cache->frame - cached.lastDrawn > GLYPH_IDLE_FRAMES) {
+            cached.state = GLYPH_MISSING;
+            std::vector<Uint32>().swap(cache->bitmaps[codepoint].pixels);
+        }
+    }
+    clearAtlas(cache->atlas);
+    cache->packX = GLYPH_PADDING;
+    cache->packY = GLYPH_PADDING;
+    cache->shelfHeight = 0;
+    for (GlyphState state : { GLYPH_READY, GLYPH_NO_ROOM }) {
+        for (int codepoint = 0; codepoint < GLYPH_CODEPOINTS; ++codepoint) {
+            if (cache->glyphs[codepoint].state == state) {
+                placeGlyph(cache, static_cast<Uint16>(codepoint));
+            }
+        }
+    }
+    cache->revision++; // Every glyph may have moved
+}
+
+// Keeps a finished glyph and packs it, repacking the atlas if it is full
+void addGlyph(GlyphCache* cache, RasterizedGlyph& glyph) {
+    CachedGlyph& cached = cache->glyphs[glyph.codepoint];
+    if (!glyph.provided || glyph.width + 2 * GLYPH_PADDING > GLYPH_ATLAS_SIZE || glyph.height + 2 * GLYPH_PADDING > GLYPH_ATLAS_SIZE) {
+        cached.state = GLYPH_FAILED;
+        return;
+    }
+    cached.advance = glyph.advance;
+    cached.offsetX = glyph.offsetX;
+    cached.offsetY = glyph.offsetY;
+    cached.lastDrawn = cache->frame; // It was requested because it is being drawn
+    Uint16 codepoint = glyph.codepoint;
+    cache->bitmaps[codepoint] = std::move(glyph);
+    if (placeGlyph(cache, codepoint)) {
+        return;
+    }
+    if (!cache->reportedFull) {
+        std::cerr << "Glyph cache atlas is full; evicting characters that are no longer drawn." << std::endl;
+        cache->reportedFull = true;
+    }
+    if (isRepackDue(cache)) {
+        repackGlyphCache(cache);
+    }
+}
+
+} // namespace
+
+GlyphCache* createGlyphCache(SDL_Renderer* renderer, TTF_Font* font) {
+    SDL_Texture* atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+                                           GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE);
+    if (atlas == nullptr) {
+        std::cerr << "Failed to create glyph cache texture! SDL_Error: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+    clearAtlas(atlas);
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+
+    GlyphCache* cache = new GlyphCache;
+    cache->atlas = atlas;
+    for (CachedGlyph& glyph : cache->glyphs) {
+        glyph = { GLYPH_MISSING, { 0, 0, 0, 0 }, 0, 0, 0, 0 };
+    }
+    // Placeholder boxes are sized from the font's height before any glyph exists
+    cache->placeholderHeight = TTF_FontHeight(font);
+    cache->placeholderAdvance = cache->placeholderHeight / 2;
+    cache->packX = GLYPH_PADDING;
+    cache->packY = GLYPH_PADDING;
+    cache->shelfHeight = 0;
+    cache->reportedFull = false;
+    cache->revision = 0;
+    cache->frame = 0;
+    cache->nextRepackFrame = 0;
+    cache->running = true;
+    cache->font = font;
+    cache->worker = std::thread(glyphWorker, cache);
+    return cache;
+}
+
+void freeGlyphCache(GlyphCache* cache) {
+    if (cache == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        cache->running = false;
+    }
+    cache->wake.notify_one();
+    cache->worker.join();
+    TTF_CloseFont(cache->font);
+    SDL_DestroyTexture(cache->atlas);
+    delete cache;
+}
+
+void requestGlyphs(GlyphCache* cache, const std::string& text) {
+    std::vector<Uint16> missing;
+    for (char c : text) {
+        unsigned char codepoint = static_cast<unsigned char>(c);
+        if (codepoint < GLYPH_CODEPOINTS && cache->glyphs[codepoint].state == GLYPH_MISSING) {
+            cache->glyphs[codepoint].state = GLYPH_PENDING;
+            missing.push_back(codepoint);
+        }
+    }
+    if (missing.empty()) {
+        return;
+    }
+    {
+        // Held only for the append; the worker never holds it while rasterizing
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        cache->requests.insert(cache->requests.end(), missing.begin(), missing.end());
+    }
+    cache->wake.notify_one();
+}
+
+void updateGlyphCache(GlyphCache* cache) {
+    cache->frame++;
+    if (isRepackDue(cache)) {
+        // Glyphs that found no room try again once idle ones can be evicted
+        for (const CachedGlyph& glyph : cache->glyphs) {
+            if (glyph.state == GLYPH_NO_ROOM) {
+                repackGlyphCache(cache);
+                break;
+            }
+        }
+    }
+
+    std::vector<RasterizedGlyph> ready;
+    {
+        std::unique_lock<std::mutex> lock(cache->mutex, std::try_to_lock);
+        if (!lock.owns_lock() || cache->finished.empty()) {
+            return; // Worker is publishing right now; pick the glyphs up next frame
+        }
+        size_t count = cache->finished.size() < static_cast<size_t>(MAX_UPLOADS_PER_FRAME) ? cache->finished.size() : MAX_UPLOADS_PER_FRAME;
+        ready.assign(std::make_move_iterator(cache->finished.begin()), std::make_move_iterator(cache->finished.begin() + count));
+        cache->finished.erase(cache->finished.begin(), cache->finished.begin() + count);
+    }
+    for (RasterizedGlyph& glyph : ready) {
+        addGlyph(cache, glyph);
+    }
+    cache->revision++;
+
+    // Later placeholders use the width of a real digit once one is known
+    if (cache->glyphs['0'].state == GLYPH_READY) {
+        cache->placeholderAdvance = cache->glyphs['0'].advance;
+    }
+}
+
+void drawGlyphCacheText(SDL_Renderer* renderer, GlyphCache* cache, const std::string& text, int x, int y, SDL_Color color) {
+    requestGlyphs(cache, text);
+    SDL_SetTextureColorMod(cache->atlas, color.r, color.g, color.b);
+    SDL_SetTextureAlphaMod(cache->atlas, color.a);
+
+    int penX = x;
+    for (char c : text) {
+        unsigned char codepoint = static_cast<unsigned char>(c);
+        if (codepoint >= GLYPH_CODEPOINTS) {
+            continue;
+        }
+        CachedGlyph& glyph = cache->glyphs[codepoint];
+        if (glyph.state == GLYPH_READY) {
+            glyph.lastDrawn = cache->frame;
+            if (glyph.source.w > 0) {
+                SDL_Rect destination = { penX + glyph.offsetX, y + glyph.offsetY, glyph.source.w, glyph.source.h };
+                SDL_RenderCopy(renderer, cache->atlas, &glyph.source, &destination);
+            }
+            penX += glyph.advance;
+        }
+        else if (glyph.state == GLYPH_PENDING || glyph.state == GLYPH_NO_ROOM) {
+            if (c != ' ') {
+                // Faint box where the glyph will appear
+                SDL_Rect box = { penX + 1, y + cache->placeholderHeight / 4, cache->placeholderAdvance - 2, cache->placeholderHeight / 2 };
+                SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+                SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, PLACEHOLDER_ALPHA);
+                SDL_RenderFillRect(renderer, &box);
+            }
+            penX += cache->placeholderAdvance;
+        }
+    }
+}
+
+Uint32 getGlyphCacheRevision(const GlyphCache* cache) {
+    return cache->revision;
+}
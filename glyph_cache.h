@@ -0,0 +1,47 @@
+#pragma once
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <string>
+
+// Runtime glyph atlas for a TTF font, filled in the background.
+//
+// Used when no pre-built font atlas is available. The first time a character
+// is drawn it is queued for a worker thread, which rasterizes it with
+// SDL_ttf; finished glyphs are packed into a shared atlas texture a few at a
+// time by updateGlyphCache(). Until its glyph arrives a character is drawn as
+// a faint placeholder box of the expected width, so new text (a score going
+// to two digits, a new HUD string) never stalls a frame on FreeType.
+//
+// When the atlas fills up, glyphs that have not been drawn for a couple of
+// seconds are evicted and the rest are packed again from their kept pixels.
+// A glyph that still finds no room stays a placeholder and is retried once a
+// second, so it appears as soon as other text stops being drawn.
+//
+// The cache takes over the font: after createGlyphCache() only the worker
+// may touch it. All functions must be called from the render thread.
+
+struct GlyphCache;
+
+// Returns nullptr (and prints why) on failure; the font is then still the caller's.
+GlyphCache* createGlyphCache(SDL_Renderer* renderer, TTF_Font* font);
+
+// Stops the worker and closes the font
+void freeGlyphCache(GlyphCache* cache);
+
+// Queues every character of text that is not cached yet, e.g. to warm up HUD strings early
+void requestGlyphs(GlyphCache* cache, const std::string& text);
+
+// Uploads glyphs the worker has finished. Call once per frame before drawing text.
+void updateGlyphCache(GlyphCache* cache);
+
+// Changes whenever updateGlyphCache uploads glyphs, i.e. whenever text drawn
+// earlier may now look different (placeholders replaced by real glyphs)
+Uint32 getGlyphCacheRevision(const GlyphCache* cache);
+
+// Draws text with its line top at (x, y), requesting any missing glyphs
+void drawGlyphCacheText(SDL_Renderer* renderer, GlyphCache* cache, const std::string& text, int x, int y, SDL_Color color);
+
+#endif
@@ -0,0 +1,84 @@
+// Build-time tool: converts PNG (or anything SDL_image reads) to QOI so the
+// game can skip libpng at startup (see image_loader.h).
+//
+// Not part of the game project; build it as its own console program against
+// SDL2 and SDL2_image together with qoi_image.cpp, then run it over the assets
+// whenever they change:
+//
+//   image_converter coin_01.png coin_02.png ... coin_08.png
+//
+// Each input is written next to itself with a .qoi extension. The converted
+// coin_0N.qoi files are checked in; commit them again after rerunning.
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include "qoi_image.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool convertImage(const std::string& inputPath) {
+    SDL_Surface* loaded = IMG_Load(inputPath.c_str());
+    if (loaded == nullptr) {
+        std::cerr << "Failed to load " << inputPath << "! SDL_image Error: " << IMG_GetError() << std::endl;
+        return false;
+    }
+    // RGBA32 is R, G, B, A in memory on every platform, which is what QOI stores
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (rgba == nullptr) {
+        std::cerr << "Failed to convert " << inputPath << "! SDL_Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    std::vector<Uint8> pixels(static_cast<size_t>(rgba->w) * rgba->h * 4);
+    for (int y = 0; y < rgba->h; ++y) {
+        const Uint8* row = static_cast<const Uint8*>(rgba->pixels) + y * rgba->pitch;
+        std::copy(row, row + rgba->w * 4, pixels.begin() + static_cast<size_t>(y) * rgba->w * 4);
+    }
+    std::vector<Uint8> encoded = encodeQoi(pixels.data(), rgba->w, rgba->h);
+    SDL_FreeSurface(rgba);
+
+    std::string outputPath = inputPath;
+    size_t dot = outputPath.find_last_of('.');
+    size_t slash = outputPath.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        outputPath.erase(dot);
+    }
+    outputPath += ".qoi";
+
+    std::ofstream out(outputPath, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+    if (!out) {
+        std::cerr << "Failed to write " << outputPath << "!" << std::endl;
+        return false;
+    }
+    std::cout << inputPath << " -> " << outputPath << " (" << pixels.size() << " bytes raw, "
+              << encoded.size() << " bytes QOI)" << std::endl;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* args[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: image_converter <image.png> [more images...]" << std::endl;
+        return 1;
+    }
+    if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
+        std::cerr << "SDL_image could not initialize! IMG_Error: " << IMG_GetError() << std::endl;
+        return 1;
+    }
+    int failures = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!convertImage(args[i])) {
+            failures++;
+        }
+    }
+    IMG_Quit();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include "image_loader.h"
+#include "mapped_file.h"
+#include "qoi_image.h"
+#include <SDL_image.h> // PNG fallback
+#include <fstream>     // For checking whether a .qoi sibling exists
+#include <iostream>    // For error output
+#include <string>
+#include <vector>
+
+namespace {
+
+// The 32-bit format the renderer takes without converting: ARGB8888 or ABGR8888
+Uint32 nativePixelFormat(SDL_Renderer* renderer) {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0) {
+        for (Uint32 i = 0; i < info.num_texture_formats; ++i) {
+            Uint32 format = info.texture_formats[i];
+            if (format == SDL_PIXELFORMAT_ARGB8888 || format == SDL_PIXELFORMAT_ABGR8888) {
+                return format;
+            }
+        }
+    }
+    return SDL_PIXELFORMAT_ARGB8888;
+}
+
+std::string qoiPathFor(const char* path) {
+    std::string qoiPath = path;
+    size_t dot = qoiPath.find_last_of('.');
+    size_t slash = qoiPath.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        qoiPath.erase(dot);
+    }
+    return qoiPath + ".qoi";
+}
+
+} // namespace
+
+SDL_Texture* createQoiTexture(SDL_Renderer* renderer, const Uint8* data, size_t size, const char* name) {
+    int width, height;
+    if (!readQoiHeader(data, size, width, height)) {
+        std::cerr << "Failed to load " << name << ": not a QOI image!" << std::endl;
+        return nullptr;
+    }
+
+    Uint32 format = nativePixelFormat(renderer);
+    std::vector<Uint32> pixels(static_cast<size_t>(width) * height);
+    if (!decodeQoi(data, size, format, pixels.data())) {
+        std::cerr << "Failed to load " << name << ": corrupt QOI data!" << std::endl;
+        return nullptr;
+    }
+
+    SDL_Texture* texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STATIC, width, height);
+    if (texture == nullptr) {
+        std::cerr << "Failed to create texture for " << name << "! SDL_Error: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+    SDL_UpdateTexture(texture, nullptr, pixels.data(), width * static_cast<int>(sizeof(Uint32)));
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND); // Same as IMG_LoadTexture for images with alpha
+    return texture;
+}
+
+SDL_Texture* loadQoiTexture(SDL_Renderer* renderer, const char* path) {
+    MappedFile file;
+    if (!mapFile(path, file)) {
+        return nullptr;
+    }
+    SDL_Texture* texture = createQoiTexture(renderer, file.data, file.size, path);
+    unmapFile(file);
+    return texture;
+}
+
+SDL_Texture* loadImageTexture(SDL_Renderer* renderer, const char* path) {
+    std::string qoiPath = qoiPathFor(path);
+    if (std::ifstream(qoiPath, std::ios::binary).good()) {
+        SDL_Texture* texture = loadQoiTexture(renderer, qoiPath.c_str());
+        if (texture) {
+            return texture;
+        }
+        // A broken .qoi falls back to the original image
+    }
+    SDL_Texture* texture = IMG_LoadTexture(renderer, path);
+    if (texture == nullptr) {
+        std::cerr << "Failed to load " << path << "! SDL_image Error: " << IMG_GetError() << std::endl;
+    }
+    return texture;
+}
+
+SDL_Surface* loadImageSurface(const char* path) {
+    std::string qoiPath = qoiPathFor(path);
+    MappedFile file;
+    int width, height;
+    if (std::ifstream(qoiPath, std::ios::binary).good() && mapFile(qoiPath.c_str(), file)) {
+        if (readQoiHeader(file.data, file.size, width, height)) {
+            SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+            if (surface && decodeQoi(file.data, file.size, SDL_PIXELFORMAT_ARGB8888, static_cast<Uint32*>(surface->pixels))) {
+                unmapFile(file);
+                return surface; // 32-bit surfaces have no row padding, so the decoder can write straight in
+            }
+            SDL_FreeSurface(surface);
+        }
+        unmapFile(file);
+        // A broken .qoi falls back to the original image
+    }
+    SDL_Surface* surface = IMG_Load(path);
+    if (surface == nullptr) {
+        std::cerr << "Failed to load " << path << "! SDL_image Error: " << IMG_GetError() << std::endl;
+    }
+    return surface;
+}
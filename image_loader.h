@@ -0,0 +1,31 @@
+#pragma once
+#ifndef IMAGE_LOADER_H
+#define IMAGE_LOADER_H
+
+#include <SDL.h>
+#include <cstddef>
+
+// Texture loading that prefers pre-converted QOI files over PNG.
+//
+// image_converter turns each PNG into a .qoi file next to it. At runtime the
+// .qoi file is memory-mapped and decoded straight into the renderer's native
+// 32-bit pixel format, so the upload needs no conversion pass and libpng never
+// runs. If the .qoi file is missing the PNG is loaded through SDL_image as
+// before.
+
+// Loads path (a .png) through its .qoi sibling when one exists. Returns nullptr
+// on failure, with the error printed.
+SDL_Texture* loadImageTexture(SDL_Renderer* renderer, const char* path);
+
+// Loads a .qoi file directly. Returns nullptr on failure, with the error printed.
+SDL_Texture* loadQoiTexture(SDL_Renderer* renderer, const char* path);
+
+// Like loadImageTexture, but into a CPU-side surface (for software blitting).
+// Returns nullptr on failure, with the error printed.
+SDL_Surface* loadImageSurface(const char* path);
+
+// Decodes QOI data already in memory (e.g. embedded in another asset file).
+// name is only used in error messages.
+SDL_Texture* createQoiTexture(SDL_Renderer* renderer, const Uint8* data, size_t size, const char* name);
+
+#endif
@@ -0,0 +1,89 @@
+#include "layer_cache.h"
+#include <iostream> // For error output
+
+bool initCachedLayer(CachedLayer& layer, SDL_Renderer* renderer, const SDL_Rect& area) {
+    freeCachedLayer(layer);
+    layer.area = area;
+    if (!SDL_RenderTargetSupported(renderer)) {
+        std::cerr << "Renderer cannot draw into textures; layers are drawn every frame." << std::endl;
+        return false;
+    }
+    layer.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, area.w, area.h);
+    if (layer.texture == nullptr) {
+        std::cerr << "Failed to create layer texture! SDL_Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    // Content is drawn onto transparent pixels, which leaves its colors multiplied
+    // by alpha, so composite it premultiplied. Renderers without custom blend
+    // modes (software) fall back to plain blending: edges come out a touch darker.
+    SDL_BlendMode premultiplied = SDL_ComposeCustomBlendMode(
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+    if (SDL_SetTextureBlendMode(layer.texture, premultiplied) != 0) {
+        SDL_SetTextureBlendMode(layer.texture, SDL_BLENDMODE_BLEND);
+    }
+    return true;
+}
+
+void freeCachedLayer(CachedLayer& layer) {
+    if (layer.texture) {
+        SDL_DestroyTexture(layer.texture);
+        layer.texture = nullptr;
+    }
+    layer.valid = false;
+}
+
+bool beginCachedLayer(CachedLayer& layer, SDL_Renderer* renderer, Uint64 version) {
+    if (layer.texture == nullptr) {
+        SDL_RenderSetViewport(renderer, &layer.area);
+        return true;
+    }
+    if (layer.valid && layer.version == version) {
+        return false;
+    }
+    if (layer.valid && layer.minRedrawMs > 0 && SDL_GetTicks() - layer.redrawnAt < layer.minRedrawMs) {
+        return false; // Picked up once the interval has passed, since the version still differs
+    }
+    layer.previousTarget = SDL_GetRenderTarget(renderer);
+    SDL_RenderGetViewport(renderer, &layer.previousViewport);
+    SDL_RenderGetScale(renderer, &layer.previousScaleX, &layer.previousScaleY);
+    if (SDL_SetRenderTarget(renderer, layer.texture) != 0) {
+        std::cerr << "Failed to render into layer! SDL_Error: " << SDL_GetError() << std::endl;
+        freeCachedLayer(layer); // Keep drawing, just without the cache
+        SDL_RenderSetViewport(renderer, &layer.area);
+        return true;
+    }
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    layer.version = version;
+    layer.redrawnAt = SDL_GetTicks();
+    return true;
+}
+
+void endCachedLayer(CachedLayer& layer, SDL_Renderer* renderer) {
+    if (layer.texture == nullptr) {
+        SDL_RenderSetViewport(renderer, NULL);
+        return;
+    }
+    SDL_SetRenderTarget(renderer, layer.previousTarget);
+    // Only the window's scale and viewport come back by themselves, not a texture target's
+    SDL_RenderSetScale(renderer, layer.previousScaleX, layer.previousScaleY);
+    SDL_RenderSetViewport(renderer, &layer.previousViewport);
+    layer.previousTarget = nullptr;
+    layer.valid = true;
+}
+
+void drawCachedLayer(const CachedLayer& layer, SDL_Renderer* renderer) {
+    if (layer.texture == nullptr || !layer.valid) {
+        return; // Drawn directly in begin/end
+    }
+    SDL_RenderCopy(renderer, layer.texture, NULL, &layer.area);
+}
+
+void invalidateCachedLayer(CachedLayer& layer) {
+    layer.valid = false;
+}
+
+void setCachedLayerRedrawInterval(CachedLayer& layer, Uint32 ms) {
+    layer.minRedrawMs = ms;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef LAYER_CACHE_H
+#define LAYER_CACHE_H
+
+#include <SDL.h>
+
+// Cached layers for parts of the frame that rarely change (score panels, HUD).
+//
+// A layer's content is drawn into a render-target texture and only redrawn
+// when its version changes; every other frame the layer costs one
+// SDL_RenderCopy. The version is any number the caller derives from what the
+// layer shows (the scores, the number of lives), so a changed value redraws
+// the layer on the frame it changes.
+//
+//     if (beginCachedLayer(layer, renderer, version)) {
+//         ...draw the layer's content, in layer coordinates...
+//         endCachedLayer(layer, renderer);
+//     }
+//     drawCachedLayer(layer, renderer);
+//
+// Content is drawn in layer coordinates: (0, 0) is the top-left corner of
+// the layer's area. Without render-target support (or after texture creation
+// fails) begin always returns true and draws go straight to the screen
+// through a viewport over the area (end resets the viewport), so callers do
+// not need a second path.
+
+struct CachedLayer {
+    SDL_Rect area = { 0, 0, 0, 0 }; // Where the layer sits on screen
+    SDL_Texture* texture = nullptr; // nullptr without render targets: the layer is drawn every frame
+    Uint64 version = 0;
+    bool valid = false; // texture holds the content for version
+    Uint32 minRedrawMs = 0; // See setCachedLayerRedrawInterval
+    Uint32 redrawnAt = 0;   // SDL_GetTicks() of the last redraw
+    SDL_Texture* previousTarget = nullptr;
+    SDL_Rect previousViewport = { 0, 0, 0, 0 }; // Switching targets resets these; end restores them
+    float previousScaleX = 1.0f, previousScaleY = 1.0f;
+};
+
+// Creates the layer's texture for area. Returns false (and prints why) if the
+// renderer cannot render to textures; the layer then draws directly.
+bool initCachedLayer(CachedLayer& layer, SDL_Renderer* renderer, const SDL_Rect& area);
+
+void freeCachedLayer(CachedLayer& layer);
+
+// Returns true if the content must be drawn now, with rendering redirected
+// into the layer (cleared to transparent). Call endCachedLayer afterwards.
+bool beginCachedLayer(CachedLayer& layer, SDL_Renderer* renderer, Uint64 version);
+
+void endCachedLayer(CachedLayer& layer, SDL_Renderer* renderer);
+
+// Composites the layer onto the current target with one copy
+void drawCachedLayer(const CachedLayer& layer, SDL_Renderer* renderer);
+
+// Forces a redraw, e.g. after SDL_RENDER_TARGETS_RESET lost the texture contents
+void invalidateCachedLayer(CachedLayer& layer);
+
+// Redraws at most once every ms milliseconds (0, the default: on every
+// version change). A version that changes sooner keeps showing the previous
+// content until the interval has passed. Does not delay invalidated layers.
+void setCachedLayerRedrawInterval(CachedLayer& layer, Uint32 ms);
+
+#endif
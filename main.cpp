@@ -3,159 +3,182 @@
 #include <SDL_image.h> // For image loading
 #include <SDL_ttf.h>   // For text rendering
 #include <iostream>
-#include <cmath>
 #include <cstdlib>
 #include <ctime>
-#include <algorithm>
-#include <vector> // For coins
-#include <string> // For std::to_string
-
-#include "coin.h" // Include your coin system header
+#include <string>
+#include <vector>
+
+#include "game_context.h" // Engine (shared assets) and match (game state) contexts
+#include "audio_mixer.h" // Positional sound effects
+#include "music_stream.h" // Streaming background music
+#include "match_host.h" // Many bot matches in one process
+#include "video_recorder.h" // Gameplay capture to .y4m
+#include "replay.h" // Seed and per-tick input of the match, for replay_renderer
+#include "renderer_select.h" // Render driver chosen by a startup benchmark
+#include "postfx.h" // Bloom, ball trails and scanlines for the attract mode
+#include "quality_governor.h" // Lowers quality when frames take too long
 
 // --- Constants ---
-const int WINDOW_WIDTH = 800;
-const int WINDOW_HEIGHT = 600;
-
-const int BALL_DIAMETER = 30;
-const int BALL_RADIUS = BALL_DIAMETER / 2;
-const float INITIAL_BALL_SPEED = 4.0f;
-float current_ball_speed = INITIAL_BALL_SPEED;
-const float BALL_BOOST_FACTOR = 1.2f;
-const int BALL_BOOST_DURATION_FRAMES = 30;
-int ball_boost_timer = 0;
-
-const int PADDLE_WIDTH = 20;
-const int PADDLE_HEIGHT = 100;
-const float PADDLE_SPEED = 6.0f;
-
-const float COIN_DRAW_SCALE = 0.8f; // Scale for drawing coins
-const int COIN_APPEAR_INTERVAL_FRAMES = 300; // Roughly 5 seconds at 60 FPS
-const int COIN_DURATION_FRAMES = 600; // Roughly 10 seconds at 60 FPS
-
-// --- Game State Variables ---
-float ball_x = WINDOW_WIDTH / 2.0f;
-float ball_y = WINDOW_HEIGHT / 2.0f;
-float ball_dx = 0.0f;
-float ball_dy = 0.0f;
-
-SDL_Rect leftPaddle = {
-    0,
-    (WINDOW_HEIGHT - PADDLE_HEIGHT) / 2,
-    PADDLE_WIDTH,
-    PADDLE_HEIGHT
-};
-
-SDL_Rect rightPaddle = {
-    WINDOW_WIDTH - PADDLE_WIDTH,
-    (WINDOW_HEIGHT - PADDLE_HEIGHT) / 2,
-    PADDLE_WIDTH,
-    PADDLE_HEIGHT
-};
-
-struct Coin {
-    float x, y;
-    int timer;
-    // 'active' is now implicit: if it's in the vector, it's active.
-    // If its timer runs out, it's removed from the vector.
-};
-std::vector<Coin> coins;
-int coin_spawn_timer = 0;
-
-// Score variables
-int left_score = 0;
-int right_score = 0;
-
-// For scoring rule 1: consecutive hits
-enum class LastHit { None, LeftPaddle, RightPaddle };
-LastHit last_ball_hit = LastHit::None;
-int left_consecutive_hits = 0;
-int right_consecutive_hits = 0;
-
-// --- Audio ---
-Mix_Chunk* coin_sound = nullptr;
-
-// --- Text Rendering ---
-TTF_Font* gFont = nullptr;
-SDL_Color textColor = { 255, 255, 255, 255 }; // White color for text
-
-// --- Function Declarations ---
-void drawFilledCircle(SDL_Renderer* renderer, int centerX, int centerY, int radius, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
-bool checkCircleRectCollision(float circleX, float circleY, int circleRadius, const SDL_Rect& rect);
-bool checkRectRectCollision(const SDL_Rect& rect1, const SDL_Rect& rect2);
-void spawnCoin();
-void playCoinSound();
-void renderText(SDL_Renderer* renderer, const std::string& text, int x, int y, SDL_Color color);
-
-
-// --- Function Definitions ---
-void drawFilledCircle(SDL_Renderer* renderer, int centerX, int centerY, int radius, Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
-    SDL_SetRenderDrawColor(renderer, r, g, b, a);
-    for (int y = -radius; y <= radius; y++) {
-        int x = static_cast<int>(sqrt(static_cast<float>(radius * radius - y * y)));
-        SDL_RenderDrawLine(renderer, centerX - x, centerY + y, centerX + x, centerY + y);
+const Uint32 SOFTWARE_FRAME_MS = 16; // Frame pacing for software rendering (about 60 FPS, like VSync)
+const float MUSIC_VOLUME = 0.5f;        // Keeps the music under the sound effects
+const Uint32 HOST_TICK_MS = 16;         // Simulation rate of hosted matches (about 60 ticks per second)
+const Uint32 HOST_STATUS_INTERVAL_MS = 5000;
+const int RECORD_FPS = 60;
+const float TARGET_FPS = 60.0f; // What the quality governor holds
+
+// Runs count bot matches without a window until the process is interrupted.
+// With broadcasting, match i is streamed on basePort + i; with desyncCheck
+// each stream carries the state hashes and inputs spectators check against.
+int runMatchHost(int count, bool broadcast, uint16_t basePort, bool desyncCheck) {
+    if (SDL_Init(SDL_INIT_TIMER | SDL_INIT_EVENTS) < 0) {
+        std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+        return 1;
     }
-}
-
-bool checkCircleRectCollision(float circleX, float circleY, int circleRadius, const SDL_Rect& rect) {
-    float closestX = std::max(static_cast<float>(rect.x), std::min(circleX, static_cast<float>(rect.x + rect.w)));
-    float closestY = std::max(static_cast<float>(rect.y), std::min(circleY, static_cast<float>(rect.y + rect.h)));
-
-    float distanceX = circleX - closestX;
-    float distanceY = circleY - closestY;
-
-    return (distanceX * distanceX + distanceY * distanceY) < (circleRadius * circleRadius);
-}
 
-bool checkRectRectCollision(const SDL_Rect& rect1, const SDL_Rect& rect2) {
-    return SDL_HasIntersection(&rect1, &rect2);
-}
+    EngineContext engine; // Nothing to draw or play: no renderer, no sounds
+    MatchHost host;
+    host.engine = &engine;
+    uint32_t seed = static_cast<uint32_t>(time(0));
+    for (int i = 0; i < count; ++i) {
+        MatchContext* match = addHostedMatch(host, seed + i);
+        if (desyncCheck) {
+            enableDesyncCheck(*match);
+        }
+        if (broadcast && !openMatchBroadcast(*match, static_cast<uint16_t>(basePort + i))) {
+            std::cerr << "Match " << i << " will not be broadcast." << std::endl;
+        }
+    }
+    std::cout << "Hosting " << count << " matches (" << sizeof(MatchContext) << " bytes of state each)." << std::endl;
 
+    bool quit = false;
+    SDL_Event e;
+    Uint32 nextTick = SDL_GetTicks();
+    Uint32 nextStatus = nextTick + HOST_STATUS_INTERVAL_MS;
+    uint32_t ticks = 0;
+    while (!quit) {
+        while (SDL_PollEvent(&e) != 0) {
+            if (e.type == SDL_QUIT) { // Ctrl+C
+                quit = true;
+            }
+        }
 
-void spawnCoin() {
-    // Ensure coin is spawned within bounds and not too close to paddles
-    // Coin size will depend on COIN_FRAME_WIDTH * COIN_DRAW_SCALE
-    int coinEffectiveWidth = getCoinRenderedWidth(COIN_DRAW_SCALE);
-    int coinEffectiveHeight = getCoinRenderedHeight(COIN_DRAW_SCALE);
+        Uint32 now = SDL_GetTicks();
+        if (static_cast<Sint32>(now - nextTick) < 0) {
+            SDL_Delay(nextTick - now);
+            continue;
+        }
+        stepHostedMatches(host, now);
+        ticks++;
+        nextTick += HOST_TICK_MS;
+        if (static_cast<Sint32>(now - nextTick) > static_cast<Sint32>(HOST_TICK_MS * 4)) {
+            nextTick = now; // Fell far behind: drop the backlog instead of running it in a burst
+        }
 
-    // Random X position: from PADDLE_WIDTH + coinEffectiveWidth/2 to WINDOW_WIDTH - PADDLE_WIDTH - coinEffectiveWidth/2
-    float coin_x = static_cast<float>(rand() % (WINDOW_WIDTH - 2 * PADDLE_WIDTH - coinEffectiveWidth) + PADDLE_WIDTH + coinEffectiveWidth / 2);
-    // Random Y position: from coinEffectiveHeight/2 to WINDOW_HEIGHT - coinEffectiveHeight/2
-    float coin_y = static_cast<float>(rand() % (WINDOW_HEIGHT - coinEffectiveHeight) + coinEffectiveHeight / 2);
+        if (static_cast<Sint32>(now - nextStatus) >= 0) {
+            const MatchContext& first = *host.matches.front();
+            std::cout << "Tick " << ticks << ": match 0 score " << first.leftScore << " - " << first.rightScore << std::endl;
+            nextStatus += HOST_STATUS_INTERVAL_MS;
+        }
+    }
 
-    coins.push_back({ coin_x, coin_y, COIN_DURATION_FRAMES });
+    closeMatchHost(host);
+    SDL_Quit();
+    return 0;
 }
 
-void playCoinSound() {
-    if (coin_sound) {
-        Mix_PlayChannel(-1, coin_sound, 0); // Play on first available channel, once
+// --- Main Function ---
+int main(int argc, char* args[]) {
+    EngineContext engine; // Assets, loaded once the renderer exists
+    MatchContext match(&engine);
+    const char* music_track = nullptr; // Set by --music; looped for the whole session
+    bool broadcast = false;
+    uint16_t broadcast_port = DEFAULT_SPECTATOR_PORT;
+    int hosted_matches = 0; // Set by --host; runs without a window
+    bool desync_check = false; // Set by --desync-check
+    int wall_columns = 0, wall_rows = 0; // Set by --wall; bot matches drawn as a grid
+    const char* record_path = nullptr; // Set by --record
+    const char* replay_path = nullptr; // Set by --save-replay
+    bool reprobe_renderer = false; // Set by --probe-renderer
+    bool post_effects = false; // Set by --postfx
+    const char* quality_log_path = nullptr; // Set by --quality-log
+
+    // Command line options:
+    //   --broadcast [port]        stream this match to spectators
+    //   --spectate <host> [port]  watch a match streamed by another instance
+    //   --desync-check            hash the game state every tick: with --broadcast the
+    //                             hashes go to spectators, with --spectate the match is
+    //                             re-simulated and checked against the host's
+    //   --music <file.wav>        loop a background music track
+    //   --host <count>            run count bot matches without a window (with
+    //                             --broadcast, match i is streamed on port + i;
+    //                             --desync-check applies to every one of them)
+    //   --wall <columns> <rows>   watch a grid of bot matches in one window
+    //   --record <file.y4m>       record the window at 60 FPS
+    //   --save-replay <file>      save the match's seed and inputs on exit
+    //   --probe-renderer          measure the render drivers again instead of using the cached choice
+    //   --postfx                  kiosk attract mode: bloom, ball trails and CRT scanlines
+    //   --quality-log <file.csv>  write every decision of the quality governor
+    for (int i = 1; i < argc; ++i) {
+        std::string option = args[i];
+        if (option == "--broadcast") {
+            broadcast = true;
+            if (i + 1 < argc && args[i + 1][0] != '-') {
+                broadcast_port = static_cast<uint16_t>(atoi(args[++i]));
+            }
+        }
+        else if (option == "--desync-check") {
+            desync_check = true;
+        }
+        else if (option == "--music" && i + 1 < argc) {
+            music_track = args[++i];
+        }
+        else if (option == "--host" && i + 1 < argc) {
+            hosted_matches = atoi(args[++i]);
+        }
+        else if (option == "--save-replay" && i + 1 < argc) {
+            replay_path = args[++i];
+        }
+        else if (option == "--probe-renderer") {
+            reprobe_renderer = true;
+        }
+        else if (option == "--postfx") {
+            post_effects = true;
+        }
+        else if (option == "--quality-log" && i + 1 < argc) {
+            quality_log_path = args[++i];
+        }
+        else if (option == "--record" && i + 1 < argc) {
+            record_path = args[++i];
+        }
+        else if (option == "--wall" && i + 2 < argc) {
+            wall_columns = atoi(args[++i]);
+            wall_rows = atoi(args[++i]);
+        }
+        else if (option == "--spectate" && i + 1 < argc) {
+            const char* host = args[++i];
+            uint16_t port = DEFAULT_SPECTATOR_PORT;
+            if (i + 1 < argc && args[i + 1][0] != '-') {
+                port = static_cast<uint16_t>(atoi(args[++i]));
+            }
+            if (!connectMatchSpectator(match, host, port)) {
+                return 1;
+            }
+        }
     }
-}
 
-void renderText(SDL_Renderer* renderer, const std::string& text, int x, int y, SDL_Color color) {
-    if (!gFont) {
-        std::cerr << "Font not loaded! Cannot render text." << std::endl;
-        return;
+    bool wall = wall_columns > 0 && wall_rows > 0;
+    if (hosted_matches > 0) {
+        closeMatch(match); // Unused; frees anything the options allocated
+        return runMatchHost(hosted_matches, broadcast, broadcast_port, desync_check);
     }
-    SDL_Surface* textSurface = TTF_RenderText_Solid(gFont, text.c_str(), color);
-    if (!textSurface) {
-        std::cerr << "Unable to render text surface! SDL_ttf Error: " << TTF_GetError() << std::endl;
-        return;
+    if (desync_check) {
+        enableDesyncCheck(match);
     }
-    SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-    if (!textTexture) {
-        std::cerr << "Unable to create texture from rendered text! SDL Error: " << SDL_GetError() << std::endl;
+    if (broadcast && !openMatchBroadcast(match, broadcast_port)) {
+        std::cerr << "Spectator broadcast disabled." << std::endl;
+        // The game can continue without spectators
     }
-    else {
-        SDL_Rect renderQuad = { x, y, textSurface->w, textSurface->h };
-        SDL_RenderCopy(renderer, textTexture, NULL, &renderQuad);
-    }
-    SDL_FreeSurface(textSurface);
-    SDL_DestroyTexture(textTexture);
-}
 
-
-// --- Main Function ---
-int main(int argc, char* args[]) {
     // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
         std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
@@ -177,18 +200,6 @@ int main(int argc, char* args[]) {
         return 1;
     }
 
-    // Initialize SDL_ttf for text rendering (scores)
-    if (TTF_Init() == -1) {
-        std::cerr << "SDL_ttf could not initialize! SDL_ttf Error: " << TTF_GetError() << std::endl;
-        Mix_Quit();
-        IMG_Quit();
-        SDL_Quit();
-        return 1;
-    }
-
-    // Seed random number generator for coin spawning
-    srand(static_cast<unsigned int>(time(0)));
-
     // Create window
     SDL_Window* window = SDL_CreateWindow(
         "Pong Clone with Animated Coins",
@@ -200,360 +211,240 @@ int main(int argc, char* args[]) {
     );
     if (window == nullptr) {
         std::cerr << "Window could not be created! SDL_Error: " << SDL_GetError() << std::endl;
-        TTF_Quit();
         Mix_Quit();
         IMG_Quit();
         SDL_Quit();
         return 1;
     }
 
-    // Create renderer
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    // Create renderer. Batching queues viewport and scale changes with the draws,
+    // so a whole wall of matches goes to the GPU in one pass. The driver is the one
+    // that ran a game-like workload fastest on this machine; when that is software
+    // rendering, it draws straight into the window surface so sprites can be blitted there.
+    SDL_SetHint(SDL_HINT_RENDER_BATCHING, "1");
+    SDL_Surface* software_target = nullptr; // Window surface, when drawing without a GPU
+    SDL_Renderer* renderer = createFastestRenderer(window, SDL_RENDERER_PRESENTVSYNC, &software_target, reprobe_renderer);
     if (renderer == nullptr) {
-        std::cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError() << std::endl;
         SDL_DestroyWindow(window);
-        TTF_Quit();
         Mix_Quit();
         IMG_Quit();
         SDL_Quit();
         return 1;
     }
 
-    // Initialize the coin system (this will load coin_01.png to coin_08.png)
-    if (!initCoinSystem(renderer)) {
-        std::cerr << "Failed to initialize coin system. Exiting." << std::endl;
-        // Perform comprehensive cleanup if coin system initialization fails
+    // Start mixing before the engine loads its assets, so it synthesizes the sound effects
+    if (initAudioMixer() && music_track && initMusicStreaming()) {
+        setMusicVolume(MUSIC_VOLUME);
+        playMusic(music_track, DEFAULT_MUSIC_CROSSFADE, true);
+    }
+
+    // Load the shared assets: coin frames, sound effects and the score font
+    // (RLE coin blits cannot follow the wall's viewports, so a wall draws coins through the renderer)
+    if (!initEngine(engine, renderer, wall ? nullptr : software_target)) {
+        std::cerr << "Failed to initialize the engine. Exiting." << std::endl;
+        // Perform comprehensive cleanup if asset loading fails
+        closeMusicStreaming();
+        closeAudioMixer();
+        closeEngine(engine);
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
-        TTF_Quit();
         Mix_Quit();
         IMG_Quit();
         SDL_Quit();
         return 1;
     }
 
-    // Load coin sound effect
-    coin_sound = Mix_LoadWAV("coin_sound.mp3");
-    if (coin_sound == nullptr) {
-        std::cerr << "Failed to load coin_sound.mp3! SDL_mixer Error: " << Mix_GetError() << std::endl;
-        // The game can continue without sound if it fails to load
+    // Seed the match's random generator for coin spawning and serves, and start its scripts
+    Replay replay;
+    replay.seed = static_cast<uint32_t>(time(0));
+    startMatch(match, replay.seed);
+
+    // A wall replaces the interactive match with bot matches sharing the engine
+    MatchHost wall_host;
+    wall_host.engine = &engine;
+    for (int i = 0; wall && i < wall_columns * wall_rows; ++i) {
+        addHostedMatch(wall_host, static_cast<uint32_t>(time(0)) + i);
+    }
+
+    // The score panel is rendered into a texture and only redrawn when a score changes
+    CachedLayer score_layer;
+    if (!wall) {
+        initScoreLayer(score_layer, renderer);
+    }
+
+    // Frames are copied out before presenting; conversion and writing happen on worker threads
+    VideoRecorder* recorder = nullptr;
+    if (record_path) {
+        int output_width, output_height;
+        if (SDL_GetRendererOutputSize(renderer, &output_width, &output_height) == 0) {
+            recorder = startVideoRecording(record_path, output_width & ~1, output_height & ~1, RECORD_FPS);
+        }
+        if (recorder == nullptr) {
+            std::cerr << "Recording disabled." << std::endl;
+        }
     }
 
-    // Load font for score display
-    gFont = TTF_OpenFont("arial.ttf", 24); // Make sure "arial.ttf" is accessible, or use your own font file
-    if (gFont == nullptr) {
-        std::cerr << "Failed to load font! SDL_ttf Error: " << TTF_GetError() << std::endl;
-        // The game can continue without text if font fails to load
+    // The effects run on the CPU over the finished frame: in place on the window
+    // surface, or on a copy read back from the GPU and drawn over the frame again
+    PostProcessor* post = nullptr;
+    SDL_Texture* post_texture = nullptr;
+    std::vector<Uint32> post_pixels;
+    int post_width = 0;
+    if (post_effects) {
+        int output_width, output_height;
+        if (software_target && software_target->format->format != SDL_PIXELFORMAT_ARGB8888 &&
+            software_target->format->format != SDL_PIXELFORMAT_RGB888) {
+            std::cerr << "Post effects need a 32-bit RGB window surface, not "
+                      << SDL_GetPixelFormatName(software_target->format->format) << "." << std::endl;
+        }
+        else if (SDL_GetRendererOutputSize(renderer, &output_width, &output_height) == 0) {
+            if (software_target == nullptr) {
+                post_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, output_width, output_height);
+                post_pixels.resize(static_cast<size_t>(output_width) * output_height);
+                SDL_SetTextureBlendMode(post_texture, SDL_BLENDMODE_NONE); // Replaces the frame it was read from
+            }
+            if (software_target || post_texture) {
+                post_width = output_width;
+                post = createPostProcessor(output_width, output_height, PostFxSettings());
+            }
+            else {
+                std::cerr << "Post effects texture could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+            }
+        }
+        if (post == nullptr) {
+            std::cerr << "Post effects disabled." << std::endl;
+        }
     }
 
+    // Frame time percentiles pick the quality: effects, render resolution,
+    // off-focus animation on the wall and score text redraws. The software
+    // renderer keeps full resolution: RLE coins are blitted into the window surface.
+    QualityGovernor governor;
+    initQualityGovernor(governor, "Pong", TARGET_FPS);
+    if (quality_log_path) {
+        openQualityTelemetry(governor, quality_log_path);
+    }
+    SceneTarget scene;
+    Uint64 last_frame_end = SDL_GetPerformanceCounter();
+    const double counter_ms = 1000.0 / SDL_GetPerformanceFrequency();
 
     bool quit = false;
     SDL_Event e;
 
     // Main game loop
     while (!quit) {
+        bool launched = false;
+        Uint64 frame_start = SDL_GetPerformanceCounter();
+
         // --- Event Handling ---
         while (SDL_PollEvent(&e) != 0) {
             if (e.type == SDL_QUIT) {
                 quit = true;
             }
-            else if (e.type == SDL_MOUSEBUTTONDOWN) {
-                // Ball launch logic on click (only if the ball is currently stationary)
-                if (ball_dx == 0.0f && ball_dy == 0.0f) {
-                    int mouseX = e.button.x;
-                    int mouseY = e.button.y;
-
-                    // Check if the click was on the ball
-                    float distance = sqrt(pow(mouseX - ball_x, 2) + pow(mouseY - ball_y, 2));
-
-                    if (distance <= BALL_RADIUS) {
-                        float angle;
-                        do {
-                            // Generate a random angle, ensuring it's not too flat or too steep (to keep gameplay engaging)
-                            angle = static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * 2.0f * M_PI;
-                        } while (std::abs(std::sin(angle)) < 0.2f || std::abs(std::cos(angle)) < 0.2f); // Avoid angles too close to 0, 90, 180, 270 degrees
-
-                        ball_dx = cos(angle);
-                        ball_dy = sin(angle);
-
-                        // Normalize the direction vector to maintain a consistent speed
-                        float magnitude = sqrt(ball_dx * ball_dx + ball_dy * ball_dy);
-                        if (magnitude != 0) {
-                            ball_dx /= magnitude;
-                            ball_dy /= magnitude;
-                        }
-
-                        current_ball_speed = INITIAL_BALL_SPEED; // Reset to initial speed on launch
-                        ball_boost_timer = 0; // Clear any boost timer
-                    }
-                }
+            else if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET) {
+                invalidateCachedLayer(score_layer); // Texture contents were lost
+            }
+            else if (e.type == SDL_MOUSEBUTTONDOWN && !wall) {
+                launched |= handleMatchClick(match, e.button.x, e.button.y); // Launches the ball if it was clicked while stationary
             }
         }
 
-        // --- Paddle Movement ---
-        const Uint8* currentKeyStates = SDL_GetKeyboardState(NULL);
-
-        // Left paddle movement (W, S keys)
-        if (currentKeyStates[SDL_SCANCODE_W]) {
-            leftPaddle.y -= PADDLE_SPEED;
-        }
-        if (currentKeyStates[SDL_SCANCODE_S]) {
-            leftPaddle.y += PADDLE_SPEED;
-        }
-
-        // Right paddle movement (Up, Down arrow keys)
-        if (currentKeyStates[SDL_SCANCODE_UP]) {
-            rightPaddle.y -= PADDLE_SPEED;
-        }
-        if (currentKeyStates[SDL_SCANCODE_DOWN]) {
-            rightPaddle.y += PADDLE_SPEED;
-        }
-
-        // Clamp paddles within vertical bounds of the window
-        if (leftPaddle.y < 0) leftPaddle.y = 0;
-        if (leftPaddle.y + PADDLE_HEIGHT > WINDOW_HEIGHT) leftPaddle.y = WINDOW_HEIGHT - PADDLE_HEIGHT;
-
-        if (rightPaddle.y < 0) rightPaddle.y = 0;
-        if (rightPaddle.y + PADDLE_HEIGHT > WINDOW_HEIGHT) rightPaddle.y = WINDOW_HEIGHT - PADDLE_HEIGHT;
-
-        // --- Ball Movement ---
-        ball_x += ball_dx * current_ball_speed;
-        ball_y += ball_dy * current_ball_speed;
-
-        bool reflected_this_frame = false;
-
-        // --- Wall Collisions (top and bottom) ---
-        if (ball_y + BALL_RADIUS > WINDOW_HEIGHT) {
-            ball_y = WINDOW_HEIGHT - BALL_RADIUS; // Reposition to prevent sticking
-            ball_dy = -std::abs(ball_dy); // Reverse Y direction
-            reflected_this_frame = true;
+        if (wall) {
+            stepHostedMatches(wall_host, SDL_GetTicks());
         }
-        else if (ball_y - BALL_RADIUS < 0) {
-            ball_y = BALL_RADIUS; // Reposition
-            ball_dy = std::abs(ball_dy); // Reverse Y direction
-            reflected_this_frame = true;
-        }
-
-        // --- Paddle Collisions ---
-        // Left Paddle Collision
-        if (ball_dx < 0 && checkCircleRectCollision(ball_x, ball_y, BALL_RADIUS, leftPaddle)) {
-            ball_x = leftPaddle.x + PADDLE_WIDTH + BALL_RADIUS; // Push ball out to prevent sticking
-            ball_dx = std::abs(ball_dx); // Reverse X direction
-            reflected_this_frame = true;
-            playCoinSound(); // Play a sound on paddle hit
-
-            // Scoring Rule 1: Consecutive hits for the left player
-            if (last_ball_hit == LastHit::LeftPaddle) {
-                left_consecutive_hits++;
-                if (left_consecutive_hits >= 2) {
-                    left_score++; // Award point for 2 consecutive hits
-                    left_consecutive_hits = 0; // Reset after scoring
-                }
-            }
-            else {
-                left_consecutive_hits = 1; // Start a new consecutive streak
-                right_consecutive_hits = 0; // Reset opponent's streak
-            }
-            last_ball_hit = LastHit::LeftPaddle;
-
-        }
-        // Right Paddle Collision
-        else if (ball_dx > 0 && checkCircleRectCollision(ball_x, ball_y, BALL_RADIUS, rightPaddle)) {
-            ball_x = rightPaddle.x - BALL_RADIUS; // Push ball out to prevent sticking
-            ball_dx = -std::abs(ball_dx); // Reverse X direction
-            reflected_this_frame = true;
-            playCoinSound(); // Play a sound on paddle hit
-
-            // Scoring Rule 1: Consecutive hits for the right player
-            if (last_ball_hit == LastHit::RightPaddle) {
-                right_consecutive_hits++;
-                if (right_consecutive_hits >= 2) {
-                    right_score++; // Award point for 2 consecutive hits
-                    right_consecutive_hits = 0; // Reset after scoring
-                }
-            }
-            else {
-                right_consecutive_hits = 1; // Start a new consecutive streak
-                left_consecutive_hits = 0; // Reset opponent's streak
-            }
-            last_ball_hit = LastHit::RightPaddle;
-        }
-
-        // --- Out of Bounds (Scoring and Ball Reset) ---
-        // Ball goes past left paddle (right player scores)
-        if (ball_x - BALL_RADIUS < 0) {
-            right_score++;
-            // Reset ball to center of the screen
-            ball_x = WINDOW_WIDTH / 2.0f;
-            ball_y = WINDOW_HEIGHT / 2.0f;
-            // Set a new random initial direction for the next serve
-            float angle;
-            do {
-                angle = static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * 2.0f * M_PI;
-            } while (std::abs(std::sin(angle)) < 0.2f || std::abs(std::cos(angle)) < 0.2f);
-            ball_dx = cos(angle);
-            ball_dy = sin(angle);
-
-            // Normalize the direction vector
-            float magnitude = sqrt(ball_dx * ball_dx + ball_dy * ball_dy);
-            if (magnitude != 0) {
-                ball_dx /= magnitude;
-                ball_dy /= magnitude;
-            }
-
-            current_ball_speed = INITIAL_BALL_SPEED; // Reset ball speed
-            ball_boost_timer = 0; // Clear any speed boost
-            left_consecutive_hits = 0; // Reset consecutive hit counters
-            right_consecutive_hits = 0;
-            last_ball_hit = LastHit::None; // Reset last hit
-        }
-        // Ball goes past right paddle (left player scores)
-        else if (ball_x + BALL_RADIUS > WINDOW_WIDTH) {
-            left_score++;
-            // Reset ball to center of the screen
-            ball_x = WINDOW_WIDTH / 2.0f;
-            ball_y = WINDOW_HEIGHT / 2.0f;
-            // Set a new random initial direction for the next serve
-            float angle;
-            do {
-                angle = static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * 2.0f * M_PI;
-            } while (std::abs(std::sin(angle)) < 0.2f || std::abs(std::cos(angle)) < 0.2f);
-            ball_dx = cos(angle);
-            ball_dy = sin(angle);
-
-            // Normalize the direction vector
-            float magnitude = sqrt(ball_dx * ball_dx + ball_dy * ball_dy);
-            if (magnitude != 0) {
-                ball_dx /= magnitude;
-                ball_dy /= magnitude;
+        else {
+            MatchInput input = readKeyboardInput();
+            playMatchSounds(engine, advanceMatch(match, input, SDL_GetTicks()));
+            if (replay_path && !isSpectating(match)) {
+                replay.ticks.push_back(packReplayTick(input, launched));
             }
+        }
 
-            current_ball_speed = INITIAL_BALL_SPEED; // Reset ball speed
-            ball_boost_timer = 0; // Clear any speed boost
-            left_consecutive_hits = 0; // Reset consecutive hit counters
-            right_consecutive_hits = 0;
-            last_ball_hit = LastHit::None; // Reset last hit
+        Uint32 currentTime = SDL_GetTicks(); // Get current time for coin animation frame calculation
+        const QualityKnobs& knobs = getQualityKnobs(governor);
+        int focused_match = -1; // The match under the mouse animates at full rate
+        if (wall) {
+            int mouse_x, mouse_y;
+            SDL_GetMouseState(&mouse_x, &mouse_y);
+            focused_match = getWallMatchAt(wall_host, renderer, wall_columns, wall_rows, mouse_x, mouse_y);
         }
 
+        // --- Rendering ---
+        bool scaled_scene = software_target == nullptr && beginSceneRender(scene, renderer, knobs.renderScale);
+        SDL_SetRenderDrawColor(renderer, 0x1A, 0x20, 0x2C, 0xFF); // Set background color (Dark Slate Gray)
+        SDL_RenderClear(renderer); // Clear the screen with the background color
 
-        // --- Ball Speed Boost Logic ---
-        if (reflected_this_frame) {
-            ball_boost_timer = BALL_BOOST_DURATION_FRAMES; // Start the boost timer
-            current_ball_speed = INITIAL_BALL_SPEED * BALL_BOOST_FACTOR; // Apply speed boost
+        if (wall) {
+            renderMatchWall(engine, wall_host, renderer, wall_columns, wall_rows, currentTime, focused_match, knobs.offFocusAnimationMs);
         }
-
-        if (ball_boost_timer > 0) {
-            ball_boost_timer--; // Decrement the timer each frame
-            if (ball_boost_timer == 0) {
-                current_ball_speed = INITIAL_BALL_SPEED; // Revert to initial speed when timer expires
-            }
+        else {
+            renderMatch(engine, match, renderer, currentTime, &score_layer);
         }
-
-        // --- Coin Logic ---
-        coin_spawn_timer++;
-        if (coin_spawn_timer >= COIN_APPEAR_INTERVAL_FRAMES) {
-            spawnCoin(); // Spawn a new coin
-            coin_spawn_timer = 0; // Reset the timer
+        if (scaled_scene) {
+            endSceneRender(scene, renderer);
         }
 
-        Uint32 currentTime = SDL_GetTicks(); // Get current time for coin animation frame calculation
-
-        // Get the effective size of the coin for collision calculations
-        int coinEffectiveWidth = getCoinRenderedWidth(COIN_DRAW_SCALE);
-        int coinEffectiveHeight = getCoinRenderedHeight(COIN_DRAW_SCALE);
-
-        // Iterate through all active coins to check for expiry and collisions
-        for (auto it = coins.begin(); it != coins.end(); ) {
-            // Decrement coin's internal timer
-            it->timer--;
-            if (it->timer <= 0) {
-                it = coins.erase(it); // Remove coin if its timer has run out
-                continue; // Move to the next element (iterator is already advanced by erase)
-            }
-
-            // Create an SDL_Rect representing the coin's bounding box for collision checks
-            SDL_Rect coinRect = {
-                static_cast<int>(it->x - coinEffectiveWidth / 2),
-                static_cast<int>(it->y - coinEffectiveHeight / 2),
-                coinEffectiveWidth,
-                coinEffectiveHeight
-            };
-
-            bool coin_collected = false; // Flag to check if the coin was collected this frame
-
-            // Collision with ball (Scoring Rule 3: Ball collects coin)
-            if (checkCircleRectCollision(ball_x, ball_y, BALL_RADIUS, coinRect)) {
-                // Award score to the player who last hit the ball
-                if (last_ball_hit == LastHit::LeftPaddle) {
-                    left_score++;
-                }
-                else if (last_ball_hit == LastHit::RightPaddle) {
-                    right_score++;
-                }
-                playCoinSound(); // Play coin collection sound
-                coin_collected = true;
-            }
-
-            // Collision with left paddle (Scoring Rule 2: Paddle collects coin)
-            // Only check if coin hasn't already been collected by the ball
-            if (!coin_collected && checkRectRectCollision(leftPaddle, coinRect)) {
-                left_score++;
-                playCoinSound();
-                coin_collected = true;
-            }
-
-            // Collision with right paddle (Scoring Rule 2: Paddle collects coin)
-            // Only check if coin hasn't already been collected by ball or left paddle
-            if (!coin_collected && checkRectRectCollision(rightPaddle, coinRect)) {
-                right_score++;
-                playCoinSound();
-                coin_collected = true;
+        float frame_work_ms;
+        if (software_target) {
+            // A renderer drawing into a surface does not present it, and there is no VSync to pace the loop
+            SDL_RenderFlush(renderer);
+            if (beginPostFxFrame(post) && SDL_LockSurface(software_target) == 0) {
+                applyPostProcessing(post, static_cast<Uint32*>(software_target->pixels), software_target->pitch);
+                SDL_UnlockSurface(software_target);
             }
-
-            if (coin_collected) {
-                it = coins.erase(it); // Remove the collected coin from the vector
+            captureVideoFrame(recorder, renderer, software_target, SDL_GetTicks());
+            SDL_UpdateWindowSurface(window);
+            frame_work_ms = static_cast<float>((SDL_GetPerformanceCounter() - frame_start) * counter_ms);
+            Uint32 frameTime = SDL_GetTicks() - currentTime;
+            if (frameTime < SOFTWARE_FRAME_MS) {
+                SDL_Delay(SOFTWARE_FRAME_MS - frameTime);
             }
-            else {
-                ++it; // Move to the next coin if it was not collected this frame
+        }
+        else {
+            int pitch = post_width * static_cast<int>(sizeof(Uint32));
+            Uint64 readback_start = SDL_GetPerformanceCounter();
+            // With the effects off, the frame goes straight to the screen: no readback or upload
+            if (beginPostFxFrame(post) && SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_ARGB8888, post_pixels.data(), pitch) == 0) {
+                Uint64 readback_ticks = SDL_GetPerformanceCounter() - readback_start;
+                applyPostProcessing(post, post_pixels.data(), pitch);
+                Uint64 upload_start = SDL_GetPerformanceCounter();
+                SDL_UpdateTexture(post_texture, nullptr, post_pixels.data(), pitch);
+                SDL_RenderCopy(renderer, post_texture, nullptr, nullptr);
+                // The round trip is part of what the effects cost; it counts against their budget from the next frame
+                setPostFxTransferTime(post, static_cast<float>((readback_ticks + SDL_GetPerformanceCounter() - upload_start) * counter_ms));
             }
+            captureVideoFrame(recorder, renderer, nullptr, SDL_GetTicks());
+            frame_work_ms = static_cast<float>((SDL_GetPerformanceCounter() - frame_start) * counter_ms); // Presenting waits for VSync
+            SDL_RenderPresent(renderer); // Update the screen with everything rendered
         }
 
-        // --- Rendering ---
-        SDL_SetRenderDrawColor(renderer, 0x1A, 0x20, 0x2C, 0xFF); // Set background color (Dark Slate Gray)
-        SDL_RenderClear(renderer); // Clear the screen with the background color
-
-        // Draw ball
-        drawFilledCircle(renderer, static_cast<int>(ball_x), static_cast<int>(ball_y), BALL_RADIUS, 0xFF, 0x00, 0x00, 0xFF); // Red ball
-
-        // Draw paddles
-        SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0xFF, 0xFF); // Blue for left paddle
-        SDL_RenderFillRect(renderer, &leftPaddle);
-
-        SDL_SetRenderDrawColor(renderer, 0x00, 0xFF, 0x00, 0xFF); // Green for right paddle
-        SDL_RenderFillRect(renderer, &rightPaddle);
-
-        // Draw all active coins using the coin system's draw function
-        for (const auto& coin : coins) {
-            draw_Coin(static_cast<int>(coin.x), static_cast<int>(coin.y), COIN_DRAW_SCALE, renderer, currentTime);
+        Uint64 frame_end = SDL_GetPerformanceCounter();
+        if (recordFrameTime(governor, frame_work_ms, static_cast<float>((frame_end - last_frame_end) * counter_ms))) {
+            setPostFxLevelCap(post, getQualityKnobs(governor).postFxCap);
+            setCachedLayerRedrawInterval(score_layer, getQualityKnobs(governor).textRedrawMs);
         }
-
-        // Render scores for both players
-        renderText(renderer, "Player 1: " + std::to_string(left_score), 50, 20, textColor);
-        renderText(renderer, "Player 2: " + std::to_string(right_score), WINDOW_WIDTH - 200, 20, textColor);
-
-        SDL_RenderPresent(renderer); // Update the screen with everything rendered
+        last_frame_end = frame_end;
     }
 
     // --- Cleanup ---
-    if (gFont) {
-        TTF_CloseFont(gFont); // Close the loaded font
+    if (replay_path && !replay.ticks.empty()) {
+        saveReplay(replay, replay_path);
     }
-    closeCoinSystem(); // Clean up all coin textures
-    if (coin_sound) {
-        Mix_FreeChunk(coin_sound); // Free the loaded sound effect
+    stopVideoRecording(recorder); // Writes the frames still in flight
+    closeQualityGovernor(governor);
+    freeSceneTarget(scene);
+    destroyPostProcessor(post);
+    if (post_texture) {
+        SDL_DestroyTexture(post_texture);
     }
+    closeMatch(match); // Free any suspended scripts and close spectator connections
+    closeMatchHost(wall_host);
+    closeMusicStreaming(); // Stop the decode worker before the mixer goes away
+    closeAudioMixer(); // Stop mixing before freeing the sounds it may be playing
+    closeEngine(engine); // Coin textures, sounds and fonts
+    freeCachedLayer(score_layer);
     Mix_CloseAudio(); // Close SDL_mixer subsystem
-    TTF_Quit();       // Quit SDL_ttf subsystem
+    TTF_Quit();       // Quit SDL_ttf subsystem (no-op unless the font fallback started it)
     IMG_Quit();       // Quit SDL_image subsystem
     SDL_DestroyRenderer(renderer); // Destroy the renderer
     SDL_DestroyWindow(window);     // Destroy the window
@@ -0,0 +1,78 @@
+#include "mapped_file.h"
+#include <iostream> // For error output
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool mapFile(const char* path, MappedFile& file) {
+    file = MappedFile();
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open " << path << "!" << std::endl;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+        std::cerr << "Failed to map " << path << " (empty or unreadable)!" << std::endl;
+        CloseHandle(handle);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        std::cerr << "Failed to map " << path << "!" << std::endl;
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(handle);
+        return false;
+    }
+    file.data = static_cast<const uint8_t*>(view);
+    file.size = static_cast<size_t>(size.QuadPart);
+    file.fileHandle = handle;
+    file.mappingHandle = mapping;
+#else
+    int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) {
+        std::cerr << "Failed to open " << path << "!" << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+        std::cerr << "Failed to map " << path << " (empty or unreadable)!" << std::endl;
+        close(descriptor);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor); // The mapping keeps the file alive
+    if (view == MAP_FAILED) {
+        std::cerr << "Failed to map " << path << "!" << std::endl;
+        return false;
+    }
+    file.data = static_cast<const uint8_t*>(view);
+    file.size = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void unmapFile(MappedFile& file) {
+    if (file.data == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(file.data);
+    CloseHandle(file.mappingHandle);
+    CloseHandle(file.fileHandle);
+#else
+    munmap(const_cast<uint8_t*>(file.data), file.size);
+#endif
+    file = MappedFile();
+}
@@ -0,0 +1,28 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file.
+//
+// Asset files (font atlases, images) are mapped instead of read so the OS pages
+// them in straight from its cache without an extra copy, and unmapping hands
+// the memory back as soon as the data has been uploaded.
+
+struct MappedFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// Maps path into memory. Returns false (and prints why) on failure.
+bool mapFile(const char* path, MappedFile& file);
+
+void unmapFile(MappedFile& file);
+
+#endif
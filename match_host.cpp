@@ -0,0 +1,140 @@
+#include "match_host.h"
+#include <algorithm> // For std::find, std::min
+
+namespace {
+
+const Uint8 WALL_BORDER_GRAY = 0x50; // Outline around each match on the wall
+
+const float BOT_DEAD_ZONE = PADDLE_HEIGHT / 4.0f; // Paddle center may be this far off the ball before it moves
+
+// Up/down for one paddle chasing the ball's height
+void trackBall(const SDL_Rect& paddle, float ballY, bool& up, bool& down) {
+    float center = paddle.y + PADDLE_HEIGHT / 2.0f;
+    up = ballY < center - BOT_DEAD_ZONE;
+    down = ballY > center + BOT_DEAD_ZONE;
+}
+
+// Lays the wall out at full match size, scaled to fit outputWidth x
+// outputHeight and centered: margins are in unscaled wall coordinates
+void getWallLayout(int outputWidth, int outputHeight, int columns, int rows, float& scale, int& marginX, int& marginY) {
+    scale = std::min(static_cast<float>(outputWidth) / (columns * WINDOW_WIDTH),
+                     static_cast<float>(outputHeight) / (rows * WINDOW_HEIGHT));
+    marginX = static_cast<int>((outputWidth / scale - columns * WINDOW_WIDTH) / 2);
+    marginY = static_cast<int>((outputHeight / scale - rows * WINDOW_HEIGHT) / 2);
+}
+
+// Where match index sits on the wall, in unscaled wall coordinates
+SDL_Rect getWallCell(int index, int columns, int marginX, int marginY) {
+    return { marginX + (index % columns) * WINDOW_WIDTH, marginY + (index / columns) * WINDOW_HEIGHT, WINDOW_WIDTH, WINDOW_HEIGHT };
+}
+
+} // namespace
+
+MatchContext* addHostedMatch(MatchHost& host, uint32_t seed) {
+    MatchContext* match = new MatchContext(host.engine);
+    startMatch(*match, seed);
+    launchBall(*match); // Nobody is there to click the ball
+    host.matches.push_back(match);
+    return match;
+}
+
+void removeHostedMatch(MatchHost& host, MatchContext* match) {
+    auto it = std::find(host.matches.begin(), host.matches.end(), match);
+    if (it == host.matches.end()) {
+        return;
+    }
+    host.matches.erase(it);
+    closeMatch(*match);
+    delete match;
+}
+
+void stepHostedMatches(MatchHost& host, uint32_t nowMs) {
+    for (MatchContext* match : host.matches) {
+        playMatchSounds(*host.engine, advanceMatch(*match, computeBotInput(*match), nowMs));
+    }
+}
+
+void closeMatchHost(MatchHost& host) {
+    for (MatchContext* match : host.matches) {
+        closeMatch(*match);
+        delete match;
+    }
+    host.matches.clear();
+}
+
+MatchInput computeBotInput(const MatchContext& match) {
+    MatchInput input = {};
+    float ballY = scalarToFloat(match.ballY);
+    trackBall(match.leftPaddle, ballY, input.leftUp, input.leftDown);
+    trackBall(match.rightPaddle, ballY, input.rightUp, input.rightDown);
+    return input;
+}
+
+void renderMatchWall(EngineContext& engine, const MatchHost& host, SDL_Renderer* renderer, int columns, int rows, Uint32 currentTime,
+                     int focusedMatch, Uint32 offFocusAnimationMs) {
+    int outputWidth, outputHeight;
+    if (columns <= 0 || rows <= 0 || SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight) != 0) {
+        return;
+    }
+    // Viewports are given in scaled coordinates, so the scale has to be set first
+    float scale;
+    int marginX, marginY;
+    getWallLayout(outputWidth, outputHeight, columns, rows, scale, marginX, marginY);
+    float previousScaleX, previousScaleY;
+    SDL_RenderGetScale(renderer, &previousScaleX, &previousScaleY);
+    SDL_RenderSetScale(renderer, scale, scale);
+
+    if (engine.glyphCache) {
+        updateGlyphCache(engine.glyphCache); // Once per frame, not once per match
+    }
+    int count = std::min(static_cast<int>(host.matches.size()), columns * rows);
+    // Sprites of every match share one queue, placed by its transform rather
+    // than by viewports, so the whole wall's sprites flush in a few draw calls
+    RenderQueue& queue = engine.renderQueue;
+    for (int i = 0; i < count; ++i) {
+        SDL_Rect cell = getWallCell(i, columns, marginX, marginY);
+        setRenderQueueTransform(queue, static_cast<float>(cell.x), static_cast<float>(cell.y), 1.0f);
+        Uint32 animationTime = currentTime;
+        if (i != focusedMatch && offFocusAnimationMs > 0) {
+            animationTime -= currentTime % offFocusAnimationMs;
+        }
+        queueMatchSprites(engine, *host.matches[i], queue, animationTime);
+    }
+    flushRenderQueue(queue, renderer);
+
+    // Text is drawn per match, in a viewport clipped to its cell so long
+    // scores cannot spill into the neighbours (clip rects are viewport-relative)
+    for (int i = 0; i < count; ++i) {
+        SDL_Rect cell = getWallCell(i, columns, marginX, marginY);
+        SDL_Rect clip = { 0, 0, cell.w, cell.h };
+        SDL_RenderSetViewport(renderer, &cell);
+        SDL_RenderSetClipRect(renderer, &clip);
+        renderMatchScores(engine, *host.matches[i], renderer);
+    }
+
+    SDL_RenderSetClipRect(renderer, NULL);
+    SDL_RenderSetViewport(renderer, NULL);
+    SDL_SetRenderDrawColor(renderer, WALL_BORDER_GRAY, WALL_BORDER_GRAY, WALL_BORDER_GRAY, 0xFF);
+    for (int i = 0; i < count; ++i) {
+        SDL_Rect cell = getWallCell(i, columns, marginX, marginY);
+        SDL_RenderDrawRect(renderer, &cell);
+    }
+    SDL_RenderSetScale(renderer, previousScaleX, previousScaleY);
+}
+
+int getWallMatchAt(const MatchHost& host, SDL_Renderer* renderer, int columns, int rows, int x, int y) {
+    int outputWidth, outputHeight;
+    if (columns <= 0 || rows <= 0 || SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight) != 0) {
+        return -1;
+    }
+    float scale;
+    int marginX, marginY;
+    getWallLayout(outputWidth, outputHeight, columns, rows, scale, marginX, marginY);
+    float wallX = x / scale - marginX;
+    float wallY = y / scale - marginY;
+    if (wallX < 0 || wallY < 0 || wallX >= columns * WINDOW_WIDTH || wallY >= rows * WINDOW_HEIGHT) {
+        return -1;
+    }
+    int index = static_cast<int>(wallY) / WINDOW_HEIGHT * columns + static_cast<int>(wallX) / WINDOW_WIDTH;
+    return index < static_cast<int>(host.matches.size()) ? index : -1;
+}
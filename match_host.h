@@ -0,0 +1,64 @@
+#pragma once
+#ifndef MATCH_HOST_H
+#define MATCH_HOST_H
+
+#include <cstdint>
+#include <vector>
+
+#include "game_context.h"
+
+// Runs many independent matches in one process.
+//
+// Every match points at the same EngineContext, so textures, the score font
+// and the synthesized sounds exist once no matter how many matches run, and
+// the tuning values are compile-time constants in game_context.h. What each
+// additional match costs is its MatchContext (ball, paddles, coins, scores,
+// random generator and script scheduler), a few KB instead of a whole
+// process with its own SDL, mixer, font and textures. The desync history and
+// spectator sockets are only allocated for matches that use them.
+//
+// Hosted matches are played by bots (see computeBotInput), stepped one tick at
+// a time in the order they were added. A host without a window uses an
+// EngineContext that was never initialized: no renderer and no sounds. Coin
+// collisions do not depend on it; every match uses the fixed
+// COIN_COLLISION_WIDTH x COIN_COLLISION_HEIGHT (36x38) hitbox.
+
+struct MatchHost {
+    const EngineContext* engine = nullptr;
+    std::vector<MatchContext*> matches;
+};
+
+// Starts a match with its own seed and serves its ball. The match stays
+// owned by the host until removeHostedMatch or closeMatchHost.
+MatchContext* addHostedMatch(MatchHost& host, uint32_t seed);
+
+void removeHostedMatch(MatchHost& host, MatchContext* match);
+
+// Advances every match by one tick with bot input, broadcasting the ones that
+// have a spectator connection, and plays their sounds with the engine's mixer
+// sounds (none when it has none, as for the headless host)
+void stepHostedMatches(MatchHost& host, uint32_t nowMs);
+
+// Closes and frees every match (the engine is left alone)
+void closeMatchHost(MatchHost& host);
+
+// Draws the first columns * rows matches as a grid filling the renderer's
+// output (a tournament wall). Each match keeps its own coordinates inside a
+// cell, and the wall is scaled down as a whole, centered. The sprites of every
+// match go through the engine's render queue together, so each layer of the
+// wall (balls, paddles, coins) is one draw call; scores follow, each in its
+// cell's viewport. The engine must not have a software target: RLE coin blits
+// ignore cells and scaling. Every match but focusedMatch (the one being
+// watched, see getWallMatchAt) advances its coin animation only every
+// offFocusAnimationMs (0: every frame, like the focused one).
+void renderMatchWall(EngineContext& engine, const MatchHost& host, SDL_Renderer* renderer, int columns, int rows, Uint32 currentTime,
+                     int focusedMatch = -1, Uint32 offFocusAnimationMs = 0);
+
+// Index of the match drawn at output position (x, y) by renderMatchWall, or
+// -1 between and around the cells
+int getWallMatchAt(const MatchHost& host, SDL_Renderer* renderer, int columns, int rows, int x, int y);
+
+// Moves each paddle toward the ball, with a small dead zone so it does not jitter
+MatchInput computeBotInput(const MatchContext& match);
+
+#endif
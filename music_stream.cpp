@@ -0,0 +1,491 @@
+#include "music_stream.h"
+#include "audio_mixer.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <chrono>             // For the worker's poll interval
+#include <condition_variable> // For waking the worker on requests
+#include <cstring>            // For memcmp
+#include <fstream>            // For reading tracks
+#include <iostream>           // For error output
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int MUSIC_DECKS = 2;                  // Current track plus the one fading out
+const size_t MUSIC_RING_FRAMES = 32768;     // ~0.75 s at 44.1 kHz, 128 KB per deck
+const int MAX_DECODED_FRAMES = 8192;        // Largest decode step (one ADPCM block or PCM chunk)
+const int PCM_CHUNK_FRAMES = 4096;
+const int MAX_ADPCM_BLOCK_BYTES = 4096;
+const int MIX_CHUNK_FRAMES = 256;           // Frames popped from a ring at a time in the callback
+const int WORKER_POLL_MS = 5;
+
+const Uint16 WAVE_FORMAT_PCM = 0x0001;
+const Uint16 WAVE_FORMAT_IMA_ADPCM = 0x0011;
+
+const int IMA_INDEX_TABLE[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+const int IMA_STEP_TABLE[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+struct MusicFrame {
+    Sint16 left;
+    Sint16 right;
+};
+
+// Reads a WAV file a block at a time. Worker thread only.
+class WavDecoder {
+public:
+    bool open(const char* path, int deviceRate);
+    void close() { file.close(); }
+    bool isOpen() const { return file.is_open(); }
+
+    // Decodes the next few thousand frames into out. Returns 0 at the end of the data.
+    int decode(MusicFrame* out);
+
+    // Back to the first frame, for looping
+    void rewind();
+
+private:
+    int decodePcm(MusicFrame* out);
+    int decodeAdpcm(MusicFrame* out);
+
+    std::ifstream file;
+    Uint16 encoding = 0;
+    int channels = 0;
+    int blockAlign = 0;
+    int framesPerBlock = 0;
+    std::streamoff dataStart = 0;
+    Uint32 dataBytes = 0;
+    Uint32 dataRemaining = 0;
+    Uint8 buffer[MAX_ADPCM_BLOCK_BYTES > PCM_CHUNK_FRAMES * 4 ? MAX_ADPCM_BLOCK_BYTES : PCM_CHUNK_FRAMES * 4];
+};
+
+Uint16 readLE16(const Uint8* p) {
+    return static_cast<Uint16>(p[0] | (p[1] << 8));
+}
+
+Uint32 readLE32(const Uint8* p) {
+    return static_cast<Uint32>(p[0]) | (static_cast<Uint32>(p[1]) << 8) |
+           (static_cast<Uint32>(p[2]) << 16) | (static_cast<Uint32>(p[3]) << 24);
+}
+
+bool WavDecoder::open(const char* path, int deviceRate) {
+    file.close();
+    file.clear();
+    file.open(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Music: failed to open " << path << "!" << std::endl;
+        return false;
+    }
+
+    Uint8 header[12];
+    if (!file.read(reinterpret_cast<char*>(header), 12) || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+        std::cerr << "Music: " << path << " is not a WAV file!" << std::endl;
+        file.close();
+        return false;
+    }
+
+    bool haveFormat = false;
+    int sampleRate = 0;
+    int bitsPerSample = 0;
+    Uint8 chunkHeader[8];
+    while (file.read(reinterpret_cast<char*>(chunkHeader), 8)) {
+        Uint32 chunkSize = readLE32(chunkHeader + 4);
+        if (memcmp(chunkHeader, "fmt ", 4) == 0) {
+            Uint8 format[20] = {};
+            Uint32 toRead = chunkSize < sizeof(format) ? chunkSize : static_cast<Uint32>(sizeof(format));
+            file.read(reinterpret_cast<char*>(format), toRead);
+            file.seekg(chunkSize - toRead + (chunkSize & 1), std::ios::cur);
+            encoding = readLE16(format);
+            channels = readLE16(format + 2);
+            sampleRate = static_cast<int>(readLE32(format + 4));
+            blockAlign = readLE16(format + 12);
+            bitsPerSample = readLE16(format + 14);
+            framesPerBlock = readLE16(format + 18); // IMA ADPCM extension
+            haveFormat = true;
+        }
+        else if (memcmp(chunkHeader, "data", 4) == 0) {
+            dataStart = file.tellg();
+            dataBytes = chunkSize;
+            break;
+        }
+        else {
+            file.seekg(chunkSize + (chunkSize & 1), std::ios::cur); // Chunks are word aligned
+        }
+    }
+
+    const char* problem = nullptr;
+    if (!haveFormat || dataBytes == 0) {
+        problem = "has no audio data";
+    }
+    else if (channels != 1 && channels != 2) {
+        problem = "must be mono or stereo";
+    }
+    else if (sampleRate != deviceRate) {
+        problem = "does not match the mixer's sample rate";
+    }
+    else if (encoding == WAVE_FORMAT_PCM && bitsPerSample != 16) {
+        problem = "must be 16-bit PCM";
+    }
+    else if (encoding == WAVE_FORMAT_IMA_ADPCM &&
+             (blockAlign > MAX_ADPCM_BLOCK_BYTES || blockAlign <= 4 * channels || framesPerBlock > MAX_DECODED_FRAMES)) {
+        problem = "has an unsupported ADPCM block size";
+    }
+    else if (encoding != WAVE_FORMAT_PCM && encoding != WAVE_FORMAT_IMA_ADPCM) {
+        problem = "must be PCM or IMA ADPCM";
+    }
+    if (problem) {
+        std::cerr << "Music: " << path << " " << problem << "!" << std::endl;
+        file.close();
+        return false;
+    }
+    dataRemaining = dataBytes;
+    return true;
+}
+
+void WavDecoder::rewind() {
+    file.clear();
+    file.seekg(dataStart);
+    dataRemaining = dataBytes;
+}
+
+int WavDecoder::decode(MusicFrame* out) {
+    if (dataRemaining == 0) {
+        return 0;
+    }
+    return encoding == WAVE_FORMAT_PCM ? decodePcm(out) : decodeAdpcm(out);
+}
+
+int WavDecoder::decodePcm(MusicFrame* out) {
+    int frameBytes = 2 * channels;
+    Uint32 bytes = static_cast<Uint32>(PCM_CHUNK_FRAMES * frameBytes);
+    if (bytes > dataRemaining) {
+        bytes = dataRemaining - dataRemaining % frameBytes;
+    }
+    file.read(reinterpret_cast<char*>(buffer), bytes);
+    int frames = static_cast<int>(file.gcount()) / frameBytes;
+    dataRemaining = frames > 0 ? dataRemaining - bytes : 0; // A short read means the file is truncated
+    for (int i = 0; i < frames; ++i) {
+        const Uint8* p = buffer + i * frameBytes;
+        out[i].left = static_cast<Sint16>(readLE16(p));
+        out[i].right = channels == 2 ? static_cast<Sint16>(readLE16(p + 2)) : out[i].left;
+    }
+    return frames;
+}
+
+int WavDecoder::decodeAdpcm(MusicFrame* out) {
+    Uint32 bytes = static_cast<Uint32>(blockAlign) < dataRemaining ? static_cast<Uint32>(blockAlign) : dataRemaining;
+    file.read(reinterpret_cast<char*>(buffer), bytes);
+    int got = static_cast<int>(file.gcount());
+    if (got <= 4 * channels) {
+        dataRemaining = 0;
+        return 0;
+    }
+    dataRemaining -= bytes;
+
+    // The last block may be short
+    int frames = 1 + (got - 4 * channels) * 2 / channels;
+    if (frames > framesPerBlock) {
+        frames = framesPerBlock;
+    }
+
+    for (int channel = 0; channel < channels; ++channel) {
+        // Block header per channel: initial sample, step index, reserved byte
+        const Uint8* header = buffer + channel * 4;
+        int predictor = static_cast<Sint16>(readLE16(header));
+        int index = header[2] > 88 ? 88 : header[2];
+        Sint16* first = channel == 0 ? &out[0].left : &out[0].right;
+        *first = static_cast<Sint16>(predictor);
+
+        // Data interleaves 4 bytes (8 samples) per channel, low nibble first
+        for (int frame = 1; frame < frames; ++frame) {
+            int sample = frame - 1;
+            int byteOffset = 4 * channels + (sample / 8) * 4 * channels + channel * 4 + (sample % 8) / 2;
+            int nibble = (buffer[byteOffset] >> ((sample & 1) * 4)) & 0x0F;
+
+            int step = IMA_STEP_TABLE[index];
+            int diff = step >> 3;
+            if (nibble & 1) diff += step >> 2;
+            if (nibble & 2) diff += step >> 1;
+            if (nibble & 4) diff += step;
+            predictor += (nibble & 8) ? -diff : diff;
+            predictor = predictor < -32768 ? -32768 : (predictor > 32767 ? 32767 : predictor);
+            index += IMA_INDEX_TABLE[nibble & 7];
+            index = index < 0 ? 0 : (index > 88 ? 88 : index);
+
+            if (channel == 0) {
+                out[frame].left = static_cast<Sint16>(predictor);
+            }
+            else {
+                out[frame].right = static_cast<Sint16>(predictor);
+            }
+        }
+    }
+    if (channels == 1) {
+        for (int frame = 0; frame < frames; ++frame) {
+            out[frame].right = out[frame].left;
+        }
+    }
+    return frames;
+}
+
+enum DeckState {
+    DECK_IDLE,    // Owned by the worker
+    DECK_PLAYING  // Being drained by the audio thread
+};
+
+struct Deck {
+    SpscRing<MusicFrame, MUSIC_RING_FRAMES> ring;
+    std::atomic<int> state{ DECK_IDLE };
+    std::atomic<bool> endOfTrack{ false }; // No more frames will be pushed
+    std::atomic<float> targetGain{ 0.0f };
+    std::atomic<float> fadeStep{ 1.0f };   // Gain change per frame
+    float gain = 0.0f;                     // Audio thread while playing, worker while idle
+
+    // Worker thread only
+    WavDecoder decoder;
+    bool loop = false;
+    MusicFrame decoded[MAX_DECODED_FRAMES];
+    int decodedCount = 0;
+    int decodedPos = 0;
+};
+
+enum class MusicRequestType { Play, Stop };
+
+struct MusicRequest {
+    MusicRequestType type;
+    std::string path;
+    float fadeSeconds;
+    bool loop;
+};
+
+Deck gDecks[MUSIC_DECKS];
+std::atomic<float> gMusicVolume(1.0f);
+std::atomic<Uint32> gUnderruns(0);
+int gMusicSampleRate = 0;
+
+// Game thread -> worker. Only these two threads use the mutex; the audio thread never waits on it.
+std::mutex gRequestMutex;
+std::condition_variable gRequestSignal;
+std::vector<MusicRequest> gRequests;
+bool gWorkerRunning = false;
+std::thread gWorker;
+
+float fadeStepFor(float seconds) {
+    return seconds > 0.0f ? 1.0f / (seconds * gMusicSampleRate) : 1.0f;
+}
+
+// Worker: keeps a playing deck's ring topped up, wrapping looping tracks without a gap
+void fillDeck(Deck& deck) {
+    while (!deck.endOfTrack.load(std::memory_order_relaxed)) {
+        if (deck.decodedPos == deck.decodedCount) {
+            deck.decodedCount = deck.decoder.decode(deck.decoded);
+            deck.decodedPos = 0;
+            if (deck.decodedCount == 0) {
+                if (deck.loop) {
+                    deck.decoder.rewind();
+                    deck.decodedCount = deck.decoder.decode(deck.decoded);
+                }
+                if (deck.decodedCount == 0) {
+                    deck.endOfTrack.store(true, std::memory_order_release);
+                    return;
+                }
+            }
+        }
+        size_t pushed = deck.ring.pushMany(deck.decoded + deck.decodedPos, deck.decodedCount - deck.decodedPos);
+        deck.decodedPos += static_cast<int>(pushed);
+        if (deck.decodedPos < deck.decodedCount) {
+            return; // Ring is full
+        }
+    }
+}
+
+// Worker: returns false if the request has to wait for a free deck
+bool handleRequest(const MusicRequest& request) {
+    if (request.type == MusicRequestType::Stop) {
+        for (Deck& deck : gDecks) {
+            deck.fadeStep.store(fadeStepFor(request.fadeSeconds), std::memory_order_relaxed);
+            deck.targetGain.store(0.0f, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    Deck* deck = nullptr;
+    for (Deck& candidate : gDecks) {
+        if (candidate.state.load(std::memory_order_acquire) == DECK_IDLE) {
+            deck = &candidate;
+            break;
+        }
+    }
+    if (deck == nullptr) {
+        return false; // Both decks busy with an earlier crossfade
+    }
+
+    if (!deck->decoder.open(request.path.c_str(), gMusicSampleRate)) {
+        return true; // Dropped; whatever is playing keeps playing
+    }
+    deck->loop = request.loop;
+    deck->decodedCount = 0;
+    deck->decodedPos = 0;
+    deck->ring.reset();
+    deck->endOfTrack.store(false, std::memory_order_relaxed);
+    fillDeck(*deck); // Prefill so playback starts without an underrun
+
+    float step = fadeStepFor(request.fadeSeconds);
+    for (Deck& other : gDecks) {
+        if (&other != deck) {
+            other.fadeStep.store(step, std::memory_order_relaxed);
+            other.targetGain.store(0.0f, std::memory_order_relaxed);
+        }
+    }
+    deck->gain = request.fadeSeconds > 0.0f ? 0.0f : 1.0f;
+    deck->fadeStep.store(step, std::memory_order_relaxed);
+    deck->targetGain.store(1.0f, std::memory_order_relaxed);
+    deck->state.store(DECK_PLAYING, std::memory_order_release); // Hands the deck to the audio thread
+    return true;
+}
+
+void musicWorker() {
+    std::vector<MusicRequest> requests;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(gRequestMutex);
+            gRequestSignal.wait_for(lock, std::chrono::milliseconds(WORKER_POLL_MS),
+                                    [] { return !gRequests.empty() || !gWorkerRunning; });
+            if (!gWorkerRunning) {
+                break;
+            }
+            requests.insert(requests.end(), gRequests.begin(), gRequests.end());
+            gRequests.clear();
+        }
+
+        // Requests run in order; one waiting for a free deck holds back the rest
+        size_t handled = 0;
+        while (handled < requests.size() && handleRequest(requests[handled])) {
+            handled++;
+        }
+        requests.erase(requests.begin(), requests.begin() + handled);
+
+        for (Deck& deck : gDecks) {
+            if (deck.state.load(std::memory_order_acquire) == DECK_PLAYING) {
+                fillDeck(deck);
+            }
+            else if (deck.decoder.isOpen()) {
+                deck.decoder.close(); // Finished or faded out
+            }
+        }
+    }
+    for (Deck& deck : gDecks) {
+        deck.decoder.close();
+    }
+}
+
+// Mixer stream: audio thread, never blocks
+void mixMusic(float* out, int frames) {
+    const float scale = gMusicVolume.load(std::memory_order_relaxed) / 32768.0f;
+    MusicFrame chunk[MIX_CHUNK_FRAMES];
+
+    for (Deck& deck : gDecks) {
+        if (deck.state.load(std::memory_order_acquire) != DECK_PLAYING) {
+            continue;
+        }
+        float target = deck.targetGain.load(std::memory_order_relaxed);
+        float step = deck.fadeStep.load(std::memory_order_relaxed);
+        float gain = deck.gain;
+
+        for (int offset = 0; offset < frames; offset += MIX_CHUNK_FRAMES) {
+            int wanted = frames - offset < MIX_CHUNK_FRAMES ? frames - offset : MIX_CHUNK_FRAMES;
+            int got = static_cast<int>(deck.ring.popMany(chunk, wanted));
+            float* dst = out + offset * 2;
+            for (int i = 0; i < got; ++i) {
+                if (gain < target) {
+                    gain = gain + step > target ? target : gain + step;
+                }
+                else if (gain > target) {
+                    gain = gain - step < target ? target : gain - step;
+                }
+                dst[i * 2] += chunk[i].left * gain * scale;
+                dst[i * 2 + 1] += chunk[i].right * gain * scale;
+            }
+            if (got < wanted) {
+                // Check endOfTrack first: it is set after the final push
+                if (!deck.endOfTrack.load(std::memory_order_acquire) || deck.ring.size() != 0) {
+                    gUnderruns.fetch_add(1, std::memory_order_relaxed); // Worker fell behind; play silence
+                }
+                break;
+            }
+        }
+        deck.gain = gain;
+
+        bool fadedOut = target == 0.0f && gain == 0.0f;
+        bool finished = deck.endOfTrack.load(std::memory_order_acquire) && deck.ring.size() == 0;
+        if (fadedOut || finished) {
+            deck.state.store(DECK_IDLE, std::memory_order_release); // Hands the deck back to the worker
+        }
+    }
+}
+
+void pushRequest(MusicRequest request) {
+    {
+        std::lock_guard<std::mutex> lock(gRequestMutex);
+        if (!gWorkerRunning) {
+            return;
+        }
+        gRequests.push_back(std::move(request));
+    }
+    gRequestSignal.notify_one();
+}
+
+} // namespace
+
+bool initMusicStreaming() {
+    gMusicSampleRate = getMixerSampleRate();
+    if (gMusicSampleRate <= 0) {
+        std::cerr << "Music: the audio mixer is not running, music disabled." << std::endl;
+        return false;
+    }
+    gWorkerRunning = true;
+    gWorker = std::thread(musicWorker);
+    setMixerStream(mixMusic);
+    return true;
+}
+
+void closeMusicStreaming() {
+    if (!gWorker.joinable()) {
+        return;
+    }
+    setMixerStream(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(gRequestMutex);
+        gWorkerRunning = false;
+        gRequests.clear();
+    }
+    gRequestSignal.notify_one();
+    gWorker.join();
+    for (Deck& deck : gDecks) {
+        deck.state.store(DECK_IDLE, std::memory_order_relaxed);
+    }
+    Uint32 underruns = gUnderruns.load(std::memory_order_relaxed);
+    if (underruns > 0) {
+        std::cerr << "Music: " << underruns << " buffer underruns." << std::endl;
+    }
+}
+
+void playMusic(const char* path, float crossfadeSeconds, bool loop) {
+    pushRequest({ MusicRequestType::Play, path, crossfadeSeconds, loop });
+}
+
+void stopMusic(float fadeSeconds) {
+    pushRequest({ MusicRequestType::Stop, std::string(), fadeSeconds, false });
+}
+
+void setMusicVolume(float volume) {
+    gMusicVolume.store(volume < 0.0f ? 0.0f : (volume > 1.0f ? 1.0f : volume), std::memory_order_relaxed);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#ifndef MUSIC_STREAM_H
+#define MUSIC_STREAM_H
+
+// Streaming background music.
+//
+// A worker thread opens and decodes tracks a few KB at a time into a
+// per-track ring buffer; the audio mixer drains the ring from its callback
+// (see setMixerStream). Neither the game thread nor the audio thread ever
+// reads files or decodes. Looping tracks wrap back to the start inside the
+// decoder, so there is no gap at the loop point. Two tracks can play at once
+// so a new track can crossfade over the old one.
+//
+// Tracks are WAV files, either 16-bit PCM or IMA ADPCM (4:1 compressed, e.g.
+// "ffmpeg -i song.ogg -ar 44100 -c:a adpcm_ima_wav song.wav"), mono or
+// stereo, at the mixer's sample rate. Memory is fixed at about 176 KB per
+// track slot (128 KB ring, 32 KB decode buffer, 16 KB file buffer), however
+// long the track is.
+
+const float DEFAULT_MUSIC_CROSSFADE = 1.5f; // Seconds
+
+// Starts the decode worker and hooks music into the mixer. Needs initAudioMixer() first.
+bool initMusicStreaming();
+
+void closeMusicStreaming();
+
+// Starts a track, fading it in and any current track out over crossfadeSeconds
+// (0 = cut). Returns immediately; the file is opened on the worker thread.
+void playMusic(const char* path, float crossfadeSeconds, bool loop);
+
+void stopMusic(float fadeSeconds);
+
+// Linear volume for all music, 0..1
+void setMusicVolume(float volume);
+
+#endif
@@ -0,0 +1,547 @@
+#include "postfx.h"
+#include <algorithm>          // For std::min, std::max
+#include <condition_variable> // For waking the workers
+#include <iostream>           // For error output and level changes
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define POSTFX_SSE2 1
+#endif
+
+namespace {
+
+const int MAX_POSTFX_WORKERS = 3;   // Plus the calling thread; the stages are memory-bound beyond that
+const int BANDS_PER_THREAD = 2;     // Smaller bands even out threads that start late
+const int FULL_DOWNSAMPLE = 4;      // Glow resolution divider at PostFxLevel::Full
+const int REDUCED_DOWNSAMPLE = 8;   // And at PostFxLevel::Reduced
+
+// Binomial approximations of a Gaussian, normalized
+const float FULL_BLUR_WEIGHTS[] = { 1 / 256.0f, 8 / 256.0f, 28 / 256.0f, 56 / 256.0f, 70 / 256.0f, 56 / 256.0f, 28 / 256.0f, 8 / 256.0f, 1 / 256.0f };
+const float REDUCED_BLUR_WEIGHTS[] = { 1 / 16.0f, 4 / 16.0f, 6 / 16.0f, 4 / 16.0f, 1 / 16.0f };
+const int MAX_BLUR_RADIUS = 4;
+
+const float GLOW_THRESHOLD = 0.2f;  // Red minus blue (0 to 1) a pixel needs to glow
+const float BLOOM_STRENGTH = 1.6f;  // Blurred glow is added at this gain
+const float VISIBLE_BLOOM = 0.5f / (BLOOM_STRENGTH * 255.0f); // Less bloom than this rounds away
+const float TRAIL_DECAY = 0.72f;    // Share of last frame's glow kept for the motion blur
+const int SCANLINE_DIM = 184;       // Odd rows are scaled by this / 256
+
+const float AVERAGE_WEIGHT = 0.1f;  // Exponential moving average of the time per frame
+const int WARMUP_FRAMES = 10;       // Not counted: threads and caches are still warming up
+const float UPGRADE_FRACTION = 0.5f; // Step back up only when under half the budget...
+const int UPGRADE_FRAMES = 180;      // ...for this many frames in a row (3 s at 60 FPS),
+const int MAX_UPGRADE_FRAMES = 60 * 60; // doubled after every step down, up to a minute
+
+typedef void (*PostFxStage)(PostProcessor* post, int begin, int end);
+
+} // namespace
+
+struct PostProcessor {
+    int width;
+    int height;
+    PostFxSettings settings;
+    PostFxLevel level;
+    PostFxLevel cap;
+    PostFxLevel configuredLevel; // Level the glow buffers are sized for
+
+    // Automatic degradation
+    int frames;
+    float averageMs;
+    bool averageValid;
+    int calmFrames;
+    int upgradeFrames;
+    float transferMs; // Reported by the caller (setPostFxTransferTime), counted with each call
+    bool trial;       // This frame tries the level above Off; judged by the next beginPostFxFrame
+    float trialMs;    // The trial frame's own time, or negative if it was never applied
+
+    // Glow at 1 / scale resolution, four floats per pixel in the frame's byte
+    // order (B, G, R, unused). glow persists between frames for the motion blur.
+    int scale;
+    int lowWidth;
+    int lowHeight;
+    const float* blurWeights;
+    int blurRadius;
+    std::vector<float> glow, blurred, bloom;
+    std::vector<Uint8> bloomRowLit; // Whether each bloom row adds anything visible
+    std::vector<int> columnLeft, columnRight; // Bilinear taps of every full-resolution column
+    std::vector<float> columnWeight;
+
+    // Frame being processed
+    Uint32* pixels;
+    int pitch;
+
+    // Workers run bands of the current stage's rows alongside the calling thread
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::vector<std::thread> workers;
+    PostFxStage stage;
+    int stageRows;
+    int bandCount;
+    int nextBand;
+    int bandsLeft;
+    Uint64 generation;
+    bool running;
+};
+
+namespace {
+
+const char* getLevelName(PostFxLevel level) {
+    switch (level) {
+    case PostFxLevel::Full: return "full bloom";
+    case PostFxLevel::Reduced: return "reduced bloom";
+    case PostFxLevel::Scanlines: return "scanlines only";
+    default: return "off";
+    }
+}
+
+float* getGlowPixel(std::vector<float>& buffer, int lowWidth, int x, int y) {
+    return buffer.data() + (static_cast<size_t>(y) * lowWidth + x) * 4;
+}
+
+// --- Stages (each runs on a band of rows) ---
+
+// Scales a pixel by SCANLINE_DIM / 256 with two multiplies: red and blue share
+// one, the byte between them being enough headroom
+Uint32 dimPixel(Uint32 p) {
+    Uint32 redBlue = (((p & 0xFF00FF) * SCANLINE_DIM) >> 8) & 0xFF00FF;
+    Uint32 green = (((p & 0x00FF00) * SCANLINE_DIM) >> 8) & 0x00FF00;
+    return (p & 0xFF000000) | redBlue | green;
+}
+
+// Averages scale x scale blocks of the frame and keeps the warm part as glow,
+// faded into the previous frame's glow for the motion blur
+void downsampleStage(PostProcessor* post, int begin, int end) {
+    const Uint8* frame = reinterpret_cast<const Uint8*>(post->pixels);
+    int scale = post->scale;
+    float keep = post->settings.motionBlur ? TRAIL_DECAY : 0.0f;
+    for (int lowY = begin; lowY < end; ++lowY) {
+        int y0 = lowY * scale;
+        int y1 = std::min(post->height, y0 + scale);
+        for (int lowX = 0; lowX < post->lowWidth; ++lowX) {
+            int x0 = lowX * scale;
+            int x1 = std::min(post->width, x0 + scale);
+            // Every other pixel of every other row: glowing sprites are far larger than that
+            Uint32 sumR = 0, sumG = 0, sumB = 0, samples = 0;
+            for (int y = y0; y < y1; y += 2) {
+                const Uint32* row = reinterpret_cast<const Uint32*>(frame + static_cast<size_t>(y) * post->pitch);
+                for (int x = x0; x < x1; x += 2) {
+                    sumR += (row[x] >> 16) & 0xFF;
+                    sumG += (row[x] >> 8) & 0xFF;
+                    sumB += row[x] & 0xFF;
+                    samples++;
+                }
+            }
+            float normalize = 1.0f / (255.0f * samples);
+            float r = sumR * normalize, g = sumG * normalize, b = sumB * normalize;
+            float warmth = r - b;
+            float weight = warmth > GLOW_THRESHOLD ? (warmth - GLOW_THRESHOLD) / (1.0f - GLOW_THRESHOLD) : 0.0f;
+            float* out = getGlowPixel(post->glow, post->lowWidth, lowX, lowY);
+#ifdef POSTFX_SSE2
+            __m128 value = _mm_mul_ps(_mm_setr_ps(b, g, r, 0.0f), _mm_set1_ps(weight));
+            _mm_storeu_ps(out, _mm_max_ps(value, _mm_mul_ps(_mm_loadu_ps(out), _mm_set1_ps(keep))));
+#else
+            const float value[4] = { b * weight, g * weight, r * weight, 0.0f };
+            for (int c = 0; c < 4; ++c) {
+                out[c] = std::max(value[c], out[c] * keep);
+            }
+#endif
+        }
+    }
+}
+
+// Horizontal pass of the separable blur: glow -> blurred
+void blurRowsStage(PostProcessor* post, int begin, int end) {
+    int width = post->lowWidth;
+    int radius = post->blurRadius;
+#ifdef POSTFX_SSE2
+    __m128 weights[2 * MAX_BLUR_RADIUS + 1];
+    for (int t = 0; t <= 2 * radius; ++t) {
+        weights[t] = _mm_set1_ps(post->blurWeights[t]);
+    }
+#endif
+    for (int y = begin; y < end; ++y) {
+        const float* src = getGlowPixel(post->glow, width, 0, y);
+        float* dst = getGlowPixel(post->blurred, width, 0, y);
+        for (int x = 0; x < width; ++x) {
+#ifdef POSTFX_SSE2
+            __m128 sum = _mm_setzero_ps();
+            for (int t = -radius; t <= radius; ++t) {
+                int sx = std::min(width - 1, std::max(0, x + t));
+                sum = _mm_add_ps(sum, _mm_mul_ps(weights[t + radius], _mm_loadu_ps(src + sx * 4)));
+            }
+            _mm_storeu_ps(dst + x * 4, sum);
+#else
+            float sum[4] = {};
+            for (int t = -radius; t <= radius; ++t) {
+                int sx = std::min(width - 1, std::max(0, x + t));
+                for (int c = 0; c < 4; ++c) {
+                    sum[c] += post->blurWeights[t + radius] * src[sx * 4 + c];
+                }
+            }
+            for (int c = 0; c < 4; ++c) {
+                dst[x * 4 + c] = sum[c];
+            }
+#endif
+        }
+    }
+}
+
+// Vertical pass: blurred -> bloom, a whole row of taps at a time so reads stay contiguous
+void blurColumnsStage(PostProcessor* post, int begin, int end) {
+    int width = post->lowWidth;
+    int radius = post->blurRadius;
+    int floats = width * 4;
+    for (int y = begin; y < end; ++y) {
+        float* dst = getGlowPixel(post->bloom, width, 0, y);
+        std::fill(dst, dst + floats, 0.0f);
+        for (int t = -radius; t <= radius; ++t) {
+            int sy = std::min(post->lowHeight - 1, std::max(0, y + t));
+            const float* src = getGlowPixel(post->blurred, width, 0, sy);
+            float weight = post->blurWeights[t + radius];
+            int i = 0;
+#ifdef POSTFX_SSE2
+            __m128 w = _mm_set1_ps(weight);
+            for (; i < floats; i += 4) {
+                _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(w, _mm_loadu_ps(src + i))));
+            }
+#endif
+            for (; i < floats; ++i) {
+                dst[i] += weight * src[i];
+            }
+        }
+        post->bloomRowLit[y] = *std::max_element(dst, dst + floats) >= VISIBLE_BLOOM;
+    }
+}
+
+// Adds the bilinearly upsampled bloom to the frame and darkens the scanlines
+void compositeStage(PostProcessor* post, int begin, int end) {
+    thread_local std::vector<float> bloomRow; // Bloom interpolated to the row's height
+    thread_local std::vector<Uint8> lit;      // Whether each bloomRow pixel adds anything
+    int lowWidth = post->lowWidth;
+    bloomRow.resize(static_cast<size_t>(lowWidth) * 4);
+    lit.resize(lowWidth);
+    Uint8* frame = reinterpret_cast<Uint8*>(post->pixels);
+    for (int y = begin; y < end; ++y) {
+        float sourceY = std::max(0.0f, (y + 0.5f) / post->scale - 0.5f);
+        int y0 = std::min(post->lowHeight - 1, static_cast<int>(sourceY));
+        int y1 = std::min(post->lowHeight - 1, y0 + 1);
+        float ty = sourceY - y0;
+        bool scanline = post->settings.scanlines && (y & 1);
+        Uint32* row = reinterpret_cast<Uint32*>(frame + static_cast<size_t>(y) * post->pitch);
+        if (!post->bloomRowLit[y0] && !post->bloomRowLit[y1]) {
+            // Most rows have no glow at all: just the scanline, in integers
+            for (int x = 0; scanline && x < post->width; ++x) {
+                row[x] = dimPixel(row[x]);
+            }
+            continue;
+        }
+        const float* top = getGlowPixel(post->bloom, lowWidth, 0, y0);
+        const float* bottom = getGlowPixel(post->bloom, lowWidth, 0, y1);
+        for (int lowX = 0; lowX < lowWidth; ++lowX) {
+            float peak = 0.0f;
+            for (int c = lowX * 4; c < lowX * 4 + 4; ++c) {
+                bloomRow[c] = (top[c] + (bottom[c] - top[c]) * ty) * (BLOOM_STRENGTH * 255.0f);
+                peak = std::max(peak, bloomRow[c]);
+            }
+            lit[lowX] = peak >= 0.5f; // Would round to nothing otherwise
+        }
+
+        float dim = scanline ? SCANLINE_DIM / 256.0f : 1.0f;
+        for (int x = 0; x < post->width; ++x) {
+            if (!lit[post->columnLeft[x]] && !lit[post->columnRight[x]]) {
+                if (scanline) {
+                    row[x] = dimPixel(row[x]);
+                }
+                continue;
+            }
+            const float* left = &bloomRow[post->columnLeft[x] * 4];
+            const float* right = &bloomRow[post->columnRight[x] * 4];
+            float tx = post->columnWeight[x];
+#ifdef POSTFX_SSE2
+            __m128 l = _mm_loadu_ps(left);
+            __m128 glow = _mm_add_ps(l, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(right), l), _mm_set1_ps(tx)));
+            __m128i zero = _mm_setzero_si128();
+            __m128i channels = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(row[x])), zero), zero);
+            __m128 color = _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(channels), glow), _mm_set1_ps(dim));
+            __m128i packed = _mm_cvttps_epi32(_mm_add_ps(color, _mm_set1_ps(0.5f))); // Rounds like the scalar path, not to even
+            packed = _mm_packs_epi32(packed, packed);
+            packed = _mm_packus_epi16(packed, packed); // Saturates to 0-255
+            row[x] = static_cast<Uint32>(_mm_cvtsi128_si32(packed)) | 0xFF000000;
+#else
+            Uint32 out = 0xFF000000;
+            for (int c = 0; c < 3; ++c) {
+                float glow = left[c] + (right[c] - left[c]) * tx;
+                float value = (((row[x] >> (c * 8)) & 0xFF) + glow) * dim + 0.5f;
+                out |= static_cast<Uint32>(std::min(255.0f, value)) << (c * 8);
+            }
+            row[x] = out;
+#endif
+        }
+    }
+}
+
+// Scanlines without bloom
+void scanlineStage(PostProcessor* post, int begin, int end) {
+    Uint8* frame = reinterpret_cast<Uint8*>(post->pixels);
+    for (int y = begin | 1; y < end; y += 2) {
+        Uint32* row = reinterpret_cast<Uint32*>(frame + static_cast<size_t>(y) * post->pitch);
+        for (int x = 0; x < post->width; ++x) {
+            row[x] = dimPixel(row[x]);
+        }
+    }
+}
+
+// --- Workers ---
+
+// Runs bands of the current stage until there are none left to take
+void runBands(PostProcessor* post) {
+    for (;;) {
+        PostFxStage stage;
+        int begin, end;
+        {
+            std::lock_guard<std::mutex> lock(post->mutex);
+            if (post->nextBand >= post->bandCount) {
+                return;
+            }
+            int band = post->nextBand++;
+            stage = post->stage;
+            begin = post->stageRows * band / post->bandCount;
+            end = post->stageRows * (band + 1) / post->bandCount;
+        }
+        stage(post, begin, end);
+        std::lock_guard<std::mutex> lock(post->mutex);
+        if (--post->bandsLeft == 0) {
+            post->finished.notify_one();
+        }
+    }
+}
+
+void postFxWorker(PostProcessor* post) {
+    Uint64 seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(post->mutex);
+            post->wake.wait(lock, [post, seen] { return post->generation != seen || !post->running; });
+            if (!post->running) {
+                return;
+            }
+            seen = post->generation;
+        }
+        runBands(post);
+    }
+}
+
+// Runs stage over rows rows on every thread and returns once all bands are done
+void runStage(PostProcessor* post, PostFxStage stage, int rows) {
+    {
+        std::lock_guard<std::mutex> lock(post->mutex);
+        post->stage = stage;
+        post->stageRows = rows;
+        post->bandCount = std::max(1, std::min(rows, static_cast<int>(post->workers.size() + 1) * BANDS_PER_THREAD));
+        post->nextBand = 0;
+        post->bandsLeft = post->bandCount;
+        post->generation++;
+        post->wake.notify_all();
+    }
+    runBands(post);
+    std::unique_lock<std::mutex> lock(post->mutex);
+    post->finished.wait(lock, [post] { return post->bandsLeft == 0; });
+}
+
+// Sizes the glow buffers and blur for the current level; the motion blur starts over
+void configureLevel(PostProcessor* post) {
+    bool full = post->level == PostFxLevel::Full;
+    post->scale = full ? FULL_DOWNSAMPLE : REDUCED_DOWNSAMPLE;
+    post->blurWeights = full ? FULL_BLUR_WEIGHTS : REDUCED_BLUR_WEIGHTS;
+    post->blurRadius = full ? MAX_BLUR_RADIUS : 2;
+    post->lowWidth = (post->width + post->scale - 1) / post->scale;
+    post->lowHeight = (post->height + post->scale - 1) / post->scale;
+    size_t floats = static_cast<size_t>(post->lowWidth) * post->lowHeight * 4;
+    post->glow.assign(floats, 0.0f);
+    post->blurred.assign(floats, 0.0f);
+    post->bloom.assign(floats, 0.0f);
+    post->bloomRowLit.assign(post->lowHeight, 0);
+    for (int x = 0; x < post->width; ++x) {
+        float sourceX = std::max(0.0f, (x + 0.5f) / post->scale - 0.5f);
+        post->columnLeft[x] = std::min(post->lowWidth - 1, static_cast<int>(sourceX));
+        post->columnRight[x] = std::min(post->lowWidth - 1, post->columnLeft[x] + 1);
+        post->columnWeight[x] = sourceX - post->columnLeft[x];
+    }
+    post->configuredLevel = post->level;
+}
+
+// Steps the level down when over budget, and back up after a long calm stretch
+void adjustLevel(PostProcessor* post, float ms) {
+    if (++post->frames <= WARMUP_FRAMES) {
+        return;
+    }
+    if (!post->averageValid) {
+        post->averageMs = ms;
+        post->averageValid = true;
+    }
+    else {
+        post->averageMs += (ms - post->averageMs) * AVERAGE_WEIGHT;
+    }
+
+    PostFxLevel previous = post->level;
+    if (post->averageMs > post->settings.budgetMs && post->level > PostFxLevel::Off) {
+        post->level = static_cast<PostFxLevel>(static_cast<int>(post->level) - 1);
+        post->upgradeFrames = std::min(post->upgradeFrames * 2, MAX_UPGRADE_FRAMES); // Do not bounce straight back
+        post->calmFrames = 0;
+    }
+    else if (post->averageMs < post->settings.budgetMs * UPGRADE_FRACTION && post->level < post->cap) {
+        if (++post->calmFrames >= post->upgradeFrames) {
+            post->level = static_cast<PostFxLevel>(static_cast<int>(post->level) + 1);
+            post->calmFrames = 0;
+        }
+    }
+    else {
+        post->calmFrames = 0;
+    }
+    if (post->level != previous) {
+        std::cout << "Post-processing averaged " << post->averageMs << " ms (budget " << post->settings.budgetMs << " ms); switching to "
+                  << getLevelName(post->level) << "." << std::endl;
+        post->averageValid = false; // Measure the new level from scratch
+    }
+}
+
+} // namespace
+
+PostProcessor* createPostProcessor(int width, int height, const PostFxSettings& settings) {
+    if (width <= 0 || height <= 0) {
+        std::cerr << "Cannot post-process " << width << "x" << height << " frames." << std::endl;
+        return nullptr;
+    }
+    PostProcessor* post = new PostProcessor();
+    post->width = width;
+    post->height = height;
+    post->settings = settings;
+    post->level = PostFxLevel::Full;
+    post->cap = PostFxLevel::Full;
+    post->frames = 0;
+    post->averageMs = 0.0f;
+    post->averageValid = false;
+    post->calmFrames = 0;
+    post->upgradeFrames = UPGRADE_FRAMES;
+    post->transferMs = 0.0f;
+    post->trial = false;
+    post->trialMs = 0.0f;
+    post->pixels = nullptr;
+    post->pitch = 0;
+    post->columnLeft.resize(width);
+    post->columnRight.resize(width);
+    post->columnWeight.resize(width);
+    configureLevel(post);
+
+    post->stage = nullptr;
+    post->stageRows = 0;
+    post->bandCount = 0;
+    post->nextBand = 0;
+    post->bandsLeft = 0;
+    post->generation = 0;
+    post->running = true;
+    // Leave a core for the game itself; the calling thread works too
+    int workerCount = std::max(0, std::min(MAX_POSTFX_WORKERS, static_cast<int>(std::thread::hardware_concurrency()) - 2));
+    for (int i = 0; i < workerCount; ++i) {
+        post->workers.emplace_back(postFxWorker, post);
+    }
+    return post;
+}
+
+bool beginPostFxFrame(PostProcessor* post) {
+    if (post == nullptr) {
+        return false;
+    }
+    if (post->trial) {
+        // The caller has reported the trial frame's own round trip by now
+        post->trial = false;
+        float ms = post->trialMs + post->transferMs;
+        if (post->trialMs >= 0.0f && ms < post->settings.budgetMs * UPGRADE_FRACTION) {
+            std::cout << "Post-processing trial frame took " << ms << " ms (budget " << post->settings.budgetMs << " ms); switching to "
+                      << getLevelName(post->level) << "." << std::endl;
+            post->averageValid = false;
+            return true;
+        }
+        post->level = PostFxLevel::Off;
+    }
+    if (post->level > PostFxLevel::Off) {
+        return true;
+    }
+    if (post->cap == PostFxLevel::Off || ++post->calmFrames < post->upgradeFrames) {
+        return false;
+    }
+    post->calmFrames = 0;
+    post->level = PostFxLevel::Scanlines;
+    post->trial = true;
+    post->trialMs = -1.0f;
+    return true;
+}
+
+void applyPostProcessing(PostProcessor* post, Uint32* pixels, int pitch) {
+    if (post == nullptr) {
+        return;
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+    post->level = std::min(post->level, post->cap);
+    bool bloom = post->settings.bloom && post->level >= PostFxLevel::Reduced;
+    bool scanlines = post->settings.scanlines && post->level >= PostFxLevel::Scanlines;
+    post->pixels = pixels;
+    post->pitch = pitch;
+    if (bloom) {
+        if (post->configuredLevel != post->level) {
+            configureLevel(post);
+        }
+        runStage(post, downsampleStage, post->lowHeight);
+        runStage(post, blurRowsStage, post->lowHeight);
+        runStage(post, blurColumnsStage, post->lowHeight);
+        runStage(post, compositeStage, post->height); // Scanlines included
+    }
+    else if (scanlines) {
+        runStage(post, scanlineStage, post->height);
+    }
+    float ms = static_cast<float>((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+    if (post->trial) {
+        post->trialMs = ms; // Its own transfer time is reported after this call
+        return;
+    }
+    adjustLevel(post, ms + post->transferMs);
+}
+
+void destroyPostProcessor(PostProcessor* post) {
+    if (post == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(post->mutex);
+        post->running = false;
+        post->wake.notify_all();
+    }
+    for (std::thread& worker : post->workers) {
+        worker.join();
+    }
+    delete post;
+}
+
+PostFxLevel getPostFxLevel(const PostProcessor* post) {
+    return post ? post->level : PostFxLevel::Off;
+}
+
+void setPostFxLevelCap(PostProcessor* post, PostFxLevel cap) {
+    if (post) {
+        post->cap = cap;
+    }
+}
+
+void setPostFxTransferTime(PostProcessor* post, float ms) {
+    if (post) {
+        post->transferMs = ms;
+    }
+}
+
+float getPostFxAverageMs(const PostProcessor* post) {
+    return post && post->averageValid ? post->averageMs : 0.0f;
+}
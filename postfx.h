@@ -0,0 +1,79 @@
+#pragma once
+#ifndef POSTFX_H
+#define POSTFX_H
+
+#include <SDL.h>
+
+// CPU post-processing of finished frames, for the kiosk attract mode:
+//
+//   Bloom        The ball and coins glow. Bright warm pixels (red clearly above
+//                blue: the red ball and gold coins, but not the blue/green
+//                paddles, white text or the background) are averaged down to a
+//                quarter of the resolution, blurred with a separable Gaussian
+//                and added back on top.
+//   Motion blur  The glow buffer keeps a fading copy of previous frames, so the
+//                moving ball leaves a short streak; still coins are unaffected.
+//   Scanlines    Every other row is darkened like a CRT.
+//
+// The work is split into bands of rows that run on a few worker threads plus
+// the calling thread, and the blurs use SSE2 where available (four channels of
+// a pixel at once). No GPU is needed: frames come from the software renderer's
+// surface, or are read back from an accelerated renderer.
+//
+// Each call is timed, together with any transfer time the caller reports for
+// getting frames to and from the CPU (see setPostFxTransferTime). When the
+// average goes over the budget, the effects step
+// down one level (smaller blur at an eighth of the resolution, then scanlines
+// only, then nothing); after a long stretch well under budget they step back
+// up, never above the level cap. Once the effects are off the caller skips
+// them and the transfers entirely (see beginPostFxFrame), so stepping back up
+// from there is decided by a single timed trial frame instead.
+
+enum class PostFxLevel { Off, Scanlines, Reduced, Full };
+
+struct PostFxSettings {
+    bool bloom = true;
+    bool motionBlur = true;  // Needs bloom; the streak is made of glow
+    bool scanlines = true;
+    float budgetMs = 4.0f;   // Time per frame the effects may take
+};
+
+struct PostProcessor;
+
+// Prepares buffers and worker threads for width x height frames. Returns
+// nullptr (and prints why) on failure.
+PostProcessor* createPostProcessor(int width, int height, const PostFxSettings& settings);
+
+// Whether to post-process this frame. False while the level is Off, apart from
+// an occasional trial frame at the next level up: the caller then reads the
+// frame back, applies the effects, uploads the result and reports the transfer
+// time as usual, and the next call keeps the level if the whole trial frame
+// came in well under budget. Call once per displayed frame, before reading the
+// frame back; skip the transfers and applyPostProcessing when it returns false.
+bool beginPostFxFrame(PostProcessor* post);
+
+// Applies the effects in place. pixels are 32-bit with red in bits 16-23 and
+// blue in bits 0-7 (SDL_PIXELFORMAT_ARGB8888 or RGB888); alpha is not used.
+// Call once per displayed frame: the motion blur fades per call.
+void applyPostProcessing(PostProcessor* post, Uint32* pixels, int pitch);
+
+void destroyPostProcessor(PostProcessor* post);
+
+// The level in use after automatic degradation
+PostFxLevel getPostFxLevel(const PostProcessor* post);
+
+// Highest level the automatic adjustment may go back up to (Full by default).
+// Lowering it below the current level takes effect on the next frame.
+void setPostFxLevelCap(PostProcessor* post, PostFxLevel cap);
+
+// Time spent each frame only because the effects run on the CPU: reading an
+// accelerated renderer's frame back and uploading the result. Counted against
+// the budget with every following call until reported again; the software
+// renderer's surface needs none (0, the default).
+void setPostFxTransferTime(PostProcessor* post, float ms);
+
+// Average milliseconds per frame of the effects (applyPostProcessing plus the
+// transfer time), over the last few frames
+float getPostFxAverageMs(const PostProcessor* post);
+
+#endif
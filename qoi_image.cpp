@@ -0,0 +1,184 @@
+#include "qoi_image.h"
+#include <cstring> // For memcmp
+
+namespace {
+
+const Uint8 QOI_OP_INDEX = 0x00; // 00xxxxxx
+const Uint8 QOI_OP_DIFF = 0x40;  // 01xxxxxx
+const Uint8 QOI_OP_LUMA = 0x80;  // 10xxxxxx
+const Uint8 QOI_OP_RUN = 0xC0;   // 11xxxxxx
+const Uint8 QOI_OP_RGB = 0xFE;
+const Uint8 QOI_OP_RGBA = 0xFF;
+const Uint8 QOI_MASK = 0xC0;
+const Uint8 QOI_END_MARKER[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+const int QOI_MAX_DIMENSION = 16384;
+
+struct Rgba {
+    Uint8 r, g, b, a;
+};
+
+inline int qoiHash(const Rgba& p) {
+    return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) & 63;
+}
+
+inline bool samePixel(const Rgba& x, const Rgba& y) {
+    return x.r == y.r && x.g == y.g && x.b == y.b && x.a == y.a;
+}
+
+void write32BE(std::vector<Uint8>& out, Uint32 value) {
+    out.push_back(static_cast<Uint8>(value >> 24));
+    out.push_back(static_cast<Uint8>(value >> 16));
+    out.push_back(static_cast<Uint8>(value >> 8));
+    out.push_back(static_cast<Uint8>(value));
+}
+
+Uint32 read32BE(const Uint8* p) {
+    return (static_cast<Uint32>(p[0]) << 24) | (static_cast<Uint32>(p[1]) << 16) | (static_cast<Uint32>(p[2]) << 8) | p[3];
+}
+
+} // namespace
+
+std::vector<Uint8> encodeQoi(const Uint8* rgba, int width, int height) {
+    std::vector<Uint8> out;
+    out.reserve(QOI_HEADER_BYTES + static_cast<size_t>(width) * height * 5 + sizeof(QOI_END_MARKER));
+    out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+    write32BE(out, static_cast<Uint32>(width));
+    write32BE(out, static_cast<Uint32>(height));
+    out.push_back(4); // Channels: RGBA
+    out.push_back(0); // Colorspace: sRGB with linear alpha
+
+    Rgba index[64] = {};
+    Rgba previous = { 0, 0, 0, 255 };
+    int run = 0;
+    size_t count = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < count; ++i) {
+        Rgba pixel = { rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2], rgba[i * 4 + 3] };
+        if (samePixel(pixel, previous)) {
+            run++;
+            if (run == 62 || i + 1 == count) {
+                out.push_back(static_cast<Uint8>(QOI_OP_RUN | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            out.push_back(static_cast<Uint8>(QOI_OP_RUN | (run - 1)));
+            run = 0;
+        }
+
+        int hash = qoiHash(pixel);
+        if (samePixel(index[hash], pixel)) {
+            out.push_back(static_cast<Uint8>(QOI_OP_INDEX | hash));
+        }
+        else {
+            index[hash] = pixel;
+            if (pixel.a == previous.a) {
+                int dr = static_cast<Sint8>(pixel.r - previous.r);
+                int dg = static_cast<Sint8>(pixel.g - previous.g);
+                int db = static_cast<Sint8>(pixel.b - previous.b);
+                int drg = dr - dg;
+                int dbg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    out.push_back(static_cast<Uint8>(QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+                }
+                else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                    out.push_back(static_cast<Uint8>(QOI_OP_LUMA | (dg + 32)));
+                    out.push_back(static_cast<Uint8>(((drg + 8) << 4) | (dbg + 8)));
+                }
+                else {
+                    out.insert(out.end(), { QOI_OP_RGB, pixel.r, pixel.g, pixel.b });
+                }
+            }
+            else {
+                out.insert(out.end(), { QOI_OP_RGBA, pixel.r, pixel.g, pixel.b, pixel.a });
+            }
+        }
+        previous = pixel;
+    }
+    out.insert(out.end(), QOI_END_MARKER, QOI_END_MARKER + sizeof(QOI_END_MARKER));
+    return out;
+}
+
+bool readQoiHeader(const Uint8* data, size_t size, int& width, int& height) {
+    if (size < QOI_HEADER_BYTES + sizeof(QOI_END_MARKER) || memcmp(data, "qoif", 4) != 0) {
+        return false;
+    }
+    Uint32 w = read32BE(data + 4);
+    Uint32 h = read32BE(data + 8);
+    if (w == 0 || h == 0 || w > QOI_MAX_DIMENSION || h > QOI_MAX_DIMENSION) {
+        return false;
+    }
+    width = static_cast<int>(w);
+    height = static_cast<int>(h);
+    return true;
+}
+
+bool decodeQoi(const Uint8* data, size_t size, Uint32 pixelFormat, Uint32* pixels) {
+    int width, height;
+    if (!readQoiHeader(data, size, width, height)) {
+        return false;
+    }
+    // Byte positions of R and B in the output word; G and A are the same in both formats
+    const int redShift = pixelFormat == SDL_PIXELFORMAT_ABGR8888 ? 0 : 16;
+    const int blueShift = 16 - redShift;
+
+    Rgba index[64] = {};
+    Rgba pixel = { 0, 0, 0, 255 };
+    const Uint8* p = data + QOI_HEADER_BYTES;
+    const Uint8* end = data + size - sizeof(QOI_END_MARKER);
+    size_t count = static_cast<size_t>(width) * height;
+    Uint32 packed = (255u << 24); // Opaque black, the initial "previous" pixel
+    size_t i = 0;
+    while (i < count) {
+        if (p >= end) {
+            return false; // Truncated
+        }
+        Uint8 op = *p++;
+        if (op == QOI_OP_RGB) {
+            if (end - p < 3) return false;
+            pixel.r = p[0];
+            pixel.g = p[1];
+            pixel.b = p[2];
+            p += 3;
+        }
+        else if (op == QOI_OP_RGBA) {
+            if (end - p < 4) return false;
+            pixel.r = p[0];
+            pixel.g = p[1];
+            pixel.b = p[2];
+            pixel.a = p[3];
+            p += 4;
+        }
+        else if ((op & QOI_MASK) == QOI_OP_INDEX) {
+            pixel = index[op];
+        }
+        else if ((op & QOI_MASK) == QOI_OP_DIFF) {
+            pixel.r = static_cast<Uint8>(pixel.r + ((op >> 4) & 3) - 2);
+            pixel.g = static_cast<Uint8>(pixel.g + ((op >> 2) & 3) - 2);
+            pixel.b = static_cast<Uint8>(pixel.b + (op & 3) - 2);
+        }
+        else if ((op & QOI_MASK) == QOI_OP_LUMA) {
+            if (p >= end) return false;
+            int dg = (op & 0x3F) - 32;
+            Uint8 second = *p++;
+            pixel.r = static_cast<Uint8>(pixel.r + dg - 8 + ((second >> 4) & 0x0F));
+            pixel.g = static_cast<Uint8>(pixel.g + dg);
+            pixel.b = static_cast<Uint8>(pixel.b + dg - 8 + (second & 0x0F));
+        }
+        else { // QOI_OP_RUN: repeat the previous pixel
+            size_t run = static_cast<size_t>(op & 0x3F) + 1;
+            if (run > count - i) {
+                return false;
+            }
+            for (size_t k = 0; k < run; ++k) {
+                pixels[i++] = packed;
+            }
+            continue;
+        }
+        index[qoiHash(pixel)] = pixel;
+        packed = (static_cast<Uint32>(pixel.a) << 24) | (static_cast<Uint32>(pixel.r) << redShift) |
+                 (static_cast<Uint32>(pixel.g) << 8) | (static_cast<Uint32>(pixel.b) << blueShift);
+        pixels[i++] = packed;
+    }
+    return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#ifndef QOI_IMAGE_H
+#define QOI_IMAGE_H
+
+#include <SDL.h>
+#include <cstddef>
+#include <vector>
+
+// QOI ("Quite OK Image") encoding and decoding.
+//
+// A single-pass, byte-oriented lossless format: each pixel is a run, a cache
+// hit, a small delta from the previous pixel or a literal, so decoding is one
+// tight loop with no entropy coding. Files follow the public QOI
+// specification and can be inspected with any QOI viewer.
+
+const size_t QOI_HEADER_BYTES = 14;
+
+// Encodes width * height RGBA pixels (4 bytes each, in R, G, B, A order)
+std::vector<Uint8> encodeQoi(const Uint8* rgba, int width, int height);
+
+// Reads width and height from a QOI header. Returns false if data is not QOI.
+bool readQoiHeader(const Uint8* data, size_t size, int& width, int& height);
+
+// Decodes into 32-bit pixels laid out as pixelFormat (SDL_PIXELFORMAT_ARGB8888
+// or SDL_PIXELFORMAT_ABGR8888), so they can be uploaded without conversion.
+// pixels must hold width * height values. Returns false on corrupt data.
+bool decodeQoi(const Uint8* data, size_t size, Uint32 pixelFormat, Uint32* pixels);
+
+#endif
@@ -0,0 +1,206 @@
+#include "quality_governor.h"
+#include <algorithm> // For std::nth_element, std::min
+#include <cmath>     // For std::lround
+#include <iostream>  // For decisions and error output
+
+namespace {
+
+// Lowest quality first. Each step gives up the least visible thing that is
+// left: off-focus animation and text refreshes, then the bloom, then pixels.
+const QualityKnobs QUALITY_LEVELS[] = {
+    { PostFxLevel::Off,       0.5f,  250, 1000 },
+    { PostFxLevel::Scanlines, 0.75f, 250, 500 },
+    { PostFxLevel::Reduced,   1.0f,  125, 250 },
+    { PostFxLevel::Full,      1.0f,  125, 250 },
+    { PostFxLevel::Full,      1.0f,  0,   0 },
+};
+const int QUALITY_LEVEL_COUNT = sizeof(QUALITY_LEVELS) / sizeof(QUALITY_LEVELS[0]);
+
+const int SAMPLE_FRAMES = 120;     // Percentiles cover the last 2 s at 60 FPS
+const int MIN_SAMPLES = 60;        // After a change, a second of the new level before judging it
+const int EVALUATION_FRAMES = 30;  // Decide twice a second
+
+const float DEGRADE_WORK_FRACTION = 0.85f; // 95th percentile of the work this close to the budget...
+const float MISSED_FRAME_FRACTION = 1.25f; // ...or of the interval this far over it
+const float UPGRADE_WORK_FRACTION = 0.5f;  // 99th percentile of the work under this to step up...
+const int UPGRADE_WINDOWS = 6;             // ...for this many windows in a row (3 s),
+const int MAX_UPGRADE_WINDOWS = 120;       // doubled when a step up is taken back, up to a minute
+
+const char* getPostFxName(PostFxLevel level) {
+    switch (level) {
+    case PostFxLevel::Full: return "full";
+    case PostFxLevel::Reduced: return "reduced";
+    case PostFxLevel::Scanlines: return "scanlines";
+    default: return "off";
+    }
+}
+
+// The p-th percentile (0 to 1) of the first count values of ring
+float getPercentile(const std::vector<float>& ring, int count, float p) {
+    thread_local std::vector<float> sorted;
+    sorted.assign(ring.begin(), ring.begin() + count);
+    int index = std::min(count - 1, static_cast<int>(p * count));
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+void printKnobs(std::ostream& out, const QualityKnobs& knobs) {
+    out << "effects " << getPostFxName(knobs.postFxCap) << ", resolution " << static_cast<int>(knobs.renderScale * 100) << "%, off-focus animation ";
+    if (knobs.offFocusAnimationMs) {
+        out << "every " << knobs.offFocusAnimationMs << " ms";
+    }
+    else {
+        out << "every frame";
+    }
+    out << ", text redraws ";
+    if (knobs.textRedrawMs) {
+        out << "every " << knobs.textRedrawMs << " ms";
+    }
+    else {
+        out << "immediate";
+    }
+}
+
+} // namespace
+
+void initQualityGovernor(QualityGovernor& governor, const char* name, float targetFps) {
+    governor.name = name;
+    governor.budgetMs = 1000.0f / targetFps;
+    governor.maxLevel = QUALITY_LEVEL_COUNT - 1;
+    governor.level = governor.maxLevel;
+    governor.workMs.assign(SAMPLE_FRAMES, 0.0f);
+    governor.intervalMs.assign(SAMPLE_FRAMES, 0.0f);
+    governor.sampleCount = 0;
+    governor.nextSample = 0;
+    governor.framesSinceEvaluation = 0;
+    governor.calmWindows = 0;
+    governor.upgradeWindows = UPGRADE_WINDOWS;
+    governor.lastStepUp = false;
+    governor.evaluations = 0;
+    governor.startCounter = SDL_GetPerformanceCounter();
+}
+
+bool openQualityTelemetry(QualityGovernor& governor, const char* path) {
+    governor.telemetry.open(path);
+    if (!governor.telemetry) {
+        std::cerr << "Could not create " << path << " for quality telemetry." << std::endl;
+        return false;
+    }
+    governor.telemetry << "seconds,level,decision,work_p50_ms,work_p95_ms,work_p99_ms,interval_p50_ms,interval_p95_ms,budget_ms" << std::endl;
+    return true;
+}
+
+void closeQualityGovernor(QualityGovernor& governor) {
+    if (governor.telemetry.is_open()) {
+        governor.telemetry.close();
+        std::cout << governor.name << ": " << governor.evaluations << " quality evaluations written." << std::endl;
+    }
+}
+
+bool recordFrameTime(QualityGovernor& governor, float workMs, float intervalMs) {
+    if (governor.workMs.empty()) {
+        return false; // Not initialized
+    }
+    governor.workMs[governor.nextSample] = workMs;
+    governor.intervalMs[governor.nextSample] = intervalMs;
+    governor.nextSample = (governor.nextSample + 1) % SAMPLE_FRAMES;
+    governor.sampleCount = std::min(governor.sampleCount + 1, SAMPLE_FRAMES);
+    if (++governor.framesSinceEvaluation < EVALUATION_FRAMES || governor.sampleCount < MIN_SAMPLES) {
+        return false;
+    }
+    governor.framesSinceEvaluation = 0;
+    governor.evaluations++;
+
+    // The ring is not in frame order once it wraps, which percentiles do not mind
+    int count = governor.sampleCount;
+    float work50 = getPercentile(governor.workMs, count, 0.5f);
+    float work95 = getPercentile(governor.workMs, count, 0.95f);
+    float work99 = getPercentile(governor.workMs, count, 0.99f);
+    float interval50 = getPercentile(governor.intervalMs, count, 0.5f);
+    float interval95 = getPercentile(governor.intervalMs, count, 0.95f);
+
+    int previous = governor.level;
+    bool missingFrames = interval95 > governor.budgetMs * MISSED_FRAME_FRACTION;
+    const char* decision = "hold";
+    if ((work95 > governor.budgetMs * DEGRADE_WORK_FRACTION || missingFrames) && governor.level > 0) {
+        governor.level--;
+        if (governor.lastStepUp) {
+            governor.upgradeWindows = std::min(governor.upgradeWindows * 2, MAX_UPGRADE_WINDOWS); // Do not bounce straight back
+        }
+        governor.lastStepUp = false;
+        governor.calmWindows = 0;
+        decision = "down";
+    }
+    else if (work99 < governor.budgetMs * UPGRADE_WORK_FRACTION && !missingFrames && governor.level < governor.maxLevel) {
+        if (++governor.calmWindows >= governor.upgradeWindows) {
+            governor.level++;
+            governor.lastStepUp = true;
+            governor.calmWindows = 0;
+            decision = "up";
+        }
+    }
+    else {
+        governor.calmWindows = 0;
+    }
+
+    float seconds = static_cast<float>((SDL_GetPerformanceCounter() - governor.startCounter) / static_cast<double>(SDL_GetPerformanceFrequency()));
+    if (governor.telemetry.is_open()) {
+        governor.telemetry << seconds << ',' << governor.level << ',' << decision << ',' << work50 << ',' << work95 << ',' << work99 << ','
+                           << interval50 << ',' << interval95 << ',' << governor.budgetMs << '\n';
+    }
+    if (governor.level == previous) {
+        return false;
+    }
+    std::cout << governor.name << " quality " << previous << " -> " << governor.level << " at " << seconds << " s (work p50/p95/p99 "
+              << work50 << "/" << work95 << "/" << work99 << " ms, frame interval p95 " << interval95 << " ms, budget "
+              << governor.budgetMs << " ms): ";
+    printKnobs(std::cout, getQualityKnobs(governor));
+    std::cout << "." << std::endl;
+    governor.sampleCount = 0; // Judge the new level on its own frames
+    governor.nextSample = 0;
+    return true;
+}
+
+const QualityKnobs& getQualityKnobs(const QualityGovernor& governor) {
+    return QUALITY_LEVELS[std::min(std::max(governor.level, 0), QUALITY_LEVEL_COUNT - 1)];
+}
+
+bool beginSceneRender(SceneTarget& scene, SDL_Renderer* renderer, float scale) {
+    int outputWidth, outputHeight;
+    if (scale >= 1.0f || !SDL_RenderTargetSupported(renderer) || SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight) != 0) {
+        return false;
+    }
+    int width = std::max(1, static_cast<int>(std::lround(outputWidth * scale)));
+    int height = std::max(1, static_cast<int>(std::lround(outputHeight * scale)));
+    if (scene.texture == nullptr || width != scene.width || height != scene.height) {
+        freeSceneTarget(scene);
+        scene.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+        if (scene.texture == nullptr) {
+            std::cerr << "Failed to create scene texture! SDL_Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+        scene.width = width;
+        scene.height = height;
+        SDL_SetTextureScaleMode(scene.texture, SDL_ScaleModeLinear); // Smoother than repeated pixels when stretched
+        SDL_SetTextureBlendMode(scene.texture, SDL_BLENDMODE_NONE);
+    }
+    if (SDL_SetRenderTarget(renderer, scene.texture) != 0) {
+        std::cerr << "Failed to render into scene texture! SDL_Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    SDL_RenderSetScale(renderer, static_cast<float>(width) / outputWidth, static_cast<float>(height) / outputHeight);
+    return true;
+}
+
+void endSceneRender(SceneTarget& scene, SDL_Renderer* renderer) {
+    SDL_SetRenderTarget(renderer, nullptr);
+    SDL_RenderCopy(renderer, scene.texture, nullptr, nullptr);
+}
+
+void freeSceneTarget(SceneTarget& scene) {
+    if (scene.texture) {
+        SDL_DestroyTexture(scene.texture);
+        scene.texture = nullptr;
+    }
+    scene.width = scene.height = 0;
+}
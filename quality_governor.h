@@ -0,0 +1,92 @@
+#pragma once
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+#include <SDL.h>
+#include <fstream>
+#include <vector>
+
+#include "postfx.h" // PostFxLevel (the enum only; no need to link postfx.cpp)
+
+// Keeps a game at its target frame rate by trading visual quality for time.
+//
+// Every frame the game reports two times: how long it worked on the frame
+// (update, drawing, effects; up to presenting) and the interval since the
+// previous frame. Once per evaluation window the governor takes percentiles
+// of both over the last couple of seconds:
+//
+//   - step down a quality level when the 95th percentile of the work reaches
+//     most of the budget, or frames are being missed (interval 95th
+//     percentile well over the budget);
+//   - step up only after several windows in a row with the 99th percentile
+//     of the work under half the budget and no missed frames. The number of
+//     windows doubles whenever a step up has to be taken back, so a level
+//     that could not be held is not retried straight away.
+//
+// Each level sets the knobs below, the cheapest visual losses first. Every
+// level change is printed with the percentiles that caused it; with a
+// telemetry file, every evaluation (including the ones that hold the level)
+// is written there as a CSV row.
+
+struct QualityKnobs {
+    PostFxLevel postFxCap;     // Highest post-processing level (setPostFxLevelCap)
+    float renderScale;         // Internal render resolution relative to the output (see SceneTarget)
+    Uint32 offFocusAnimationMs; // Animation step of sprites the viewer is not looking at; 0 = every frame
+    Uint32 textRedrawMs;       // Minimum time between redraws of cached text (setCachedLayerRedrawInterval)
+};
+
+struct QualityGovernor {
+    const char* name = "Quality";
+    float budgetMs = 1000.0f / 60.0f;
+    int level = 0;         // Index into the level table; 0 is the lowest quality
+    int maxLevel = 0;
+    std::vector<float> workMs, intervalMs; // Rings of the most recent frames
+    int sampleCount = 0;
+    int nextSample = 0;
+    int framesSinceEvaluation = 0;
+    int calmWindows = 0;
+    int upgradeWindows = 0;
+    bool lastStepUp = false; // The most recent change raised the level
+    Uint32 evaluations = 0;
+    Uint64 startCounter = 0;
+    std::ofstream telemetry; // Open when openQualityTelemetry succeeded
+};
+
+// Starts at the highest level, aiming for targetFps. name prefixes the
+// printed decisions (e.g. the program's name).
+void initQualityGovernor(QualityGovernor& governor, const char* name, float targetFps);
+
+// Also writes every evaluation to path as CSV. Returns false (and prints why)
+// if the file cannot be created.
+bool openQualityTelemetry(QualityGovernor& governor, const char* path);
+
+void closeQualityGovernor(QualityGovernor& governor);
+
+// Reports one frame. Returns true when the level (and so the knobs) changed.
+bool recordFrameTime(QualityGovernor& governor, float workMs, float intervalMs);
+
+const QualityKnobs& getQualityKnobs(const QualityGovernor& governor);
+
+// Rendering at QualityKnobs::renderScale: the frame is drawn into a smaller
+// texture with the renderer scaled to match, so callers keep drawing in output
+// coordinates, and then stretched over the output.
+//
+//     bool scaled = beginSceneRender(scene, renderer, knobs.renderScale);
+//     ...draw the frame...
+//     if (scaled) endSceneRender(scene, renderer);
+struct SceneTarget {
+    SDL_Texture* texture = nullptr;
+    int width = 0;
+    int height = 0;
+};
+
+// Returns false, leaving rendering on the output, at full scale or when the
+// renderer cannot draw into textures.
+bool beginSceneRender(SceneTarget& scene, SDL_Renderer* renderer, float scale);
+
+// Back to the output, with the scene stretched (linearly filtered) over it
+void endSceneRender(SceneTarget& scene, SDL_Renderer* renderer);
+
+void freeSceneTarget(SceneTarget& scene);
+
+#endif
@@ -0,0 +1,195 @@
+#include "render_queue.h"
+#include <iostream> // For error output
+#include <utility>  // For std::swap
+
+namespace {
+
+const int KEY_LAYER_SHIFT = 56;
+const int KEY_BLEND_SHIFT = 48;
+const int KEY_TEXTURE_SHIFT = 32;
+const Uint32 KEY_STATE_MASK = 0xFFFFFF; // Blend and texture fields, once shifted down by KEY_TEXTURE_SHIFT
+const size_t MAX_TEXTURES = 0xFFFF;     // Texture field is 16 bits, and 0 means untextured
+
+// Blend modes in a queue are few, but custom ones are large values, so the key
+// holds a small id; it is the mode itself for the built-in ones
+Uint8 getBlendId(SDL_BlendMode blend) {
+    switch (blend) {
+    case SDL_BLENDMODE_NONE: return 0;
+    case SDL_BLENDMODE_BLEND: return 1;
+    case SDL_BLENDMODE_ADD: return 2;
+    case SDL_BLENDMODE_MOD: return 3;
+    default: return 4; // Custom modes only come from textures, which carry their own
+    }
+}
+
+SDL_BlendMode getBlendMode(Uint8 id) {
+    static const SDL_BlendMode MODES[] = { SDL_BLENDMODE_NONE, SDL_BLENDMODE_BLEND, SDL_BLENDMODE_ADD, SDL_BLENDMODE_MOD };
+    return id < 4 ? MODES[id] : SDL_BLENDMODE_BLEND;
+}
+
+// Index + 1 of texture in the queue's table, adding it on first use; 0 if the table is full
+Uint16 getTextureId(RenderQueue& queue, SDL_Texture* texture) {
+    for (size_t i = 0; i < queue.textures.size(); ++i) {
+        if (queue.textures[i].texture == texture) {
+            return static_cast<Uint16>(i + 1);
+        }
+    }
+    if (queue.textures.size() >= MAX_TEXTURES) {
+        return 0;
+    }
+    RenderQueue::Texture entry = { texture, SDL_BLENDMODE_NONE, 1.0f, 1.0f };
+    int width = 1, height = 1;
+    SDL_QueryTexture(texture, nullptr, nullptr, &width, &height);
+    SDL_GetTextureBlendMode(texture, &entry.blend);
+    entry.inverseWidth = 1.0f / width;
+    entry.inverseHeight = 1.0f / height;
+    queue.textures.push_back(entry);
+    return static_cast<Uint16>(queue.textures.size());
+}
+
+Uint64 makeKey(Uint8 layer, Uint8 blendId, Uint16 textureId, Uint32 depth) {
+    return (static_cast<Uint64>(layer) << KEY_LAYER_SHIFT) | (static_cast<Uint64>(blendId) << KEY_BLEND_SHIFT) |
+           (static_cast<Uint64>(textureId) << KEY_TEXTURE_SHIFT) | depth;
+}
+
+void pushCommand(RenderQueue& queue, Uint64 key, const SDL_FRect& dst, const SDL_FRect& uv, SDL_Color color) {
+    SDL_FRect transformed = { dst.x * queue.scale + queue.offsetX, dst.y * queue.scale + queue.offsetY, dst.w * queue.scale, dst.h * queue.scale };
+    queue.commands.push_back({ key, transformed, uv, color });
+}
+
+// Stable LSD radix sort of queue.order by queue.sortKeys, a byte at a time.
+// Bytes that are the same in every key are skipped; with a handful of layers
+// and textures and no depth, that leaves two or three passes.
+void radixSort(RenderQueue& queue) {
+    size_t count = queue.sortKeys.size();
+    queue.sortKeysSwap.resize(count);
+    queue.orderSwap.resize(count);
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t buckets[256] = {};
+        for (Uint64 key : queue.sortKeys) {
+            buckets[(key >> shift) & 0xFF]++;
+        }
+        if (buckets[(queue.sortKeys[0] >> shift) & 0xFF] == count) {
+            continue; // Every key has the same byte here
+        }
+        size_t offset = 0;
+        for (size_t& bucket : buckets) {
+            size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            size_t to = buckets[(queue.sortKeys[i] >> shift) & 0xFF]++;
+            queue.sortKeysSwap[to] = queue.sortKeys[i];
+            queue.orderSwap[to] = queue.order[i];
+        }
+        std::swap(queue.sortKeys, queue.sortKeysSwap);
+        std::swap(queue.order, queue.orderSwap);
+    }
+}
+
+void appendQuad(RenderQueue& queue, const RenderQueue::Command& command) {
+    int first = static_cast<int>(queue.vertices.size());
+    float left = command.dst.x, top = command.dst.y;
+    float right = left + command.dst.w, bottom = top + command.dst.h;
+    float u0 = command.uv.x, v0 = command.uv.y;
+    float u1 = u0 + command.uv.w, v1 = v0 + command.uv.h;
+    queue.vertices.push_back({ { left, top }, command.color, { u0, v0 } });
+    queue.vertices.push_back({ { right, top }, command.color, { u1, v0 } });
+    queue.vertices.push_back({ { right, bottom }, command.color, { u1, v1 } });
+    queue.vertices.push_back({ { left, bottom }, command.color, { u0, v1 } });
+    const int QUAD[6] = { 0, 1, 2, 0, 2, 3 };
+    for (int corner : QUAD) {
+        queue.indices.push_back(first + corner);
+    }
+}
+
+// Draws the quads gathered for one blend mode and texture with a single call
+void submitRun(RenderQueue& queue, SDL_Renderer* renderer, Uint32 state, SDL_BlendMode& drawBlend) {
+    Uint16 textureId = state & 0xFFFF;
+    SDL_Texture* texture = textureId ? queue.textures[textureId - 1].texture : nullptr;
+    if (texture == nullptr) {
+        // Untextured geometry blends with the renderer's draw blend mode
+        SDL_BlendMode blend = getBlendMode(static_cast<Uint8>(state >> 16));
+        if (blend != drawBlend) {
+            SDL_SetRenderDrawBlendMode(renderer, blend);
+            drawBlend = blend;
+        }
+    }
+    if (SDL_RenderGeometry(renderer, texture, queue.vertices.data(), static_cast<int>(queue.vertices.size()), queue.indices.data(),
+                           static_cast<int>(queue.indices.size())) != 0) {
+        std::cerr << "Failed to draw queued geometry! SDL_Error: " << SDL_GetError() << std::endl;
+    }
+    queue.stats.drawCalls++;
+    queue.vertices.clear();
+    queue.indices.clear();
+}
+
+} // namespace
+
+void setRenderQueueTransform(RenderQueue& queue, float offsetX, float offsetY, float scale) {
+    queue.offsetX = offsetX;
+    queue.offsetY = offsetY;
+    queue.scale = scale;
+}
+
+void queueFillRect(RenderQueue& queue, Uint8 layer, const SDL_FRect& rect, SDL_Color color, SDL_BlendMode blend, Uint32 depth) {
+    pushCommand(queue, makeKey(layer, getBlendId(blend), 0, depth), rect, { 0.0f, 0.0f, 0.0f, 0.0f }, color);
+}
+
+void queueTexture(RenderQueue& queue, Uint8 layer, SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect& dst,
+                  SDL_Color color, Uint32 depth) {
+    if (texture == nullptr) {
+        return;
+    }
+    Uint16 textureId = getTextureId(queue, texture);
+    if (textureId == 0) {
+        return;
+    }
+    const RenderQueue::Texture& entry = queue.textures[textureId - 1];
+    SDL_FRect uv = { 0.0f, 0.0f, 1.0f, 1.0f };
+    if (src) {
+        uv = { src->x * entry.inverseWidth, src->y * entry.inverseHeight, src->w * entry.inverseWidth, src->h * entry.inverseHeight };
+    }
+    pushCommand(queue, makeKey(layer, getBlendId(entry.blend), textureId, depth), dst, uv, color);
+}
+
+void flushRenderQueue(RenderQueue& queue, SDL_Renderer* renderer) {
+    size_t count = queue.commands.size();
+    queue.stats = {};
+    queue.stats.commands = static_cast<int>(count);
+    if (count > 0) {
+        queue.sortKeys.resize(count);
+        queue.order.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            queue.sortKeys[i] = queue.commands[i].key;
+            queue.order[i] = static_cast<Uint32>(i);
+        }
+        radixSort(queue);
+
+        SDL_BlendMode savedBlend = SDL_BLENDMODE_NONE;
+        SDL_GetRenderDrawBlendMode(renderer, &savedBlend);
+        SDL_BlendMode drawBlend = savedBlend;
+
+        // Layers only matter where the state changes; a texture spanning two
+        // layers with nothing in between is still one run
+        Uint32 runState = static_cast<Uint32>(queue.sortKeys[0] >> KEY_TEXTURE_SHIFT) & KEY_STATE_MASK;
+        for (size_t i = 0; i < count; ++i) {
+            Uint32 state = static_cast<Uint32>(queue.sortKeys[i] >> KEY_TEXTURE_SHIFT) & KEY_STATE_MASK;
+            if (state != runState) {
+                submitRun(queue, renderer, runState, drawBlend);
+                queue.stats.stateChanges++;
+                runState = state;
+            }
+            appendQuad(queue, queue.commands[queue.order[i]]);
+        }
+        submitRun(queue, renderer, runState, drawBlend);
+
+        if (drawBlend != savedBlend) {
+            SDL_SetRenderDrawBlendMode(renderer, savedBlend);
+        }
+    }
+    queue.commands.clear();
+    queue.textures.clear(); // Ids are per frame; textures may be destroyed before the next one
+    setRenderQueueTransform(queue, 0.0f, 0.0f, 1.0f);
+}
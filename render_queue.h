@@ -0,0 +1,75 @@
+#pragma once
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <SDL.h>
+#include <vector>
+
+// Sort-keyed render queue.
+//
+// Draws are queued with a 64-bit sort key instead of going straight to the
+// renderer. flushRenderQueue radix-sorts the keys, then walks runs of draws
+// that share blend mode and texture and submits each run as one
+// SDL_RenderGeometry call, with colors carried per vertex. Switching color
+// between rectangles, or alternating between textured and untextured draws,
+// no longer costs a state change or a separate draw call.
+//
+// Key layout, most significant first:
+//
+//   layer (8 bits)  blend mode (8)  texture (16)  depth (32)
+//
+// Layers are painted in order. Within a layer the queue is free to reorder
+// draws by blend mode and texture, so draws in one layer must not depend on
+// overlapping each other in submission order; depth breaks ties, and the
+// sort is stable so equal keys keep submission order.
+//
+// An optional transform (offset, then uniform scale) is applied as draws are
+// queued, so several views (a wall of matches) share one flush.
+
+struct RenderQueueStats {
+    int commands = 0;     // Draws queued
+    int drawCalls = 0;    // SDL_RenderGeometry calls after merging
+    int stateChanges = 0; // Blend mode or texture switches between calls
+};
+
+struct RenderQueue {
+    struct Command {
+        Uint64 key;
+        SDL_FRect dst;
+        SDL_FRect uv;       // Normalized texture coordinates; unused without a texture
+        SDL_Color color;
+    };
+    struct Texture {
+        SDL_Texture* texture;
+        SDL_BlendMode blend;
+        float inverseWidth, inverseHeight;
+    };
+
+    std::vector<Command> commands;
+    std::vector<Texture> textures; // Index + 1 is the texture field of the key; 0 is untextured
+    float offsetX = 0.0f, offsetY = 0.0f, scale = 1.0f;
+    RenderQueueStats stats;        // Of the last flush
+
+    // Scratch space reused every flush
+    std::vector<Uint64> sortKeys, sortKeysSwap;
+    std::vector<Uint32> order, orderSwap;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+// Draws queued from now on are moved by (offsetX, offsetY) after being scaled by scale
+void setRenderQueueTransform(RenderQueue& queue, float offsetX, float offsetY, float scale);
+
+// Solid rectangle; blend applies to its color's alpha
+void queueFillRect(RenderQueue& queue, Uint8 layer, const SDL_FRect& rect, SDL_Color color,
+                   SDL_BlendMode blend = SDL_BLENDMODE_NONE, Uint32 depth = 0);
+
+// Like SDL_RenderCopyF: src in texture pixels (nullptr for the whole texture).
+// The texture's own blend mode is used; color multiplies the texels.
+void queueTexture(RenderQueue& queue, Uint8 layer, SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect& dst,
+                  SDL_Color color = { 255, 255, 255, 255 }, Uint32 depth = 0);
+
+// Sorts and submits everything queued, then empties the queue (the transform is reset)
+void flushRenderQueue(RenderQueue& queue, SDL_Renderer* renderer);
+
+#endif
@@ -0,0 +1,377 @@
+#include "renderer_select.h"
+#include <algorithm> // For std::stable_sort, std::find_if
+#include <cmath>
+#include <cstdlib>   // For getenv
+#include <cstring>   // For strcmp, strncmp
+#include <fstream>
+#include <iostream>  // For error output and the probe report
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define GL_GET_STRING_CALL __stdcall // APIENTRY of the GL headers
+#else
+#include <unistd.h> // For gethostname
+#define GL_GET_STRING_CALL
+#endif
+
+namespace {
+
+const char* CHOICE_FILE = "renderer_choice.txt";
+const int PROBE_WARMUP_FRAMES = 3;    // Shader compilation and texture upload happen here, untimed
+const int PROBE_FRAMES = 30;
+const double PROBE_TIME_LIMIT_MS = 400.0; // Per driver; a driver this slow has lost anyway
+const int PROBE_FILLS = 60;
+const int PROBE_BLITS = 120;
+const int PROBE_QUADS = 120;          // In one SDL_RenderGeometry call
+const int PROBE_SPRITE_SIZE = 32;
+
+const unsigned int GL_VENDOR_NAME = 0x1F00;   // GL_VENDOR
+const unsigned int GL_RENDERER_NAME = 0x1F01; // GL_RENDERER
+const unsigned int GL_VERSION_NAME = 0x1F02;  // GL_VERSION
+typedef const unsigned char* (GL_GET_STRING_CALL *GlGetStringFunction)(unsigned int name);
+
+struct DriverCandidate {
+    int index;
+    std::string name;
+    bool software;
+    double msPerFrame; // Negative if the driver could not be probed
+};
+
+// Small xorshift so every driver draws the same frames
+Uint32 nextProbeRandom(Uint32& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// A soft-edged disc, so blits exercise alpha blending like the coins do
+SDL_Texture* createProbeSprite(SDL_Renderer* renderer) {
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, PROBE_SPRITE_SIZE, PROBE_SPRITE_SIZE, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (surface == nullptr) {
+        return nullptr;
+    }
+    float radius = PROBE_SPRITE_SIZE / 2.0f;
+    for (int y = 0; y < PROBE_SPRITE_SIZE; ++y) {
+        Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels) + y * surface->pitch);
+        for (int x = 0; x < PROBE_SPRITE_SIZE; ++x) {
+            float dx = x + 0.5f - radius, dy = y + 0.5f - radius;
+            float coverage = std::min(1.0f, std::max(0.0f, radius - std::sqrt(dx * dx + dy * dy)));
+            row[x] = (static_cast<Uint32>(coverage * 255.0f) << 24) | 0xFFD040;
+        }
+    }
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    if (texture) {
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    }
+    return texture;
+}
+
+void drawProbeFrame(SDL_Renderer* renderer, SDL_Texture* sprite, int width, int height, int frame, std::vector<SDL_Vertex>& vertices,
+                    std::vector<int>& indices) {
+    Uint32 random = 0x9E3779B9u + frame;
+    SDL_SetRenderDrawColor(renderer, 0x1A, 0x20, 0x2C, 0xFF);
+    SDL_RenderClear(renderer);
+
+    // Solid fills with a color change each, like paddles and panels
+    for (int i = 0; i < PROBE_FILLS; ++i) {
+        Uint32 color = nextProbeRandom(random);
+        SDL_SetRenderDrawColor(renderer, color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, 0xFF);
+        SDL_Rect rect = { static_cast<int>(nextProbeRandom(random) % width), static_cast<int>(nextProbeRandom(random) % height), 20, 100 };
+        SDL_RenderFillRect(renderer, &rect);
+    }
+
+    // Scaled, alpha-blended sprites, half shrunk and half enlarged
+    for (int i = 0; i < PROBE_BLITS; ++i) {
+        int size = i % 2 ? 26 : 52;
+        SDL_Rect dst = { static_cast<int>(nextProbeRandom(random) % width), static_cast<int>(nextProbeRandom(random) % height), size, size };
+        SDL_RenderCopy(renderer, sprite, nullptr, &dst);
+    }
+
+    // The same sprite as one batch of quads, like the render queue submits
+    vertices.clear();
+    indices.clear();
+    const SDL_Color WHITE = { 255, 255, 255, 255 };
+    for (int i = 0; i < PROBE_QUADS; ++i) {
+        float x = static_cast<float>(nextProbeRandom(random) % width);
+        float y = static_cast<float>(nextProbeRandom(random) % height);
+        int first = static_cast<int>(vertices.size());
+        vertices.push_back({ { x, y }, WHITE, { 0.0f, 0.0f } });
+        vertices.push_back({ { x + 30.0f, y }, WHITE, { 1.0f, 0.0f } });
+        vertices.push_back({ { x + 30.0f, y + 30.0f }, WHITE, { 1.0f, 1.0f } });
+        vertices.push_back({ { x, y + 30.0f }, WHITE, { 0.0f, 1.0f } });
+        const int QUAD[6] = { 0, 1, 2, 0, 2, 3 };
+        for (int corner : QUAD) {
+            indices.push_back(first + corner);
+        }
+    }
+    SDL_RenderGeometry(renderer, sprite, vertices.data(), static_cast<int>(vertices.size()), indices.data(), static_cast<int>(indices.size()));
+}
+
+// Milliseconds per frame of the probe workload, or a negative value if it cannot run
+double runProbeWorkload(SDL_Renderer* renderer, int width, int height) {
+    SDL_Texture* sprite = createProbeSprite(renderer);
+    if (sprite == nullptr) {
+        return -1.0;
+    }
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+    double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+    Uint64 start = 0;
+    int timedFrames = 0;
+    double elapsedMs = 0.0;
+    bool ok = true;
+    for (int frame = 0; frame < PROBE_WARMUP_FRAMES + PROBE_FRAMES && ok; ++frame) {
+        if (frame == PROBE_WARMUP_FRAMES) {
+            start = SDL_GetPerformanceCounter();
+        }
+        drawProbeFrame(renderer, sprite, width, height, frame, vertices, indices);
+        // Reading a pixel back waits for the frame to finish, so queued GPU work is timed too
+        Uint32 pixel;
+        SDL_Rect corner = { 0, 0, 1, 1 };
+        ok = SDL_RenderReadPixels(renderer, &corner, SDL_PIXELFORMAT_ARGB8888, &pixel, sizeof(pixel)) == 0;
+        if (frame >= PROBE_WARMUP_FRAMES) {
+            timedFrames++;
+            elapsedMs = (SDL_GetPerformanceCounter() - start) * 1000.0 / frequency;
+            if (elapsedMs > PROBE_TIME_LIMIT_MS) {
+                break;
+            }
+        }
+    }
+    SDL_DestroyTexture(sprite);
+    return ok && timedFrames > 0 ? elapsedMs / timedFrames : -1.0;
+}
+
+// Times one driver without presenting: accelerated drivers draw into the
+// window's back buffer, the software driver into a surface of the same size
+double probeDriver(SDL_Window* window, const DriverCandidate& candidate) {
+    int width, height;
+    SDL_GetWindowSize(window, &width, &height);
+    SDL_Surface* surface = nullptr;
+    SDL_Renderer* renderer;
+    if (candidate.software) {
+        surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+        renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    }
+    else {
+        renderer = SDL_CreateRenderer(window, candidate.index, 0);
+    }
+    double msPerFrame = renderer ? runProbeWorkload(renderer, width, height) : -1.0;
+    if (renderer) {
+        SDL_DestroyRenderer(renderer);
+    }
+    if (surface) {
+        SDL_FreeSurface(surface);
+    }
+    return msPerFrame;
+}
+
+// Host name, core count and memory: enough to tell machines sharing a
+// preference directory (a roaming profile, a copied home) apart
+std::string getMachineId() {
+    std::string host;
+#ifdef _WIN32
+    const char* computerName = getenv("COMPUTERNAME");
+    host = computerName ? computerName : "";
+#else
+    char hostName[256] = {};
+    if (gethostname(hostName, sizeof(hostName) - 1) == 0) {
+        host = hostName;
+    }
+#endif
+    for (char& c : host) {
+        if (c == ' ') {
+            c = '_'; // The fingerprint's fields are separated by spaces
+        }
+    }
+    return (host.empty() ? "unknown" : host) + "-" + std::to_string(SDL_GetCPUCount()) + "cpu-" + std::to_string(SDL_GetSystemRAM()) + "mb";
+}
+
+// Identifies this machine's rendering setup; a cached choice only applies to the same one
+std::string getRendererFingerprint(const std::vector<DriverCandidate>& candidates) {
+    SDL_version version;
+    SDL_GetVersion(&version);
+    const char* videoDriver = SDL_GetCurrentVideoDriver();
+    std::string fingerprint = "machine-" + getMachineId() + " sdl-" + std::to_string(version.major) + "." + std::to_string(version.minor) +
+                              "." + std::to_string(version.patch) + " video-" + (videoDriver ? videoDriver : "none") + " drivers";
+    for (const DriverCandidate& candidate : candidates) {
+        fingerprint += "-" + candidate.name;
+    }
+    return fingerprint;
+}
+
+// The device behind a created renderer: its capabilities and, for OpenGL
+// drivers, the GL vendor, renderer and version (a new GPU or GL driver keeps
+// the same SDL driver name). Saved with the choice and compared on later runs.
+// info.flags is left out: it depends on how the renderer was created (the
+// game's window-surface software renderer and SDL_CreateRenderer's differ), and
+// programs creating it either way share the one choice file.
+std::string describeRendererDevice(SDL_Renderer* renderer) {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) != 0) {
+        return "unknown";
+    }
+    std::string device = std::string(info.name) + " max-" + std::to_string(info.max_texture_width) +
+                         "x" + std::to_string(info.max_texture_height) + " formats";
+    for (Uint32 i = 0; i < info.num_texture_formats; ++i) {
+        device += "-" + std::to_string(info.texture_formats[i]);
+    }
+    // SDL's GL renderers leave their context current after creation
+    if (strncmp(info.name, "opengl", 6) == 0) {
+        GlGetStringFunction getString = reinterpret_cast<GlGetStringFunction>(SDL_GL_GetProcAddress("glGetString"));
+        const unsigned int names[] = { GL_VENDOR_NAME, GL_RENDERER_NAME, GL_VERSION_NAME };
+        for (unsigned int name : names) {
+            const unsigned char* value = getString ? getString(name) : nullptr;
+            device += std::string(" | ") + (value ? reinterpret_cast<const char*>(value) : "?");
+        }
+    }
+    return device;
+}
+
+std::string getChoicePath() {
+    char* prefPath = SDL_GetPrefPath("Hi", "renderer");
+    if (prefPath == nullptr) {
+        return std::string();
+    }
+    std::string path = std::string(prefPath) + CHOICE_FILE;
+    SDL_free(prefPath);
+    return path;
+}
+
+// The cached driver name, or an empty string if there is none for this
+// fingerprint. device is set to the describeRendererDevice it was measured on.
+std::string loadRendererChoice(const std::string& path, const std::string& fingerprint, std::string& device) {
+    std::ifstream in(path);
+    std::string line, cachedFingerprint, driver;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string key, value;
+        fields >> key >> std::ws;
+        std::getline(fields, value); // The rest of the line; the fingerprint has spaces
+        if (key == "fingerprint") {
+            cachedFingerprint = value;
+        }
+        else if (key == "driver") {
+            driver = value;
+        }
+        else if (key == "device") {
+            device = value;
+        }
+    }
+    return cachedFingerprint == fingerprint ? driver : std::string();
+}
+
+void saveRendererChoice(const std::string& path, const std::string& fingerprint, const DriverCandidate& chosen, const std::string& device,
+                        const std::vector<DriverCandidate>& ranking) {
+    std::ofstream out(path);
+    out << "fingerprint " << fingerprint << "\n";
+    out << "driver " << chosen.name << "\n";
+    out << "device " << device << "\n";
+    for (const DriverCandidate& candidate : ranking) {
+        out << "ms_per_frame " << candidate.name << " " << candidate.msPerFrame << "\n"; // For reference only
+    }
+    if (!out) {
+        std::cerr << "Failed to save the renderer choice to " << path << "." << std::endl;
+    }
+}
+
+SDL_Renderer* createCandidate(SDL_Window* window, const DriverCandidate& candidate, Uint32 flags, SDL_Surface** softwareTarget) {
+    if (candidate.software && softwareTarget) {
+        // Drawing straight into the window surface lets callers blit sprites into it
+        SDL_Surface* surface = SDL_GetWindowSurface(window);
+        SDL_Renderer* renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+        if (renderer) {
+            *softwareTarget = surface;
+        }
+        return renderer;
+    }
+    return SDL_CreateRenderer(window, candidate.index, flags);
+}
+
+} // namespace
+
+SDL_Renderer* createFastestRenderer(SDL_Window* window, Uint32 flags, SDL_Surface** softwareTarget, bool reprobe) {
+    if (softwareTarget) {
+        *softwareTarget = nullptr;
+    }
+    const char* forced = SDL_GetHint(SDL_HINT_RENDER_DRIVER);
+    if (forced && *forced) {
+        SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, flags);
+        if (renderer == nullptr) {
+            std::cerr << "Renderer '" << forced << "' could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+        }
+        return renderer;
+    }
+
+    std::vector<DriverCandidate> candidates;
+    for (int i = 0; i < SDL_GetNumRenderDrivers(); ++i) {
+        SDL_RendererInfo info;
+        if (SDL_GetRenderDriverInfo(i, &info) == 0) {
+            candidates.push_back({ i, info.name, strcmp(info.name, "software") == 0, -1.0 });
+        }
+    }
+    if (candidates.empty()) {
+        std::cerr << "No render drivers available!" << std::endl;
+        return nullptr;
+    }
+
+    std::string fingerprint = getRendererFingerprint(candidates);
+    std::string path = getChoicePath();
+    std::string cachedDevice;
+    std::string cached = reprobe || path.empty() ? std::string() : loadRendererChoice(path, fingerprint, cachedDevice);
+    auto cachedCandidate = std::find_if(candidates.begin(), candidates.end(), [&cached](const DriverCandidate& candidate) {
+        return candidate.name == cached;
+    });
+    if (cachedCandidate != candidates.end()) {
+        // The remembered driver is created anyway, so checking its device costs nothing
+        SDL_Renderer* renderer = createCandidate(window, *cachedCandidate, flags, softwareTarget);
+        if (renderer && describeRendererDevice(renderer) == cachedDevice) {
+            std::cout << "Using the " << cachedCandidate->name << " renderer." << std::endl;
+            return renderer;
+        }
+        if (renderer) {
+            std::cout << "The " << cachedCandidate->name << " renderer is not on the device it was measured on." << std::endl;
+            SDL_DestroyRenderer(renderer);
+            if (softwareTarget) {
+                *softwareTarget = nullptr;
+            }
+        }
+        else {
+            std::cerr << "Renderer " << cachedCandidate->name << " could not be created (" << SDL_GetError() << ")." << std::endl;
+        }
+    }
+
+    std::cout << "Measuring render drivers..." << std::endl;
+    for (DriverCandidate& candidate : candidates) {
+        candidate.msPerFrame = probeDriver(window, candidate);
+        if (candidate.msPerFrame < 0.0) {
+            std::cout << "  " << candidate.name << ": unavailable" << std::endl;
+        }
+        else {
+            std::cout << "  " << candidate.name << ": " << candidate.msPerFrame << " ms per frame" << std::endl;
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const DriverCandidate& a, const DriverCandidate& b) {
+        if ((a.msPerFrame < 0.0) != (b.msPerFrame < 0.0)) {
+            return b.msPerFrame < 0.0; // Drivers that failed the probe go last
+        }
+        return a.msPerFrame < b.msPerFrame;
+    });
+
+    for (const DriverCandidate& candidate : candidates) {
+        SDL_Renderer* renderer = createCandidate(window, candidate, flags, softwareTarget);
+        if (renderer) {
+            std::cout << "Using the " << candidate.name << " renderer." << std::endl;
+            if (candidate.msPerFrame >= 0.0 && !path.empty()) {
+                saveRendererChoice(path, fingerprint, candidate, describeRendererDevice(renderer), candidates);
+            }
+            return renderer;
+        }
+        std::cerr << "Renderer " << candidate.name << " could not be created (" << SDL_GetError() << "); trying the next." << std::endl;
+    }
+    std::cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+    return nullptr;
+}
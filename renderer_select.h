@@ -0,0 +1,32 @@
+#pragma once
+#ifndef RENDERER_SELECT_H
+#define RENDERER_SELECT_H
+
+#include <SDL.h>
+
+// Picks the render driver by measurement instead of SDL_RENDERER_ACCELERATED.
+//
+// On machines without a GPU "accelerated" may mean OpenGL on llvmpipe, which
+// can be faster or several times slower than SDL's software renderer
+// depending on the CPU. The first run times a short workload like a game
+// frame (solid fills, scaled alpha-blended sprites and a batched geometry
+// call) on every available driver, reading a pixel back after each frame so
+// queued GPU work is counted. The fastest driver is remembered in the user's
+// preference directory, keyed by the machine (host name, cores, memory), the
+// SDL and video driver versions and the list of render drivers, so later runs
+// start immediately. The device the choice was measured on (the renderer's
+// capabilities, and GL vendor, renderer and version for OpenGL drivers) is
+// saved too; when the remembered driver comes up on a different one, such as
+// after a GPU or driver change, the drivers are measured again.
+//
+// Setting SDL_RENDER_DRIVER (the SDL_HINT_RENDER_DRIVER hint) skips the probe.
+
+// Creates a renderer for window on the fastest driver, adding flags (e.g.
+// SDL_RENDERER_PRESENTVSYNC). If softwareTarget is not nullptr and software
+// rendering wins, the renderer draws into the window surface and
+// *softwareTarget is set to it (for direct blits); otherwise it is set to
+// nullptr. reprobe ignores the cached choice. Falls back to the next fastest
+// driver if one cannot be created; returns nullptr (and prints why) if none can.
+SDL_Renderer* createFastestRenderer(SDL_Window* window, Uint32 flags, SDL_Surface** softwareTarget, bool reprobe = false);
+
+#endif
@@ -0,0 +1,96 @@
+#include "replay.h"
+#include "mapped_file.h"
+#include <cstring>  // For memcpy
+#include <fstream>
+#include <iostream> // For error output
+
+namespace {
+
+uint16_t scalarBackendFlags() {
+#ifdef PONG_FIXED_POINT
+    return REPLAY_FIXED_POINT;
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+uint8_t packReplayTick(const MatchInput& input, bool launched) {
+    uint8_t tick = 0;
+    tick |= input.leftUp ? REPLAY_LEFT_UP : 0;
+    tick |= input.leftDown ? REPLAY_LEFT_DOWN : 0;
+    tick |= input.rightUp ? REPLAY_RIGHT_UP : 0;
+    tick |= input.rightDown ? REPLAY_RIGHT_DOWN : 0;
+    tick |= launched ? REPLAY_LAUNCH : 0;
+    return tick;
+}
+
+MatchInput unpackReplayTick(uint8_t tick) {
+    MatchInput input;
+    input.leftUp = (tick & REPLAY_LEFT_UP) != 0;
+    input.leftDown = (tick & REPLAY_LEFT_DOWN) != 0;
+    input.rightUp = (tick & REPLAY_RIGHT_UP) != 0;
+    input.rightDown = (tick & REPLAY_RIGHT_DOWN) != 0;
+    return input;
+}
+
+bool saveReplay(const Replay& replay, const char* path) {
+    ReplayHeader header = {};
+    header.magic = REPLAY_MAGIC;
+    header.version = REPLAY_VERSION;
+    header.flags = scalarBackendFlags();
+    header.seed = replay.seed;
+    header.tickCount = static_cast<uint32_t>(replay.ticks.size());
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(replay.ticks.data()), replay.ticks.size());
+    if (!out) {
+        std::cerr << "Failed to write replay " << path << "!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadReplay(const char* path, Replay& replay) {
+    MappedFile file;
+    if (!mapFile(path, file)) {
+        return false;
+    }
+
+    ReplayHeader header;
+    if (file.size < sizeof(header)) {
+        std::cerr << "Replay " << path << " is truncated!" << std::endl;
+        unmapFile(file);
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    if (header.magic != REPLAY_MAGIC || header.version != REPLAY_VERSION) {
+        std::cerr << "Replay " << path << " has the wrong format or version." << std::endl;
+        unmapFile(file);
+        return false;
+    }
+    if (file.size < sizeof(header) + header.tickCount) {
+        std::cerr << "Replay " << path << " is truncated!" << std::endl;
+        unmapFile(file);
+        return false;
+    }
+    if (header.flags != scalarBackendFlags()) {
+        // Still loads: the match plays out, just not the way it was recorded
+        std::cerr << "Warning: replay " << path << " was recorded with a different math backend and will diverge." << std::endl;
+    }
+
+    replay.seed = header.seed;
+    replay.ticks.assign(file.data + sizeof(header), file.data + sizeof(header) + header.tickCount);
+    unmapFile(file);
+    return true;
+}
+
+void playReplayTick(MatchContext& match, const Replay& replay, size_t tick) {
+    uint8_t recorded = replay.ticks[tick];
+    if (recorded & REPLAY_LAUNCH) {
+        launchBall(match);
+    }
+    updateMatch(match, unpackReplayTick(recorded));
+}
@@ -0,0 +1,59 @@
+#pragma once
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "game_context.h" // MatchInput, MatchContext
+
+// Recorded matches.
+//
+// The simulation is deterministic (see fixedmath.h and statehash.h), so a
+// match is fully described by its seed and the input of every tick. A replay
+// stores exactly that, one byte per tick, and is re-simulated to watch or
+// render it. Replays only play back bit-identically in a build with the same
+// Scalar backend as the one that recorded them; the header remembers which.
+//
+// File layout (little-endian): ReplayHeader, then tickCount bytes of
+// REPLAY_* input bits.
+
+const uint32_t REPLAY_MAGIC = 0x4C505250; // "PRPL"
+const uint16_t REPLAY_VERSION = 1;
+const uint16_t REPLAY_FIXED_POINT = 1 << 0; // Header flag: recorded with PONG_FIXED_POINT
+
+const int REPLAY_TICKS_PER_SECOND = 60; // The game advances one tick per (60 Hz) frame
+
+// Input bits of one tick
+const uint8_t REPLAY_LEFT_UP = 1 << 0;
+const uint8_t REPLAY_LEFT_DOWN = 1 << 1;
+const uint8_t REPLAY_RIGHT_UP = 1 << 2;
+const uint8_t REPLAY_RIGHT_DOWN = 1 << 3;
+const uint8_t REPLAY_LAUNCH = 1 << 4; // The stationary ball was launched before this tick
+
+struct ReplayHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint32_t seed;
+    uint32_t tickCount;
+};
+
+static_assert(sizeof(ReplayHeader) == 16, "ReplayHeader must match the file layout");
+
+struct Replay {
+    uint32_t seed = 0;
+    std::vector<uint8_t> ticks;
+};
+
+uint8_t packReplayTick(const MatchInput& input, bool launched);
+MatchInput unpackReplayTick(uint8_t tick);
+
+// Returns false (and prints why) on failure
+bool saveReplay(const Replay& replay, const char* path);
+bool loadReplay(const char* path, Replay& replay);
+
+// Advances a match started with startMatch(match, replay.seed) by recorded tick number tick
+void playReplayTick(MatchContext& match, const Replay& replay, size_t tick);
+
+#endif
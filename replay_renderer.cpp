@@ -0,0 +1,312 @@
+// Offline tool: re-simulates recorded matches (see replay.h, saved by the game
+// with --save-replay) and renders their frames on every core, without a
+// display or GPU, for highlight reels.
+//
+// Not part of the game project; build it as its own console program from the
+// game's sources minus main.cpp, against SDL2, SDL2_image, SDL2_mixer and
+// SDL2_ttf. Run it from the game directory so it finds the coin frames and
+// the score font atlas (arial_sdf.fatlas; the TrueType fallback is refused, as
+// its placeholder glyphs would make the output differ from run to run):
+//
+//   replay_renderer frames/ match1.pongreplay match2.pongreplay
+//   replay_renderer --y4m --every 2 --scale 0.5 videos/ match1.pongreplay
+//
+// Options:
+//   --y4m         write one .y4m video per replay instead of numbered .qoi images
+//   --every N     keep every Nth tick (a 30 FPS video with 2)
+//   --scale S     render at S times the window size
+//   --jobs N      worker threads (default: one per core)
+//
+// Each replay is cut into one-minute segments that workers take from a shared
+// counter, so a single long replay still uses every core. A worker catches up
+// to its segment by simulating without drawing, which costs next to nothing
+// next to rendering. Every worker has its own software renderer, surface and
+// engine (SDL textures belong to one renderer), all created up front on the
+// main thread.
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_ttf.h>
+#include "game_context.h"
+#include "qoi_image.h"
+#include "replay.h"
+#include "video_recorder.h" // convertArgbToYuv420
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t SEGMENT_TICKS = 60 * REPLAY_TICKS_PER_SECOND; // One minute of match per job
+const char FRAME_HEADER[] = "FRAME\n";
+
+struct RenderOptions {
+    bool y4m = false;
+    int every = 1;
+    float scale = 1.0f;
+    int width = WINDOW_WIDTH;
+    int height = WINDOW_HEIGHT;
+    std::filesystem::path outputDir;
+};
+
+struct ReplayJob {
+    std::string name;        // Output file stem
+    Replay replay;
+    std::filesystem::path video; // The .y4m file, when writing video
+};
+
+struct Segment {
+    size_t job;
+    size_t firstTick;
+    size_t endTick;
+};
+
+struct RenderWorker {
+    SDL_Surface* surface = nullptr;
+    SDL_Renderer* renderer = nullptr;
+    EngineContext engine;
+    std::vector<Uint8> pixels; // RGBA for QOI, or the YUV frame
+    size_t frames = 0;
+    bool failed = false;
+};
+
+size_t yuvFrameBytes(const RenderOptions& options) {
+    return static_cast<size_t>(options.width) * options.height * 3 / 2;
+}
+
+// Frames of the video before tick (only ticks divisible by --every are kept)
+size_t framesBefore(size_t tick, int every) {
+    return (tick + every - 1) / every;
+}
+
+std::string y4mHeader(const RenderOptions& options) {
+    return "YUV4MPEG2 W" + std::to_string(options.width) + " H" + std::to_string(options.height) + " F" +
+           std::to_string(REPLAY_TICKS_PER_SECOND) + ":" + std::to_string(options.every) + " Ip A1:1 C420jpeg\n";
+}
+
+bool createWorker(RenderWorker& worker, const RenderOptions& options) {
+    worker.surface = SDL_CreateRGBSurfaceWithFormat(0, options.width, options.height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (worker.surface == nullptr) {
+        std::cerr << "Failed to create a render surface! SDL_Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    worker.renderer = SDL_CreateSoftwareRenderer(worker.surface);
+    if (worker.renderer == nullptr) {
+        std::cerr << "Failed to create a software renderer! SDL_Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    SDL_RenderSetScale(worker.renderer, options.scale, options.scale);
+    // At full size coins are RLE-blitted straight into the surface
+    SDL_Surface* rleTarget = options.scale == 1.0f ? worker.surface : nullptr;
+    if (!initEngine(worker.engine, worker.renderer, rleTarget)) {
+        return false;
+    }
+    // The TrueType fallback rasterizes in the background and draws placeholder
+    // boxes until glyphs arrive, so frames would differ from run to run
+    if (worker.engine.fontAtlas == nullptr) {
+        std::cerr << "The replay renderer needs the score font atlas " << FONT_ATLAS_FILE
+                  << " (see font_atlas_builder) for reproducible frames." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void destroyWorker(RenderWorker& worker) {
+    closeEngine(worker.engine);
+    if (worker.renderer) {
+        SDL_DestroyRenderer(worker.renderer);
+    }
+    if (worker.surface) {
+        SDL_FreeSurface(worker.surface);
+    }
+}
+
+// Draws the match at tick into the worker's surface
+void renderFrame(RenderWorker& worker, const MatchContext& match, size_t tick) {
+    SDL_SetRenderDrawColor(worker.renderer, 0x1A, 0x20, 0x2C, 0xFF); // The game's background
+    SDL_RenderClear(worker.renderer);
+    Uint32 matchTimeMs = static_cast<Uint32>(tick * 1000 / REPLAY_TICKS_PER_SECOND); // Drives the coin animation
+    renderMatch(worker.engine, match, worker.renderer, matchTimeMs);
+    SDL_RenderFlush(worker.renderer);
+}
+
+bool writeImage(RenderWorker& worker, const RenderOptions& options, const ReplayJob& job, size_t tick) {
+    worker.pixels.resize(static_cast<size_t>(options.width) * options.height * 4);
+    SDL_ConvertPixels(options.width, options.height, SDL_PIXELFORMAT_ARGB8888, worker.surface->pixels, worker.surface->pitch,
+                      SDL_PIXELFORMAT_RGBA32, worker.pixels.data(), options.width * 4);
+    std::vector<Uint8> image = encodeQoi(worker.pixels.data(), options.width, options.height);
+    char number[16];
+    snprintf(number, sizeof(number), "_%06zu.qoi", tick);
+    std::filesystem::path path = options.outputDir / (job.name + number);
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(image.data()), image.size());
+    if (!out) {
+        std::cerr << "Failed to write " << path.string() << "!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void renderSegment(RenderWorker& worker, const RenderOptions& options, const ReplayJob& job, const Segment& segment) {
+    MatchContext match(&worker.engine);
+    startMatch(match, job.replay.seed);
+    for (size_t tick = 0; tick < segment.firstTick; ++tick) {
+        playReplayTick(match, job.replay, tick); // Catch up without drawing
+    }
+
+    // Frames have a fixed size, so each segment writes its own stretch of the video
+    std::fstream video;
+    size_t headerBytes = y4mHeader(options).size();
+    size_t frameBytes = sizeof(FRAME_HEADER) - 1 + yuvFrameBytes(options);
+    if (options.y4m) {
+        video.open(job.video, std::ios::in | std::ios::out | std::ios::binary);
+        video.seekp(headerBytes + framesBefore(segment.firstTick, options.every) * frameBytes);
+        worker.pixels.resize(yuvFrameBytes(options));
+    }
+
+    for (size_t tick = segment.firstTick; tick < segment.endTick && !worker.failed; ++tick) {
+        playReplayTick(match, job.replay, tick);
+        if (tick % options.every != 0) {
+            continue;
+        }
+        renderFrame(worker, match, tick);
+        if (options.y4m) {
+            // Rows are tightly packed: 32-bit surfaces have no row padding
+            convertArgbToYuv420(static_cast<const Uint32*>(worker.surface->pixels), options.width, options.height, worker.pixels.data());
+            video.write(FRAME_HEADER, sizeof(FRAME_HEADER) - 1);
+            video.write(reinterpret_cast<const char*>(worker.pixels.data()), worker.pixels.size());
+            if (!video) {
+                std::cerr << "Failed to write " << job.video.string() << "!" << std::endl;
+                worker.failed = true;
+            }
+        }
+        else if (!writeImage(worker, options, job, tick)) {
+            worker.failed = true;
+        }
+        worker.frames++;
+    }
+    closeMatch(match);
+}
+
+} // namespace
+
+int main(int argc, char* args[]) {
+    RenderOptions options;
+    int jobs = static_cast<int>(std::thread::hardware_concurrency());
+    int first = 1;
+    for (; first < argc && args[first][0] == '-'; ++first) {
+        std::string option = args[first];
+        if (option == "--y4m") {
+            options.y4m = true;
+        }
+        else if (option == "--every" && first + 1 < argc) {
+            options.every = std::max(1, atoi(args[++first]));
+        }
+        else if (option == "--scale" && first + 1 < argc) {
+            options.scale = static_cast<float>(atof(args[++first]));
+        }
+        else if (option == "--jobs" && first + 1 < argc) {
+            jobs = atoi(args[++first]);
+        }
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (argc - first < 2 || options.scale <= 0.0f) {
+        std::cerr << "Usage: replay_renderer [--y4m] [--every N] [--scale S] [--jobs N] <out_dir> <replay> [more replays...]" << std::endl;
+        return 1;
+    }
+    jobs = std::max(1, jobs);
+    // Even sizes, as 4:2:0 video needs
+    options.width = std::max(2, static_cast<int>(WINDOW_WIDTH * options.scale) & ~1);
+    options.height = std::max(2, static_cast<int>(WINDOW_HEIGHT * options.scale) & ~1);
+    options.outputDir = args[first];
+    std::error_code error;
+    std::filesystem::create_directories(options.outputDir, error);
+
+    // Load every replay and cut it into segments
+    std::vector<ReplayJob> replays;
+    std::vector<Segment> segments;
+    size_t totalFrames = 0, totalTicks = 0;
+    for (int i = first + 1; i < argc; ++i) {
+        ReplayJob job;
+        if (!loadReplay(args[i], job.replay)) {
+            return 1;
+        }
+        job.name = std::filesystem::path(args[i]).stem().string();
+        if (options.y4m) {
+            // Written up front; the segments fill in the frames
+            job.video = options.outputDir / (job.name + ".y4m");
+            std::ofstream video(job.video, std::ios::binary);
+            video << y4mHeader(options);
+            if (!video) {
+                std::cerr << "Failed to create " << job.video.string() << "!" << std::endl;
+                return 1;
+            }
+        }
+        size_t ticks = job.replay.ticks.size();
+        for (size_t start = 0; start < ticks; start += SEGMENT_TICKS) {
+            segments.push_back({ replays.size(), start, std::min(ticks, start + SEGMENT_TICKS) });
+        }
+        totalFrames += framesBefore(ticks, options.every);
+        totalTicks += ticks;
+        replays.push_back(std::move(job));
+    }
+    jobs = std::min(jobs, std::max(1, static_cast<int>(segments.size())));
+
+    if (SDL_Init(0) < 0) {
+        std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+    IMG_Init(IMG_INIT_PNG); // Coin frames fall back to PNG without the sprite sheet
+
+    std::vector<RenderWorker> workers(jobs);
+    bool ready = true;
+    for (RenderWorker& worker : workers) {
+        ready = ready && createWorker(worker, options);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (ready) {
+        std::cout << "Rendering " << replays.size() << " replays (" << totalFrames << " frames at " << options.width << "x"
+                  << options.height << ") on " << jobs << " threads..." << std::endl;
+        std::atomic<size_t> nextSegment(0);
+        std::vector<std::thread> threads;
+        for (RenderWorker& worker : workers) {
+            threads.emplace_back([&worker, &options, &replays, &segments, &nextSegment] {
+                for (size_t i = nextSegment++; i < segments.size() && !worker.failed; i = nextSegment++) {
+                    renderSegment(worker, options, replays[segments[i].job], segments[i]);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    size_t frames = 0;
+    bool failed = !ready;
+    for (RenderWorker& worker : workers) {
+        frames += worker.frames;
+        failed = failed || worker.failed;
+        destroyWorker(worker);
+    }
+    TTF_Quit(); // No-op unless an engine fell back to the TrueType font
+    IMG_Quit();
+    SDL_Quit();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double footage = static_cast<double>(totalTicks) / REPLAY_TICKS_PER_SECOND;
+    std::cout << "Rendered " << frames << " frames in " << seconds << " s (" << frames / std::max(seconds, 1e-6)
+              << " frames/s, " << footage / std::max(seconds, 1e-6) << "x real time)." << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,355 @@
+#include "replication.h"
+#include <cmath>   // For std::lround
+#include <cstring> // For memset
+
+// --- Bit Packing ---
+
+namespace {
+
+// Appends values LSB-first into a caller-provided buffer through a 64-bit scratch word
+class BitWriter {
+public:
+    BitWriter(uint8_t* buffer, int capacity)
+        : buffer(buffer), capacity(capacity), bytes(0), scratch(0), scratchBits(0), overflow(false) {}
+
+    void write(uint32_t value, int bits) {
+        scratch |= static_cast<uint64_t>(value & ((1ull << bits) - 1)) << scratchBits;
+        scratchBits += bits;
+        while (scratchBits >= 8) {
+            putByte(static_cast<uint8_t>(scratch));
+            scratch >>= 8;
+            scratchBits -= 8;
+        }
+    }
+
+    // Flushes the last partial byte and returns the total size (0 on overflow)
+    int finish() {
+        if (scratchBits > 0) {
+            putByte(static_cast<uint8_t>(scratch));
+            scratch = 0;
+            scratchBits = 0;
+        }
+        return overflow ? 0 : bytes;
+    }
+
+private:
+    void putByte(uint8_t byte) {
+        if (bytes < capacity) {
+            buffer[bytes++] = byte;
+        }
+        else {
+            overflow = true;
+        }
+    }
+
+    uint8_t* buffer;
+    int capacity;
+    int bytes;
+    uint64_t scratch;
+    int scratchBits;
+    bool overflow;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, int size)
+        : data(data), size(size), position(0), scratch(0), scratchBits(0), overflow(false) {}
+
+    uint32_t read(int bits) {
+        while (scratchBits < bits) {
+            if (position >= size) {
+                overflow = true;
+                return 0;
+            }
+            scratch |= static_cast<uint64_t>(data[position++]) << scratchBits;
+            scratchBits += 8;
+        }
+        uint32_t value = static_cast<uint32_t>(scratch & ((1ull << bits) - 1));
+        scratch >>= bits;
+        scratchBits -= bits;
+        return value;
+    }
+
+    bool failed() const { return overflow; }
+
+private:
+    const uint8_t* data;
+    int size;
+    int position;
+    uint64_t scratch;
+    int scratchBits;
+    bool overflow;
+};
+
+const int SMALL_DELTA_BITS = 6; // Zigzag deltas below 64 use the short form
+const int DIRECTION_OFFSET = 1 << (NET_DIRECTION_BITS - 1);
+const int DIRECTION_LIMIT = static_cast<int>(NET_DIRECTION_SCALE); // Quantized components of [-1, 1]
+
+// MAX_SNAPSHOT_BITS counts every field in its long form
+static_assert(SMALL_DELTA_BITS <= NET_DIRECTION_BITS && SMALL_DELTA_BITS <= NET_POSITION_BITS, "Short form must not be the longest");
+static_assert(MAX_NET_COINS < (1 << NET_COIN_COUNT_BITS), "Coin counts must fit their field");
+
+uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+// Unchanged: 1 bit. Small change: 2 + SMALL_DELTA_BITS bits. Otherwise: 2 + bits.
+void writeField(BitWriter& writer, uint32_t current, uint32_t base, int bits) {
+    if (current == base) {
+        writer.write(0, 1);
+        return;
+    }
+    writer.write(1, 1);
+    uint32_t delta = zigzag(static_cast<int32_t>(current - base));
+    if (delta < (1u << SMALL_DELTA_BITS)) {
+        writer.write(0, 1);
+        writer.write(delta, SMALL_DELTA_BITS);
+    }
+    else {
+        writer.write(1, 1);
+        writer.write(current, bits);
+    }
+}
+
+uint32_t readField(BitReader& reader, uint32_t base, int bits) {
+    if (reader.read(1) == 0) {
+        return base;
+    }
+    if (reader.read(1) == 0) {
+        return base + static_cast<uint32_t>(unzigzag(reader.read(SMALL_DELTA_BITS)));
+    }
+    return reader.read(bits);
+}
+
+constexpr uint32_t directionToWire(int16_t value) {
+    return static_cast<uint32_t>(value + DIRECTION_OFFSET);
+}
+
+constexpr int16_t directionFromWire(uint32_t value) {
+    return static_cast<int16_t>(static_cast<int32_t>(value) - DIRECTION_OFFSET);
+}
+
+// Keeps out-of-range input encodable; only +-DIRECTION_LIMIT are documented
+constexpr int16_t clampDirection(long q) {
+    return static_cast<int16_t>(q < -DIRECTION_LIMIT ? -DIRECTION_LIMIT : (q > DIRECTION_LIMIT ? DIRECTION_LIMIT : q));
+}
+
+// Both limits, and anything past them, survive the trip through the wire field
+static_assert(directionToWire(clampDirection(1L << 20)) < (1u << NET_DIRECTION_BITS), "Direction limit must fit its field");
+static_assert(directionFromWire(directionToWire(clampDirection(1L << 20))) == DIRECTION_LIMIT, "Direction must round-trip at +limit");
+static_assert(directionFromWire(directionToWire(clampDirection(-(1L << 20)))) == -DIRECTION_LIMIT, "Direction must round-trip at -limit");
+static_assert(directionFromWire(directionToWire(clampDirection(DIRECTION_LIMIT - 1))) == DIRECTION_LIMIT - 1, "Direction must round-trip inside the limits");
+
+// Two sorted coin lists -> removal events for ids only in base, add events for ids only in current
+void writeCoinEvents(BitWriter& writer, const PongSnapshot& current, const PongSnapshot& base) {
+    uint32_t removed[MAX_NET_COINS];
+    const NetCoin* added[MAX_NET_COINS];
+    int numRemoved = 0;
+    int numAdded = 0;
+
+    int i = 0;
+    int j = 0;
+    while (i < base.numCoins || j < current.numCoins) {
+        if (j >= current.numCoins || (i < base.numCoins && base.coins[i].id < current.coins[j].id)) {
+            removed[numRemoved++] = base.coins[i++].id;
+        }
+        else if (i >= base.numCoins || current.coins[j].id < base.coins[i].id) {
+            added[numAdded++] = &current.coins[j++];
+        }
+        else {
+            // Coins never move, so a coin present on both sides needs no update
+            i++;
+            j++;
+        }
+    }
+
+    writer.write(numRemoved, NET_COIN_COUNT_BITS);
+    for (int k = 0; k < numRemoved; ++k) {
+        writer.write(removed[k], NET_COIN_ID_BITS);
+    }
+    writer.write(numAdded, NET_COIN_COUNT_BITS);
+    for (int k = 0; k < numAdded; ++k) {
+        writer.write(added[k]->id, NET_COIN_ID_BITS);
+        writer.write(added[k]->x, NET_POSITION_BITS);
+        writer.write(added[k]->y, NET_POSITION_BITS);
+    }
+}
+
+bool readCoinEvents(BitReader& reader, const PongSnapshot& base, PongSnapshot& out) {
+    uint32_t removed[MAX_NET_COINS];
+    NetCoin added[MAX_NET_COINS];
+
+    uint32_t numRemoved = reader.read(NET_COIN_COUNT_BITS);
+    if (numRemoved > MAX_NET_COINS) {
+        return false;
+    }
+    for (uint32_t k = 0; k < numRemoved; ++k) {
+        removed[k] = reader.read(NET_COIN_ID_BITS);
+    }
+    uint32_t numAdded = reader.read(NET_COIN_COUNT_BITS);
+    if (numAdded > MAX_NET_COINS) {
+        return false;
+    }
+    for (uint32_t k = 0; k < numAdded; ++k) {
+        added[k].id = reader.read(NET_COIN_ID_BITS);
+        added[k].x = static_cast<uint16_t>(reader.read(NET_POSITION_BITS));
+        added[k].y = static_cast<uint16_t>(reader.read(NET_POSITION_BITS));
+    }
+    if (reader.failed()) {
+        return false;
+    }
+
+    // Merge the surviving base coins with the added ones, keeping ids sorted
+    uint32_t r = 0;
+    uint32_t a = 0;
+    int count = 0;
+    for (int i = 0; i <= base.numCoins; ++i) {
+        bool haveBase = i < base.numCoins;
+        if (haveBase && r < numRemoved && removed[r] == base.coins[i].id) {
+            r++;
+            continue;
+        }
+        while (a < numAdded && (!haveBase || added[a].id < base.coins[i].id)) {
+            if (count >= MAX_NET_COINS) {
+                return false;
+            }
+            out.coins[count++] = added[a++];
+        }
+        if (haveBase) {
+            if (count >= MAX_NET_COINS) {
+                return false;
+            }
+            out.coins[count++] = base.coins[i];
+        }
+    }
+    out.numCoins = static_cast<uint8_t>(count);
+    return true;
+}
+
+const PongSnapshot& emptySnapshot() {
+    static PongSnapshot empty = {};
+    return empty;
+}
+
+} // namespace
+
+// --- Quantization ---
+
+uint16_t quantizePosition(float value) {
+    long q = std::lround(value * NET_POSITION_SCALE);
+    long maxValue = (1l << NET_POSITION_BITS) - 1;
+    if (q < 0) q = 0;
+    if (q > maxValue) q = maxValue;
+    return static_cast<uint16_t>(q);
+}
+
+float dequantizePosition(uint16_t value) {
+    return value / NET_POSITION_SCALE;
+}
+
+int16_t quantizeDirection(float value) {
+    return clampDirection(std::lround(value * NET_DIRECTION_SCALE));
+}
+
+float dequantizeDirection(int16_t value) {
+    return value / NET_DIRECTION_SCALE;
+}
+
+// --- Encoder ---
+
+SnapshotEncoder::SnapshotEncoder() : hasAcked(false), ackedSequence(0) {
+    memset(historyValid, 0, sizeof(historyValid));
+}
+
+void SnapshotEncoder::acknowledgeSnapshot(uint16_t sequence) {
+    // Ignore stale or reordered acks
+    if (hasAcked && static_cast<int16_t>(sequence - ackedSequence) <= 0) {
+        return;
+    }
+    hasAcked = true;
+    ackedSequence = sequence;
+}
+
+int SnapshotEncoder::encodeSnapshot(const PongSnapshot& snapshot, uint8_t* out, int capacity) {
+    // Only delta against the acked snapshot if it is still in our history
+    int ackedSlot = ackedSequence & (SNAPSHOT_HISTORY - 1);
+    bool useBaseline = hasAcked &&
+        historyValid[ackedSlot] &&
+        history[ackedSlot].sequence == ackedSequence &&
+        static_cast<uint16_t>(snapshot.sequence - ackedSequence) < SNAPSHOT_HISTORY;
+    const PongSnapshot& base = useBaseline ? history[ackedSlot] : emptySnapshot();
+
+    BitWriter writer(out, capacity);
+    writer.write(snapshot.sequence, 16);
+    writer.write(useBaseline ? 1 : 0, 1);
+    if (useBaseline) {
+        writer.write(ackedSequence, 16);
+    }
+
+    writeField(writer, snapshot.ballX, base.ballX, NET_POSITION_BITS);
+    writeField(writer, snapshot.ballY, base.ballY, NET_POSITION_BITS);
+    writeField(writer, directionToWire(snapshot.ballDX), directionToWire(base.ballDX), NET_DIRECTION_BITS);
+    writeField(writer, directionToWire(snapshot.ballDY), directionToWire(base.ballDY), NET_DIRECTION_BITS);
+    writer.write(snapshot.ballBoosted, 1);
+    writer.write(snapshot.lastHit, NET_LAST_HIT_BITS);
+    writeField(writer, snapshot.leftPaddleY, base.leftPaddleY, NET_POSITION_BITS);
+    writeField(writer, snapshot.rightPaddleY, base.rightPaddleY, NET_POSITION_BITS);
+    writeField(writer, snapshot.leftScore, base.leftScore, NET_SCORE_BITS);
+    writeField(writer, snapshot.rightScore, base.rightScore, NET_SCORE_BITS);
+    writeCoinEvents(writer, snapshot, base);
+    int bytes = writer.finish();
+    if (bytes == 0) {
+        return 0; // Never sent, so it must not become a baseline
+    }
+
+    int slot = snapshot.sequence & (SNAPSHOT_HISTORY - 1);
+    history[slot] = snapshot;
+    historyValid[slot] = true;
+    return bytes;
+}
+
+// --- Decoder ---
+
+SnapshotDecoder::SnapshotDecoder() {
+    memset(historyValid, 0, sizeof(historyValid));
+}
+
+bool SnapshotDecoder::decodeSnapshot(const uint8_t* data, int size, PongSnapshot& out) {
+    BitReader reader(data, size);
+    uint16_t sequence = static_cast<uint16_t>(reader.read(16));
+    const PongSnapshot* base = &emptySnapshot();
+    if (reader.read(1)) {
+        uint16_t baseSequence = static_cast<uint16_t>(reader.read(16));
+        int baseSlot = baseSequence & (SNAPSHOT_HISTORY - 1);
+        if (!historyValid[baseSlot] || history[baseSlot].sequence != baseSequence) {
+            return false; // Baseline already overwritten; wait for a newer ack round-trip
+        }
+        base = &history[baseSlot];
+    }
+
+    PongSnapshot result;
+    result.sequence = sequence;
+    result.ballX = static_cast<uint16_t>(readField(reader, base->ballX, NET_POSITION_BITS));
+    result.ballY = static_cast<uint16_t>(readField(reader, base->ballY, NET_POSITION_BITS));
+    result.ballDX = directionFromWire(readField(reader, directionToWire(base->ballDX), NET_DIRECTION_BITS));
+    result.ballDY = directionFromWire(readField(reader, directionToWire(base->ballDY), NET_DIRECTION_BITS));
+    result.ballBoosted = static_cast<uint8_t>(reader.read(1));
+    result.lastHit = static_cast<uint8_t>(reader.read(NET_LAST_HIT_BITS));
+    result.leftPaddleY = static_cast<uint16_t>(readField(reader, base->leftPaddleY, NET_POSITION_BITS));
+    result.rightPaddleY = static_cast<uint16_t>(readField(reader, base->rightPaddleY, NET_POSITION_BITS));
+    result.leftScore = static_cast<uint16_t>(readField(reader, base->leftScore, NET_SCORE_BITS));
+    result.rightScore = static_cast<uint16_t>(readField(reader, base->rightScore, NET_SCORE_BITS));
+    if (!readCoinEvents(reader, *base, result) || reader.failed()) {
+        return false;
+    }
+
+    int slot = sequence & (SNAPSHOT_HISTORY - 1);
+    history[slot] = result;
+    historyValid[slot] = true;
+    out = result;
+    return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include <cstdint>
+
+// Snapshot replication for networked play.
+//
+// Game state is quantized into a PongSnapshot, then SnapshotEncoder writes it
+// as a bit-packed delta against the newest snapshot the peer has acknowledged.
+// Unchanged fields cost a single bit, small changes a handful of bits, and
+// coins are sent as add/remove events instead of the whole coin list.
+// Neither side allocates: snapshots are fixed-size and kept in small rings.
+
+// Quantization steps
+const float NET_POSITION_SCALE = 8.0f;     // 1/8 pixel
+const float NET_DIRECTION_SCALE = 2048.0f; // Direction components are in [-1, 1]
+
+const int NET_POSITION_BITS = 14;  // Up to 2048 pixels at 1/8 pixel
+const int NET_DIRECTION_BITS = 13; // +-2048, offset by 4096 on the wire so it is never negative
+const int NET_SCORE_BITS = 16;
+const int NET_COIN_ID_BITS = 32;   // Match-wide coin counter; never wraps in practice
+const int NET_COIN_COUNT_BITS = 6; // 0..MAX_NET_COINS
+const int NET_LAST_HIT_BITS = 2;
+
+const int MAX_NET_COINS = 32;
+const int SNAPSHOT_HISTORY = 32;    // Snapshots remembered on each side (power of two)
+
+// Worst-case encoded size: every field in its long form (2 flag bits plus
+// the full width) and the whole coin list replaced (every base coin removed,
+// every current coin added)
+const int MAX_SNAPSHOT_BITS =
+    16 + 1 + 16 +                               // Sequence, baseline flag, baseline sequence
+    4 * (2 + NET_POSITION_BITS) +               // Ball and paddle positions
+    2 * (2 + NET_DIRECTION_BITS) +              // Ball direction
+    1 + NET_LAST_HIT_BITS +                     // Boost flag, last hit
+    2 * (2 + NET_SCORE_BITS) +                  // Scores
+    2 * NET_COIN_COUNT_BITS +                   // Removal and addition counts
+    MAX_NET_COINS * NET_COIN_ID_BITS +          // Removals
+    MAX_NET_COINS * (NET_COIN_ID_BITS + 2 * NET_POSITION_BITS); // Additions
+const int MAX_SNAPSHOT_BYTES = (MAX_SNAPSHOT_BITS + 7) / 8;
+
+struct NetCoin {
+    uint32_t id;
+    uint16_t x, y; // Quantized position
+};
+
+struct PongSnapshot {
+    uint16_t sequence;
+
+    uint16_t ballX, ballY;   // Quantized position
+    int16_t ballDX, ballDY;  // Quantized direction
+    uint8_t ballBoosted;     // 1 while the post-reflection boost is active
+    uint8_t lastHit;         // LastHit as an integer
+
+    uint16_t leftPaddleY, rightPaddleY;
+    uint16_t leftScore, rightScore;
+
+    // Active coins, sorted by id
+    uint8_t numCoins;
+    NetCoin coins[MAX_NET_COINS];
+};
+
+uint16_t quantizePosition(float value);
+float dequantizePosition(uint16_t value);
+int16_t quantizeDirection(float value);
+float dequantizeDirection(int16_t value);
+
+// Sending side. Call encodeSnapshot() once per tick and acknowledgeSnapshot()
+// whenever the peer confirms it has decoded a sequence number.
+class SnapshotEncoder {
+public:
+    SnapshotEncoder();
+
+    // Writes snapshot (delta-compressed against the last acknowledged one) into out.
+    // Returns the number of bytes written, or 0 if capacity was too small.
+    int encodeSnapshot(const PongSnapshot& snapshot, uint8_t* out, int capacity);
+
+    void acknowledgeSnapshot(uint16_t sequence);
+
+private:
+    PongSnapshot history[SNAPSHOT_HISTORY];
+    bool historyValid[SNAPSHOT_HISTORY];
+    bool hasAcked;
+    uint16_t ackedSequence;
+};
+
+// Receiving side. Keeps the snapshots it has decoded so later deltas can use them.
+class SnapshotDecoder {
+public:
+    SnapshotDecoder();
+
+    // Decodes a packet produced by SnapshotEncoder. Returns false if the packet is
+    // malformed or refers to a baseline this decoder no longer has.
+    bool decodeSnapshot(const uint8_t* data, int size, PongSnapshot& out);
+
+private:
+    PongSnapshot history[SNAPSHOT_HISTORY];
+    bool historyValid[SNAPSHOT_HISTORY];
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "rle_sprite.h"
+#include <cstring>  // For memcpy
+#include <iostream> // For error output
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RLE_SPRITE_SSE2 1
+#endif
+
+namespace {
+
+const Uint16 MAX_RUN = 0xFFFF;
+
+inline Uint32 premultiply(Uint32 argb) {
+    Uint32 a = argb >> 24;
+    Uint32 r = (((argb >> 16) & 0xFF) * a + 127) / 255;
+    Uint32 g = (((argb >> 8) & 0xFF) * a + 127) / 255;
+    Uint32 b = ((argb & 0xFF) * a + 127) / 255;
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+// x * y / 255, rounded, for 8-bit x and y
+inline Uint32 mul255(Uint32 x, Uint32 y) {
+    Uint32 t = x * y + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+// dst = src + dst * (1 - src alpha) for premultiplied src
+void blendSpan(const Uint32* src, Uint32* dst, int count) {
+    int i = 0;
+#ifdef RLE_SPRITE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi32(255);
+    const __m128i round = _mm_set1_epi16(128);
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        // 255 - alpha in both 16-bit halves of each pixel's lane, then spread to all four channels
+        __m128i inverse = _mm_sub_epi32(full, _mm_srli_epi32(s, 24));
+        inverse = _mm_or_si128(inverse, _mm_slli_epi32(inverse, 16));
+        __m128i inverseLo = _mm_unpacklo_epi32(inverse, inverse);
+        __m128i inverseHi = _mm_unpackhi_epi32(inverse, inverse);
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inverseLo), round);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inverseHi), round);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_adds_epu8(_mm_packus_epi16(lo, hi), s));
+    }
+#endif
+    for (; i < count; ++i) {
+        Uint32 s = src[i];
+        Uint32 d = dst[i];
+        Uint32 inverse = 255 - (s >> 24);
+        Uint32 a = (s >> 24) + mul255(d >> 24, inverse);
+        Uint32 r = ((s >> 16) & 0xFF) + mul255((d >> 16) & 0xFF, inverse);
+        Uint32 g = ((s >> 8) & 0xFF) + mul255((d >> 8) & 0xFF, inverse);
+        Uint32 b = (s & 0xFF) + mul255(d & 0xFF, inverse);
+        dst[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+} // namespace
+
+RleSprite* createRleSprite(SDL_Surface* surface) {
+    SDL_Surface* argb = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    if (argb == nullptr) {
+        std::cerr << "Failed to convert sprite for RLE encoding! SDL_Error: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+
+    RleSprite* sprite = new RleSprite();
+    sprite->width = argb->w;
+    sprite->height = argb->h;
+    sprite->rowRuns.reserve(argb->h);
+    sprite->rowPixels.reserve(argb->h);
+    for (int y = 0; y < argb->h; ++y) {
+        const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(argb->pixels) + y * argb->pitch);
+        sprite->rowRuns.push_back(static_cast<Uint32>(sprite->runs.size()));
+        sprite->rowPixels.push_back(static_cast<Uint32>(sprite->pixels.size()));
+        int x = 0;
+        while (x < argb->w) {
+            Uint16 transparent = 0, opaque = 0, translucent = 0;
+            while (x < argb->w && (row[x] >> 24) == 0 && transparent < MAX_RUN) {
+                transparent++;
+                x++;
+            }
+            while (x < argb->w && (row[x] >> 24) == 255 && opaque < MAX_RUN) {
+                sprite->pixels.push_back(row[x]);
+                opaque++;
+                x++;
+            }
+            while (x < argb->w && (row[x] >> 24) != 0 && (row[x] >> 24) != 255 && translucent < MAX_RUN) {
+                sprite->pixels.push_back(premultiply(row[x]));
+                translucent++;
+                x++;
+            }
+            sprite->runs.insert(sprite->runs.end(), { transparent, opaque, translucent });
+        }
+    }
+    SDL_FreeSurface(argb);
+    return sprite;
+}
+
+void freeRleSprite(RleSprite* sprite) {
+    delete sprite;
+}
+
+bool blitRleSprite(const RleSprite* sprite, SDL_Surface* target, int x, int y) {
+    if (sprite == nullptr || target == nullptr || target->format == nullptr) {
+        return false;
+    }
+    Uint32 format = target->format->format;
+    if (format != SDL_PIXELFORMAT_ARGB8888 && format != SDL_PIXELFORMAT_RGB888) {
+        return false;
+    }
+
+    const SDL_Rect& clip = target->clip_rect;
+    int firstRow = y < clip.y ? clip.y - y : 0;
+    int lastRow = y + sprite->height > clip.y + clip.h ? clip.y + clip.h - y : sprite->height;
+    int clipLeft = clip.x - x;                // Visible columns in sprite coordinates: [clipLeft, clipRight)
+    int clipRight = clip.x + clip.w - x;
+    if (firstRow >= lastRow || clipRight <= 0 || clipLeft >= sprite->width) {
+        return true; // Entirely clipped
+    }
+
+    if (SDL_MUSTLOCK(target) && SDL_LockSurface(target) != 0) {
+        return false;
+    }
+    for (int row = firstRow; row < lastRow; ++row) {
+        Uint32* dst = reinterpret_cast<Uint32*>(static_cast<Uint8*>(target->pixels) + (y + row) * target->pitch);
+        const Uint16* run = sprite->runs.data() + sprite->rowRuns[row];
+        const Uint32* src = sprite->pixels.data() + sprite->rowPixels[row];
+        int column = 0;
+        while (column < sprite->width && column < clipRight) {
+            column += run[0];
+            for (int kind = 1; kind <= 2; ++kind) {
+                int start = column;
+                int end = column + run[kind];
+                int visibleStart = start > clipLeft ? start : clipLeft;
+                int visibleEnd = end < clipRight ? end : clipRight;
+                if (visibleStart < visibleEnd) {
+                    const Uint32* from = src + (visibleStart - start);
+                    if (kind == 1) {
+                        memcpy(dst + x + visibleStart, from, (visibleEnd - visibleStart) * sizeof(Uint32));
+                    }
+                    else {
+                        blendSpan(from, dst + x + visibleStart, visibleEnd - visibleStart);
+                    }
+                }
+                src += run[kind];
+                column = end;
+            }
+            run += 3;
+        }
+    }
+    if (SDL_MUSTLOCK(target)) {
+        SDL_UnlockSurface(target);
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef RLE_SPRITE_H
+#define RLE_SPRITE_H
+
+#include <SDL.h>
+#include <vector>
+
+// Run-length encoded sprites for drawing straight into a software surface.
+//
+// Each row is stored as a sequence of (transparent, opaque, translucent) run
+// lengths followed by the pixels of the opaque and translucent runs. Blitting
+// skips transparent runs without reading them, copies opaque runs with memcpy
+// and alpha-blends only the translucent edge pixels (four at a time with
+// SSE2). Translucent pixels are stored premultiplied so blending is one
+// multiply per channel. Sprites are encoded once at the size they are drawn;
+// there is no scaling at blit time.
+
+struct RleSprite {
+    int width;
+    int height;
+    std::vector<Uint16> runs;       // Run length triples, row after row
+    std::vector<Uint32> pixels;     // ARGB8888; premultiplied in translucent runs
+    std::vector<Uint32> rowRuns;    // Index of each row's first run in runs
+    std::vector<Uint32> rowPixels;  // Index of each row's first pixel in pixels
+};
+
+// Encodes any SDL surface. Returns nullptr (and prints why) on failure.
+RleSprite* createRleSprite(SDL_Surface* surface);
+
+void freeRleSprite(RleSprite* sprite);
+
+// Blends sprite onto target with its top-left corner at (x, y), clipped to the
+// target's clip rectangle. target must be a 32-bit ARGB8888 or RGB888 surface
+// (what SDL gives windows on desktop systems); returns false without drawing
+// for other formats so the caller can fall back to SDL_BlitSurface.
+bool blitRleSprite(const RleSprite* sprite, SDL_Surface* target, int x, int y);
+
+#endif
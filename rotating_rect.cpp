@@ -1,6 +1,8 @@
 #include <SDL.h>
 #include <iostream>
 
+#include "renderer_select.h" // Render driver chosen by a startup benchmark (link renderer_select.cpp)
+
 // Function to create a simple 1x1 white texture
 // This can be used to draw colored rectangles directly with SDL_RenderCopyEx
 SDL_Texture* createWhiteTexture(SDL_Renderer* renderer) {
@@ -42,10 +44,9 @@ int main(int argc, char* argv[]) {
     }
 
     // Create a renderer
-    // SDL_RENDERER_ACCELERATED uses hardware acceleration, SDL_RENDERER_PRESENTVSYNC caps frame rate
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    // The fastest driver on this machine (measured once, then cached); SDL_RENDERER_PRESENTVSYNC caps frame rate
+    SDL_Renderer* renderer = createFastestRenderer(window, SDL_RENDERER_PRESENTVSYNC, nullptr);
     if (!renderer) {
-        std::cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError() << std::endl;
         SDL_DestroyWindow(window);
         SDL_Quit();
         return 1;
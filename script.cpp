@@ -0,0 +1,221 @@
+#include "script.h"
+#include <exception> // For std::terminate
+#include <iostream>  // For error output
+#include <new>       // For ::operator new / ::operator delete
+
+// --- Coroutine Frame Pool ---
+// Frames are grouped into a few size classes. Each class keeps a free list of
+// blocks that is refilled a whole slab at a time, so once enough scripts have
+// run the pool stops asking the heap for memory altogether.
+
+namespace {
+
+const size_t FRAME_SIZE_CLASSES[] = { 128, 256, 512, 1024 };
+const int NUM_FRAME_SIZE_CLASSES = sizeof(FRAME_SIZE_CLASSES) / sizeof(FRAME_SIZE_CLASSES[0]);
+const int FRAMES_PER_SLAB = 64;
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+// Slabs are never returned to the heap: the pool lives for the whole process,
+// so schedulers with static storage can still release frames during shutdown.
+// Each thread has its own pool, so matches can run on several threads without
+// locking; a frame released on another thread just joins that thread's list.
+struct FramePool {
+    FreeBlock* freeLists[NUM_FRAME_SIZE_CLASSES] = {};
+};
+
+FramePool& framePool() {
+    static thread_local FramePool* pool = new FramePool();
+    return *pool;
+}
+
+int frameSizeClass(size_t size) {
+    for (int i = 0; i < NUM_FRAME_SIZE_CLASSES; ++i) {
+        if (size <= FRAME_SIZE_CLASSES[i]) {
+            return i;
+        }
+    }
+    return -1; // Too big for the pool
+}
+
+void refillFrameClass(FramePool& pool, int sizeClass) {
+    size_t blockSize = FRAME_SIZE_CLASSES[sizeClass];
+    char* slab = static_cast<char*>(::operator new(blockSize * FRAMES_PER_SLAB));
+    for (int i = 0; i < FRAMES_PER_SLAB; ++i) {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + i * blockSize);
+        block->next = pool.freeLists[sizeClass];
+        pool.freeLists[sizeClass] = block;
+    }
+}
+
+} // namespace
+
+void* Script::promise_type::operator new(std::size_t size) {
+    int sizeClass = frameSizeClass(size);
+    if (sizeClass < 0) {
+        // Unusually large script (huge locals); fall back to the heap
+        return ::operator new(size);
+    }
+    FramePool& pool = framePool();
+    if (pool.freeLists[sizeClass] == nullptr) {
+        refillFrameClass(pool, sizeClass);
+    }
+    FreeBlock* block = pool.freeLists[sizeClass];
+    pool.freeLists[sizeClass] = block->next;
+    return block;
+}
+
+void Script::promise_type::operator delete(void* ptr, std::size_t size) {
+    int sizeClass = frameSizeClass(size);
+    if (sizeClass < 0) {
+        ::operator delete(ptr);
+        return;
+    }
+    FramePool& pool = framePool();
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = pool.freeLists[sizeClass];
+    pool.freeLists[sizeClass] = block;
+}
+
+void Script::promise_type::unhandled_exception() {
+    std::cerr << "Unhandled exception in script!" << std::endl;
+    std::terminate();
+}
+
+// --- Script ---
+
+Script& Script::operator=(Script&& other) noexcept {
+    if (this != &other) {
+        if (handle) {
+            handle.destroy();
+        }
+        handle = other.handle;
+        other.handle = nullptr;
+    }
+    return *this;
+}
+
+Script::~Script() {
+    // A script that was never started still owns its frame
+    if (handle) {
+        handle.destroy();
+    }
+}
+
+Script::Handle Script::release() {
+    Handle released = handle;
+    handle = nullptr;
+    return released;
+}
+
+// --- Awaitables ---
+
+void WaitTicks::await_suspend(Script::Handle handle) const {
+    ScriptScheduler* scheduler = handle.promise().scheduler;
+    int delay = ticks > 0 ? ticks : 1;
+    scheduler->waitUntilTick(handle, scheduler->currentTick() + delay);
+}
+
+// --- Scheduler ---
+
+ScriptScheduler::ScriptScheduler() : tick(0), waitingCount(0) {
+}
+
+ScriptScheduler::~ScriptScheduler() {
+    clearScripts();
+}
+
+void ScriptScheduler::startScript(Script script) {
+    Script::Handle handle = script.release();
+    if (!handle) {
+        return;
+    }
+    handle.promise().scheduler = this;
+    handle.resume(); // Runs until the first co_await (or to completion)
+}
+
+void ScriptScheduler::waitUntilTick(Script::Handle handle, unsigned long long dueTick) {
+    wheel[dueTick % WHEEL_SLOTS].push_back({ handle, dueTick });
+    waitingCount++;
+}
+
+void ScriptScheduler::waitUntil(Script::Handle handle, bool (*predicate)(void*), void* context) {
+    predicateWaits.push_back({ handle, predicate, context });
+    waitingCount++;
+}
+
+void ScriptScheduler::runScripts() {
+    tick++;
+
+    // Pull everything due this tick out of its slot before resuming anything,
+    // since resumed scripts may schedule themselves back into the same slot
+    std::vector<TimedWait>& slot = wheel[tick % WHEEL_SLOTS];
+    size_t kept = 0;
+    for (size_t i = 0; i < slot.size(); ++i) {
+        if (slot[i].dueTick <= tick) {
+            dueNow.push_back(slot[i]);
+        }
+        else {
+            slot[kept++] = slot[i]; // Due on a later lap of the wheel
+        }
+    }
+    slot.resize(kept);
+
+    waitingCount -= dueNow.size();
+    for (const TimedWait& wait : dueNow) {
+        wait.handle.resume();
+    }
+    dueNow.clear();
+
+    // Check predicate waits; scripts that are still blocked go back on the list
+    predicateScratch.swap(predicateWaits);
+    for (const PredicateWait& wait : predicateScratch) {
+        if (wait.predicate(wait.context)) {
+            waitingCount--;
+            wait.handle.resume();
+        }
+        else {
+            predicateWaits.push_back(wait);
+        }
+    }
+    predicateScratch.clear();
+}
+
+size_t ScriptScheduler::getTimedWaits(unsigned int* ticksLeft, size_t capacity) const {
+    // Insertion sort into the caller's array, keeping the capacity smallest;
+    // wheel order depends on when scripts started, the remaining ticks do not
+    size_t count = 0;
+    for (const std::vector<TimedWait>& slot : wheel) {
+        for (const TimedWait& wait : slot) {
+            unsigned int left = static_cast<unsigned int>(wait.dueTick - tick);
+            size_t filled = count < capacity ? count : capacity;
+            size_t i = filled;
+            for (; i > 0 && ticksLeft[i - 1] > left; --i) {
+                if (i < capacity) {
+                    ticksLeft[i] = ticksLeft[i - 1];
+                }
+            }
+            if (i < capacity) {
+                ticksLeft[i] = left;
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+void ScriptScheduler::clearScripts() {
+    for (std::vector<TimedWait>& slot : wheel) {
+        for (const TimedWait& wait : slot) {
+            wait.handle.destroy();
+        }
+        slot.clear();
+    }
+    for (const PredicateWait& wait : predicateWaits) {
+        wait.handle.destroy();
+    }
+    predicateWaits.clear();
+    waitingCount = 0;
+}
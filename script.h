@@ -0,0 +1,152 @@
+#pragma once
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <coroutine>
+#include <cstddef>
+#include <vector>
+
+// Coroutine-based gameplay scripting.
+//
+// A script is a plain function returning Script that uses co_await to wait:
+//
+//     Script coinSpawner() {
+//         for (;;) {
+//             co_await wait_ticks(300);
+//             spawnCoin();
+//         }
+//     }
+//
+// Scripts are started on a ScriptScheduler and resumed from runScripts(),
+// which is called once per game tick. Coroutine frames are carved out of a
+// pooled free list, so starting and finishing scripts does not touch the heap
+// once the pool has warmed up.
+
+class ScriptScheduler;
+
+class Script {
+public:
+    struct promise_type {
+        ScriptScheduler* scheduler = nullptr;
+
+        Script get_return_object() {
+            return Script(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        // Scripts do not run until they are handed to a scheduler
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        // Finished scripts destroy themselves, returning their frame to the pool
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception();
+
+        static void* operator new(std::size_t size);
+        static void operator delete(void* ptr, std::size_t size);
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Script() = default;
+    explicit Script(Handle handle) : handle(handle) {}
+    Script(Script&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Script& operator=(Script&& other) noexcept;
+    Script(const Script&) = delete;
+    Script& operator=(const Script&) = delete;
+    ~Script();
+
+    // Releases ownership of the coroutine frame (used by the scheduler)
+    Handle release();
+
+private:
+    Handle handle = nullptr;
+};
+
+// Owns every running script and resumes them once per tick.
+// Timed waits are kept in a timing wheel and predicate waits in a flat list
+// of function pointers, so resuming does not go through any virtual calls.
+class ScriptScheduler {
+public:
+    ScriptScheduler();
+    ~ScriptScheduler();
+    ScriptScheduler(const ScriptScheduler&) = delete;
+    ScriptScheduler& operator=(const ScriptScheduler&) = delete;
+
+    // Runs the script until its first co_await
+    void startScript(Script script);
+
+    // Advances the tick counter and resumes every script that is due
+    void runScripts();
+
+    // Destroys all suspended scripts (e.g. at shutdown)
+    void clearScripts();
+
+    unsigned long long currentTick() const { return tick; }
+    size_t scriptCount() const { return waitingCount; }
+
+    // Ticks left on the timed waits, smallest first, for hashing the game
+    // state: at most capacity of them are written. Returns how many there are.
+    size_t getTimedWaits(unsigned int* ticksLeft, size_t capacity) const;
+    size_t predicateWaitCount() const { return predicateWaits.size(); }
+
+    // Used by the awaitables below
+    void waitUntilTick(Script::Handle handle, unsigned long long dueTick);
+    void waitUntil(Script::Handle handle, bool (*predicate)(void*), void* context);
+
+private:
+    static const int WHEEL_SLOTS = 256;
+
+    struct TimedWait {
+        Script::Handle handle;
+        unsigned long long dueTick;
+    };
+
+    struct PredicateWait {
+        Script::Handle handle;
+        bool (*predicate)(void*);
+        void* context;
+    };
+
+    std::vector<TimedWait> wheel[WHEEL_SLOTS];
+    std::vector<TimedWait> dueNow;
+    std::vector<PredicateWait> predicateWaits;
+    std::vector<PredicateWait> predicateScratch;
+    unsigned long long tick;
+    size_t waitingCount;
+};
+
+// co_await wait_ticks(n): resumes the script n ticks later (n <= 0 resumes on the next tick)
+struct WaitTicks {
+    int ticks;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Script::Handle handle) const;
+    void await_resume() const noexcept {}
+};
+
+inline WaitTicks wait_ticks(int ticks) {
+    return WaitTicks{ ticks };
+}
+
+// co_await until(pred): resumes the script on the first tick where pred() is true.
+// The predicate is stored inside the awaiter, which lives in the coroutine frame,
+// so waiting on a lambda does not allocate.
+template <typename Predicate>
+struct WaitUntil {
+    Predicate predicate;
+
+    bool await_ready() { return predicate(); }
+    void await_suspend(Script::Handle handle) {
+        handle.promise().scheduler->waitUntil(handle, &WaitUntil::call, this);
+    }
+    void await_resume() const noexcept {}
+
+    static bool call(void* self) {
+        return static_cast<WaitUntil*>(self)->predicate();
+    }
+};
+
+template <typename Predicate>
+WaitUntil<Predicate> until(Predicate predicate) {
+    return WaitUntil<Predicate>{ predicate };
+}
+
+#endif
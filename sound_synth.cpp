@@ -0,0 +1,98 @@
+#include "sound_synth.h"
+#include <cmath>    // For sin/exp/log/isinf
+#include <iostream> // For error output
+
+namespace {
+
+const float TWO_PI = 6.28318531f;
+const float MAX_SYNTH_SECONDS = 2.0f; // Guards against typos producing huge buffers
+
+// Oscillator value for a phase in [0, 1)
+float oscillator(SynthWaveform waveform, float phase, float dutyCycle) {
+    switch (waveform) {
+    case SynthWaveform::Square:
+        return phase < dutyCycle ? 1.0f : -1.0f;
+    case SynthWaveform::Triangle:
+        return phase < 0.5f ? phase * 4.0f - 1.0f : 3.0f - phase * 4.0f;
+    case SynthWaveform::Sine:
+        return std::sin(phase * TWO_PI);
+    case SynthWaveform::Saw:
+        return phase * 2.0f - 1.0f;
+    case SynthWaveform::Noise:
+        break;
+    }
+    return 0.0f;
+}
+
+} // namespace
+
+MixerSound* synthesizeSound(const SynthParams& params, int sampleRate) {
+    if (sampleRate <= 0) {
+        std::cerr << "Sound synth: invalid sample rate " << sampleRate << "!" << std::endl;
+        return nullptr;
+    }
+    // The slide takes the log of their ratio; !(x > 0) also catches NaN
+    if (!(params.startFrequency > 0.0f) || !(params.endFrequency > 0.0f) || std::isinf(params.startFrequency) ||
+        std::isinf(params.endFrequency) || (params.jumpTime > 0.0f && !(params.jumpRatio > 0.0f))) {
+        std::cerr << "Sound synth: frequencies must be positive (start " << params.startFrequency << " Hz, end "
+                  << params.endFrequency << " Hz, jump ratio " << params.jumpRatio << ")!" << std::endl;
+        return nullptr;
+    }
+    float duration = params.attack + params.hold + params.decay;
+    if (duration > MAX_SYNTH_SECONDS) {
+        duration = MAX_SYNTH_SECONDS;
+    }
+    int length = static_cast<int>(duration * sampleRate);
+    if (length <= 0) {
+        return nullptr;
+    }
+    MixerSound* sound = allocateMixerSound(length);
+
+    // Per-sample multiplier for an exponential slide from startFrequency to endFrequency
+    float slide = std::exp(std::log(params.endFrequency / params.startFrequency) / length);
+    float frequency = params.startFrequency;
+    int jumpSample = params.jumpTime > 0.0f ? static_cast<int>(params.jumpTime * sampleRate) : -1;
+    int attackEnd = static_cast<int>(params.attack * sampleRate);
+    int holdEnd = attackEnd + static_cast<int>(params.hold * sampleRate);
+    float phase = 0.0f;
+    Uint32 noiseState = 0x9E3779B9u; // Fixed seed: the same parameters always sound the same
+
+    for (int i = 0; i < length; ++i) {
+        if (i == jumpSample) {
+            frequency *= params.jumpRatio;
+        }
+
+        float value = 0.0f;
+        if (params.waveform != SynthWaveform::Noise) {
+            value = oscillator(params.waveform, phase, params.dutyCycle);
+        }
+        if (params.waveform == SynthWaveform::Noise || params.noiseMix > 0.0f) {
+            // xorshift32 white noise in [-1, 1]
+            noiseState ^= noiseState << 13;
+            noiseState ^= noiseState >> 17;
+            noiseState ^= noiseState << 5;
+            float noise = static_cast<float>(noiseState) * (2.0f / 4294967296.0f) - 1.0f;
+            float mix = params.waveform == SynthWaveform::Noise ? 1.0f : params.noiseMix;
+            value += (noise - value) * mix;
+        }
+
+        float envelope;
+        if (i < attackEnd) {
+            envelope = static_cast<float>(i) / attackEnd;
+        }
+        else if (i < holdEnd) {
+            envelope = 1.0f;
+        }
+        else {
+            // Quadratic fade sounds more natural than linear for short blips
+            float t = 1.0f - static_cast<float>(i - holdEnd) / (length - holdEnd);
+            envelope = t * t;
+        }
+        sound->samples[i] = value * envelope * params.volume;
+
+        phase += frequency / sampleRate;
+        phase -= std::floor(phase);
+        frequency *= slide;
+    }
+    return sound;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#ifndef SOUND_SYNTH_H
+#define SOUND_SYNTH_H
+
+#include "audio_mixer.h"
+
+// Tiny procedural synthesizer for sound effects.
+//
+// Each effect is one oscillator (or noise) with an exponential pitch slide, an
+// optional pitch jump (the classic two-note coin chime) and an
+// attack/hold/decay envelope. Effects are rendered to mixer PCM once at
+// startup, so nothing is decoded from disk and a whole effect set takes a few
+// hundred KB at most. Per-event variation (pitch, pan) is applied by the mixer
+// at play time.
+
+enum class SynthWaveform {
+    Square,
+    Triangle,
+    Sine,
+    Saw,
+    Noise
+};
+
+struct SynthParams {
+    SynthWaveform waveform;
+    float startFrequency; // Hz
+    float endFrequency;   // Hz, reached at the end of the sound (exponential slide)
+    float jumpTime;       // Seconds until the pitch jumps by jumpRatio; 0 = no jump
+    float jumpRatio;
+    float dutyCycle;      // Square wave only, 0..1
+    float noiseMix;       // 0 = pure oscillator, 1 = pure noise
+    float attack;         // Seconds
+    float hold;           // Seconds at full volume
+    float decay;          // Seconds to fade out
+    float volume;         // Peak amplitude, 0..1
+};
+
+// Preset for picking up a coin: two quick square-wave notes
+const SynthParams COIN_SYNTH = { SynthWaveform::Square, 988.0f, 988.0f, 0.07f, 1.335f, 0.5f, 0.0f, 0.002f, 0.05f, 0.25f, 0.5f };
+// Preset for the ball hitting a paddle: short, slightly noisy triangle blip falling in pitch
+const SynthParams PADDLE_HIT_SYNTH = { SynthWaveform::Triangle, 660.0f, 440.0f, 0.0f, 1.0f, 0.5f, 0.15f, 0.001f, 0.015f, 0.09f, 0.8f };
+
+// Renders an effect at the given sample rate. Returns nullptr (and prints why)
+// if the rate or a frequency (start, end, jump ratio) is not positive.
+// The same parameters always give the same samples.
+MixerSound* synthesizeSound(const SynthParams& params, int sampleRate);
+
+#endif
@@ -0,0 +1,506 @@
+#include "spectator.h"
+#include <iostream> // For error output
+#include <cstring>  // For memcpy, memset, strerror
+#include <cerrno>   // For errno
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef int socklen_t;
+const SpectatorSocket INVALID_SPECTATOR_SOCKET = INVALID_SOCKET;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+const SpectatorSocket INVALID_SPECTATOR_SOCKET = -1;
+#endif
+
+namespace {
+
+const uint8_t JOIN_MESSAGE = 'J';
+const uint8_t STATE_REQUEST_MESSAGE = 'S'; // Followed by the tick (4 bytes, little-endian)
+const size_t MAX_STATE_REQUESTS = 16;       // Pending per host; more are dropped and asked again
+const int SEND_BATCH = 256;         // Spectators per sendmmsg call
+const int SEND_BUFFER_BYTES = 4 << 20;
+const int RECEIVE_BUFFER_BYTES = 1 << 20; // Room for a burst of join datagrams
+
+bool startSockets() {
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "WSAStartup failed!" << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+void stopSockets() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+int getSocketError() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+// The send buffer is full; nothing else is wrong
+bool isSocketBufferFull(int error) {
+#ifdef _WIN32
+    return error == WSAEWOULDBLOCK;
+#else
+    return error == EAGAIN || error == EWOULDBLOCK;
+#endif
+}
+
+void closeSocket(SpectatorSocket sock) {
+#ifdef _WIN32
+    closesocket(sock);
+#else
+    ::close(sock);
+#endif
+}
+
+bool setNonBlocking(SpectatorSocket sock) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(sock, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+SpectatorSocket openUdpSocket() {
+    if (!startSockets()) {
+        return INVALID_SPECTATOR_SOCKET;
+    }
+    SpectatorSocket sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_SPECTATOR_SOCKET) {
+        std::cerr << "Failed to create spectator socket!" << std::endl;
+        stopSockets();
+        return INVALID_SPECTATOR_SOCKET;
+    }
+    if (!setNonBlocking(sock)) {
+        std::cerr << "Failed to make spectator socket non-blocking!" << std::endl;
+        closeSocket(sock);
+        stopSockets();
+        return INVALID_SPECTATOR_SOCKET;
+    }
+    return sock;
+}
+
+// Seed (4 bytes, little-endian), the (tick, hash) message, then the inputs
+void writeLockstep(const SpectatorLockstep& lockstep, uint8_t* out) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(lockstep.seed >> (8 * i));
+    }
+    writeStateHashMessage(lockstep.tick, lockstep.hash, out + 4);
+    memcpy(out + 4 + STATE_HASH_MESSAGE_BYTES, lockstep.inputs, SPECTATOR_INPUT_HISTORY);
+}
+
+SpectatorLockstep readLockstep(const uint8_t* data) {
+    SpectatorLockstep lockstep;
+    lockstep.seed = 0;
+    for (int i = 0; i < 4; ++i) {
+        lockstep.seed |= static_cast<uint32_t>(data[i]) << (8 * i);
+    }
+    readStateHashMessage(data + 4, lockstep.tick, lockstep.hash);
+    memcpy(lockstep.inputs, data + 4 + STATE_HASH_MESSAGE_BYTES, SPECTATOR_INPUT_HISTORY);
+    return lockstep;
+}
+
+} // namespace
+
+// --- Broadcaster ---
+
+SpectatorBroadcaster::SpectatorBroadcaster()
+    : sock(INVALID_SPECTATOR_SOCKET), ticksSinceKeyframe(0), haveSent(false), lastSequence(0), droppedSends(0), lastSendError(0) {
+}
+
+SpectatorBroadcaster::~SpectatorBroadcaster() {
+    close();
+}
+
+bool SpectatorBroadcaster::open(uint16_t port) {
+    close();
+    sock = openUdpSocket();
+    if (sock == INVALID_SPECTATOR_SOCKET) {
+        return false;
+    }
+
+    // Large buffers let one tick's burst to thousands of spectators go out without EAGAIN,
+    // and let many spectators join at once without their join datagrams being dropped
+    int sendBuffer = SEND_BUFFER_BYTES;
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&sendBuffer), sizeof(sendBuffer));
+    int receiveBuffer = RECEIVE_BUFFER_BYTES;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&receiveBuffer), sizeof(receiveBuffer));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Failed to bind spectator port " << port << "!" << std::endl;
+        close();
+        return false;
+    }
+    std::cout << "Broadcasting match to spectators on UDP port " << port << "." << std::endl;
+    return true;
+}
+
+void SpectatorBroadcaster::close() {
+    if (sock != INVALID_SPECTATOR_SOCKET) {
+        closeSocket(sock);
+        stopSockets();
+        sock = INVALID_SPECTATOR_SOCKET;
+    }
+    spectators.clear();
+}
+
+bool SpectatorBroadcaster::isOpen() const {
+    return sock != INVALID_SPECTATOR_SOCKET;
+}
+
+void SpectatorBroadcaster::acceptJoins(uint32_t nowMs) {
+    uint8_t message[16];
+    sockaddr_in from;
+    socklen_t fromLength = sizeof(from);
+    for (;;) {
+        int received = recvfrom(sock, reinterpret_cast<char*>(message), sizeof(message), 0,
+            reinterpret_cast<sockaddr*>(&from), &fromLength);
+        if (received <= 0) {
+            break; // Nothing left (or a transient error); try again next tick
+        }
+        if (received == 5 && message[0] == STATE_REQUEST_MESSAGE) {
+            if (stateRequests.size() < MAX_STATE_REQUESTS) {
+                uint32_t tick = 0;
+                for (int i = 0; i < 4; ++i) {
+                    tick |= static_cast<uint32_t>(message[1 + i]) << (8 * i);
+                }
+                stateRequests.push_back({ from.sin_addr.s_addr, from.sin_port, tick });
+            }
+            fromLength = sizeof(from);
+            continue;
+        }
+        if (received != 1 || message[0] != JOIN_MESSAGE) {
+            continue;
+        }
+        bool known = false;
+        for (Spectator& spectator : spectators) {
+            if (spectator.address == from.sin_addr.s_addr && spectator.port == from.sin_port) {
+                spectator.lastSeenMs = nowMs;
+                known = true;
+                break;
+            }
+        }
+        if (!known) {
+            spectators.push_back({ from.sin_addr.s_addr, from.sin_port, nowMs });
+            // Newcomers need a full snapshot to start from
+            ticksSinceKeyframe = SPECTATOR_KEYFRAME_INTERVAL;
+        }
+        fromLength = sizeof(from);
+    }
+
+    // Drop spectators that stopped sending keep-alives (swap-and-pop)
+    for (size_t i = 0; i < spectators.size(); ) {
+        if (nowMs - spectators[i].lastSeenMs > SPECTATOR_TIMEOUT_MS) {
+            spectators[i] = spectators.back();
+            spectators.pop_back();
+        }
+        else {
+            ++i;
+        }
+    }
+}
+
+void SpectatorBroadcaster::sendToAll(const uint8_t* packet, int size) {
+    size_t dropped = 0;
+#if defined(__linux__)
+    // One iovec shared by every message: the packet is built once and never copied per spectator
+    iovec payload;
+    payload.iov_base = const_cast<uint8_t*>(packet);
+    payload.iov_len = static_cast<size_t>(size);
+
+    sockaddr_in addresses[SEND_BATCH];
+    mmsghdr messages[SEND_BATCH];
+    size_t next = 0;
+    while (next < spectators.size()) {
+        int batch = 0;
+        for (; batch < SEND_BATCH && next < spectators.size(); ++batch, ++next) {
+            memset(&addresses[batch], 0, sizeof(sockaddr_in));
+            addresses[batch].sin_family = AF_INET;
+            addresses[batch].sin_addr.s_addr = spectators[next].address;
+            addresses[batch].sin_port = spectators[next].port;
+
+            memset(&messages[batch], 0, sizeof(mmsghdr));
+            messages[batch].msg_hdr.msg_name = &addresses[batch];
+            messages[batch].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            messages[batch].msg_hdr.msg_iov = &payload;
+            messages[batch].msg_hdr.msg_iovlen = 1;
+        }
+        // sendmmsg stops at the first message it cannot send: resume after it
+        int sent = 0;
+        while (sent < batch) {
+            int result = sendmmsg(sock, messages + sent, static_cast<unsigned int>(batch - sent), 0);
+            if (result > 0) {
+                sent += result;
+                continue;
+            }
+            int error = getSocketError();
+            if (error == EINTR) {
+                continue;
+            }
+            if (isSocketBufferFull(error)) {
+                // Everyone left catches up on the next keyframe
+                reportSendError(error);
+                droppedSends += dropped + spectators.size() - (next - batch + sent);
+                return;
+            }
+            reportSendError(error); // Only this spectator's datagram failed
+            dropped++;
+            sent++;
+        }
+    }
+#else
+    for (size_t i = 0; i < spectators.size(); ++i) {
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = spectators[i].address;
+        address.sin_port = spectators[i].port;
+        if (sendto(sock, reinterpret_cast<const char*>(packet), size, 0,
+                reinterpret_cast<sockaddr*>(&address), sizeof(address)) >= 0) {
+            continue;
+        }
+        int error = getSocketError();
+        if (isSocketBufferFull(error)) {
+            reportSendError(error);
+            droppedSends += dropped + spectators.size() - i;
+            return;
+        }
+        reportSendError(error);
+        dropped++;
+    }
+#endif
+    if (dropped > 0) {
+        droppedSends += dropped;
+    }
+    else if (droppedSends > 0) {
+        std::cout << "Spectator sends recovered; " << droppedSends << " datagrams were dropped." << std::endl;
+        droppedSends = 0;
+        lastSendError = 0;
+    }
+}
+
+// Prints each kind of failure once, not on every tick it persists
+void SpectatorBroadcaster::reportSendError(int error) {
+    if (error != lastSendError) {
+        std::cerr << "Spectator send failed (" << (isSocketBufferFull(error) ? "send buffer full" : strerror(error))
+                  << ", error " << error << "); dropping datagrams until sends succeed again." << std::endl;
+        lastSendError = error;
+    }
+}
+
+void SpectatorBroadcaster::broadcast(const PongSnapshot& snapshot, uint32_t nowMs, const SpectatorLockstep* lockstep) {
+    if (!isOpen()) {
+        return;
+    }
+    acceptJoins(nowMs);
+    if (spectators.empty()) {
+        return;
+    }
+
+    // Delta against the previous tick, or a keyframe when it is due
+    if (haveSent && ticksSinceKeyframe < SPECTATOR_KEYFRAME_INTERVAL) {
+        encoder.acknowledgeSnapshot(lastSequence);
+        ticksSinceKeyframe++;
+    }
+    else {
+        encoder = SnapshotEncoder();
+        ticksSinceKeyframe = 0;
+    }
+
+    uint8_t packet[MAX_SPECTATOR_PACKET_BYTES];
+    int header = 1;
+    packet[0] = 0;
+    if (lockstep) {
+        packet[0] |= SPECTATOR_PACKET_LOCKSTEP;
+        writeLockstep(*lockstep, packet + header);
+        header += SPECTATOR_LOCKSTEP_BYTES;
+    }
+    int size = encoder.encodeSnapshot(snapshot, packet + header, MAX_SNAPSHOT_BYTES);
+    lastSequence = snapshot.sequence;
+    haveSent = true;
+    if (size > 0) {
+        sendToAll(packet, header + size);
+    }
+}
+
+bool SpectatorBroadcaster::takeStateRequest(SpectatorStateRequest& request) {
+    if (stateRequests.empty()) {
+        return false;
+    }
+    request = stateRequests.front();
+    stateRequests.erase(stateRequests.begin());
+    return true;
+}
+
+void SpectatorBroadcaster::sendState(const SpectatorStateRequest& request, const uint8_t* state, size_t size) {
+    if (!isOpen() || size > MAX_CANONICAL_STATE_BYTES) {
+        return;
+    }
+    uint8_t packet[MAX_SPECTATOR_PACKET_BYTES];
+    packet[0] = SPECTATOR_PACKET_STATE;
+    for (int i = 0; i < 4; ++i) {
+        packet[1 + i] = static_cast<uint8_t>(request.tick >> (8 * i));
+    }
+    packet[5] = static_cast<uint8_t>(size);
+    packet[6] = static_cast<uint8_t>(size >> 8);
+    memcpy(packet + 1 + SPECTATOR_STATE_HEADER_BYTES, state, size);
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = request.address;
+    address.sin_port = request.port;
+    if (sendto(sock, reinterpret_cast<const char*>(packet), static_cast<int>(1 + SPECTATOR_STATE_HEADER_BYTES + size), 0,
+            reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        reportSendError(getSocketError()); // The spectator asks again
+    }
+}
+
+// --- Client ---
+
+SpectatorClient::SpectatorClient()
+    : sock(INVALID_SPECTATOR_SOCKET), lastJoinMs(0), joined(false), remoteStateSize(0), remoteStateTick(0), haveRemoteState(false) {
+}
+
+SpectatorClient::~SpectatorClient() {
+    close();
+}
+
+bool SpectatorClient::connect(const char* host, uint16_t port) {
+    close();
+    sock = openUdpSocket();
+    if (sock == INVALID_SPECTATOR_SOCKET) {
+        return false;
+    }
+
+    // A connected UDP socket only receives from the host and can use plain send()
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &address.sin_addr) != 1 ||
+        ::connect(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Failed to connect to spectator host " << host << ":" << port << "!" << std::endl;
+        close();
+        return false;
+    }
+    decoder = SnapshotDecoder();
+    joined = false;
+    haveRemoteState = false;
+    return true;
+}
+
+void SpectatorClient::close() {
+    if (sock != INVALID_SPECTATOR_SOCKET) {
+        closeSocket(sock);
+        stopSockets();
+        sock = INVALID_SPECTATOR_SOCKET;
+    }
+}
+
+bool SpectatorClient::isOpen() const {
+    return sock != INVALID_SPECTATOR_SOCKET;
+}
+
+void SpectatorClient::sendJoin(uint32_t nowMs) {
+    if (joined && nowMs - lastJoinMs < SPECTATOR_JOIN_INTERVAL_MS) {
+        return;
+    }
+    // Until the host answers, ask on every call: a lockstep spectator has to
+    // be in within SPECTATOR_INPUT_HISTORY ticks of the start of the match
+    send(sock, reinterpret_cast<const char*>(&JOIN_MESSAGE), 1, 0);
+    lastJoinMs = nowMs;
+}
+
+bool SpectatorClient::receiveLatest(PongSnapshot& out, uint32_t nowMs, std::vector<SpectatorLockstep>* lockstep) {
+    if (!isOpen()) {
+        return false;
+    }
+    sendJoin(nowMs);
+
+    bool updated = false;
+    uint8_t packet[MAX_SPECTATOR_PACKET_BYTES];
+    for (;;) {
+        int received = recv(sock, reinterpret_cast<char*>(packet), sizeof(packet), 0);
+        if (received <= 0) {
+            break;
+        }
+        joined = true; // The host has us; keep-alives are enough from now on
+        if (packet[0] & SPECTATOR_PACKET_STATE) {
+            if (received >= 1 + SPECTATOR_STATE_HEADER_BYTES) {
+                size_t size = packet[5] | (static_cast<size_t>(packet[6]) << 8);
+                if (size <= MAX_CANONICAL_STATE_BYTES && static_cast<size_t>(received) == 1 + SPECTATOR_STATE_HEADER_BYTES + size) {
+                    remoteStateTick = 0;
+                    for (int i = 0; i < 4; ++i) {
+                        remoteStateTick |= static_cast<uint32_t>(packet[1 + i]) << (8 * i);
+                    }
+                    memcpy(remoteState, packet + 1 + SPECTATOR_STATE_HEADER_BYTES, size);
+                    remoteStateSize = size;
+                    haveRemoteState = true;
+                }
+            }
+            continue;
+        }
+        int header = 1;
+        if (packet[0] & SPECTATOR_PACKET_LOCKSTEP) {
+            if (received < header + SPECTATOR_LOCKSTEP_BYTES) {
+                continue;
+            }
+            if (lockstep) {
+                lockstep->push_back(readLockstep(packet + header));
+            }
+            header += SPECTATOR_LOCKSTEP_BYTES;
+        }
+        // Deltas build on each other, so every packet is decoded in order;
+        // ones whose baseline was lost are skipped until the next keyframe
+        if (received > header && decoder.decodeSnapshot(packet + header, received - header, out)) {
+            updated = true;
+        }
+    }
+    return updated;
+}
+
+void SpectatorClient::requestState(uint32_t tick) {
+    if (!isOpen()) {
+        return;
+    }
+    uint8_t message[5] = { STATE_REQUEST_MESSAGE };
+    for (int i = 0; i < 4; ++i) {
+        message[1 + i] = static_cast<uint8_t>(tick >> (8 * i));
+    }
+    send(sock, reinterpret_cast<const char*>(message), sizeof(message), 0);
+}
+
+bool SpectatorClient::takeRemoteState(uint32_t& tick, const uint8_t*& data, size_t& size) {
+    if (!haveRemoteState) {
+        return false;
+    }
+    haveRemoteState = false;
+    tick = remoteStateTick;
+    data = remoteState;
+    size = remoteStateSize;
+    return true;
+}
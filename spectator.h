@@ -0,0 +1,153 @@
+#pragma once
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "replication.h"
+#include "statehash.h" // STATE_HASH_MESSAGE_BYTES
+
+// Spectator streaming over UDP.
+//
+// The match host serializes each tick exactly once into an immutable packet
+// and sends that same buffer to every spectator (batched through sendmmsg on
+// Linux), so the serialization cost does not grow with the audience.
+// Spectators announce themselves with a small join datagram that doubles as a
+// keep-alive; silent spectators are dropped after SPECTATOR_TIMEOUT_MS.
+//
+// Because spectators never acknowledge, every packet is a delta against the
+// previous tick, and every SPECTATOR_KEYFRAME_INTERVAL ticks a full snapshot
+// is sent so late joiners and spectators that lost a packet can resync.
+//
+// When the host hashes its state (see statehash.h), every packet also carries
+// a SpectatorLockstep record: the match seed, this tick's state hash and the
+// inputs of the last SPECTATOR_INPUT_HISTORY ticks. A spectator that follows
+// the match from its start can re-simulate it from those instead of mirroring
+// the snapshots and check its own hash of every tick against the host's; the
+// repeated inputs let it ride out a few lost packets. When its hash of a tick
+// disagrees, it asks the host for that tick's canonical state with a state
+// request, and the host answers that spectator alone, so the spectator can
+// dump both sides of the desync (see statehash.h).
+//
+// Packet layout: flags byte, SpectatorLockstep if SPECTATOR_PACKET_LOCKSTEP is
+// set (seed, writeStateHashMessage, inputs), then the encoded snapshot. A
+// SPECTATOR_PACKET_STATE packet instead holds the tick (4 bytes), the state
+// size (2 bytes, both little-endian) and the state.
+
+const uint16_t DEFAULT_SPECTATOR_PORT = 27015;
+const int SPECTATOR_KEYFRAME_INTERVAL = 60;  // Ticks between full snapshots
+const uint32_t SPECTATOR_TIMEOUT_MS = 5000;  // Drop spectators silent for this long
+const uint32_t SPECTATOR_JOIN_INTERVAL_MS = 1000;
+
+const uint8_t SPECTATOR_PACKET_LOCKSTEP = 1 << 0;
+const uint8_t SPECTATOR_PACKET_STATE = 1 << 1;
+const int SPECTATOR_INPUT_HISTORY = 16; // Ticks of input repeated in every packet
+
+struct SpectatorLockstep {
+    uint32_t seed;  // As given to startMatch
+    uint32_t tick;  // Tick the snapshot and hash belong to
+    uint64_t hash;
+    uint8_t inputs[SPECTATOR_INPUT_HISTORY]; // REPLAY_* bits; inputs[i] is tick - i
+};
+
+const int SPECTATOR_LOCKSTEP_BYTES = 4 + STATE_HASH_MESSAGE_BYTES + SPECTATOR_INPUT_HISTORY;
+const int SPECTATOR_STATE_HEADER_BYTES = 4 + 2;
+const int MAX_SPECTATOR_PACKET_BYTES = 1 + (SPECTATOR_LOCKSTEP_BYTES + MAX_SNAPSHOT_BYTES > SPECTATOR_STATE_HEADER_BYTES + MAX_CANONICAL_STATE_BYTES
+                                                ? SPECTATOR_LOCKSTEP_BYTES + MAX_SNAPSHOT_BYTES
+                                                : SPECTATOR_STATE_HEADER_BYTES + MAX_CANONICAL_STATE_BYTES);
+
+// A spectator asking for the host's canonical state of a tick
+struct SpectatorStateRequest {
+    uint32_t address; // IPv4, network byte order
+    uint16_t port;    // Network byte order
+    uint32_t tick;
+};
+
+#ifdef _WIN32
+typedef uintptr_t SpectatorSocket;
+#else
+typedef int SpectatorSocket;
+#endif
+
+class SpectatorBroadcaster {
+public:
+    SpectatorBroadcaster();
+    ~SpectatorBroadcaster();
+
+    bool open(uint16_t port);
+    void close();
+    bool isOpen() const;
+
+    // Serializes the snapshot (and lockstep record, if any) once and sends it
+    // to every live spectator. nowMs is used to accept joins and expire silent
+    // spectators.
+    void broadcast(const PongSnapshot& snapshot, uint32_t nowMs, const SpectatorLockstep* lockstep = nullptr);
+
+    size_t spectatorCount() const { return spectators.size(); }
+
+    // Hands out the state requests broadcast() received, oldest first.
+    // Answer each with sendState, or drop it if the tick is no longer known.
+    bool takeStateRequest(SpectatorStateRequest& request);
+    void sendState(const SpectatorStateRequest& request, const uint8_t* state, size_t size);
+
+private:
+    struct Spectator {
+        uint32_t address; // IPv4, network byte order
+        uint16_t port;    // Network byte order
+        uint32_t lastSeenMs;
+    };
+
+    void acceptJoins(uint32_t nowMs);
+    void sendToAll(const uint8_t* packet, int size);
+    void reportSendError(int error);
+
+    SpectatorSocket sock;
+    SnapshotEncoder encoder;
+    std::vector<Spectator> spectators;
+    std::vector<SpectatorStateRequest> stateRequests;
+    int ticksSinceKeyframe;
+    bool haveSent;
+    uint16_t lastSequence;
+    size_t droppedSends; // Datagrams lost since sends last fully succeeded
+    int lastSendError;   // Already reported; 0 once sends succeed again
+};
+
+class SpectatorClient {
+public:
+    SpectatorClient();
+    ~SpectatorClient();
+
+    bool connect(const char* host, uint16_t port);
+    void close();
+    bool isOpen() const;
+
+    // Drains every pending packet and stores the newest decodable snapshot in out.
+    // Also sends the join datagram: on every call until the host's first
+    // packet arrives, then as a keep-alive every SPECTATOR_JOIN_INTERVAL_MS.
+    // With lockstep, the lockstep records of every packet are appended to it
+    // in arrival order. Returns true if out was updated.
+    bool receiveLatest(PongSnapshot& out, uint32_t nowMs, std::vector<SpectatorLockstep>* lockstep = nullptr);
+
+    // Asks the host for its canonical state of tick; the answer arrives
+    // through receiveLatest and is picked up with takeRemoteState
+    void requestState(uint32_t tick);
+
+    // The newest state the host sent in answer to requestState, once
+    bool takeRemoteState(uint32_t& tick, const uint8_t*& data, size_t& size);
+
+private:
+    void sendJoin(uint32_t nowMs);
+
+    SpectatorSocket sock;
+    SnapshotDecoder decoder;
+    uint32_t lastJoinMs;
+    bool joined; // Received from the host since connecting
+    uint8_t remoteState[MAX_CANONICAL_STATE_BYTES];
+    size_t remoteStateSize;
+    uint32_t remoteStateTick;
+    bool haveRemoteState;
+};
+
+#endif
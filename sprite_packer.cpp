@@ -0,0 +1,244 @@
+// Build-time tool: trims the transparent border off animation frames and packs
+// them into one power-of-two atlas in a .sprites file (see sprite_sheet.h).
+//
+// Not part of the game project; build it as its own console program against
+// SDL2 and SDL2_image together with qoi_image.cpp, then rerun it whenever the
+// frames change:
+//
+//   sprite_packer coin.sprites coin_01.png coin_02.png ... coin_08.png
+//   sprite_packer sprite.sprites --grid 4 4 sprite.png
+//
+// Every input image is one frame, unless it follows --grid COLUMNS ROWS, in
+// which case it is cut into cells of width / COLUMNS by height / ROWS pixels
+// (integer division, the same cells the game used to address in the sheet),
+// row by row. Frames keep the order they are given in.
+//
+// The game's coin.sprites is checked in, built by the first command above;
+// commit it again after rerunning.
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include "qoi_image.h"
+#include "sprite_sheet.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int FRAME_PADDING = 1;     // Empty pixels between frames so linear filtering never bleeds
+const int MAX_ATLAS_SIZE = 4096; // Safe texture size on every renderer
+
+struct PackedFrame {
+    SpriteFrame info;
+    std::vector<Uint8> rgba; // info.w * info.h trimmed pixels
+};
+
+// Crops one cell of an RGBA32 surface to its non-transparent pixels
+PackedFrame trimFrame(const SDL_Surface* surface, int cellX, int cellY, int cellW, int cellH) {
+    PackedFrame frame;
+    frame.info = {};
+    frame.info.sourceW = static_cast<Uint16>(cellW);
+    frame.info.sourceH = static_cast<Uint16>(cellH);
+    frame.info.pivotX = static_cast<Sint16>(cellW / 2);
+    frame.info.pivotY = static_cast<Sint16>(cellH / 2);
+
+    int minX = cellW, minY = cellH, maxX = -1, maxY = -1;
+    for (int y = 0; y < cellH; ++y) {
+        const Uint8* row = static_cast<const Uint8*>(surface->pixels) + (cellY + y) * surface->pitch + cellX * 4;
+        for (int x = 0; x < cellW; ++x) {
+            if (row[x * 4 + 3] != 0) {
+                minX = std::min(minX, x);
+                maxX = std::max(maxX, x);
+                minY = std::min(minY, y);
+                maxY = std::max(maxY, y);
+            }
+        }
+    }
+    if (maxX < 0) {
+        return frame; // Fully transparent: nothing to pack
+    }
+
+    frame.info.offsetX = static_cast<Sint16>(minX);
+    frame.info.offsetY = static_cast<Sint16>(minY);
+    frame.info.w = static_cast<Uint16>(maxX - minX + 1);
+    frame.info.h = static_cast<Uint16>(maxY - minY + 1);
+    frame.rgba.resize(static_cast<size_t>(frame.info.w) * frame.info.h * 4);
+    for (int y = 0; y < frame.info.h; ++y) {
+        const Uint8* row = static_cast<const Uint8*>(surface->pixels) + (cellY + minY + y) * surface->pitch + (cellX + minX) * 4;
+        std::copy(row, row + frame.info.w * 4, frame.rgba.begin() + static_cast<size_t>(y) * frame.info.w * 4);
+    }
+    return frame;
+}
+
+// Loads an image and appends its frames (one, or columns * rows with --grid)
+bool addFrames(const std::string& path, int columns, int rows, std::vector<PackedFrame>& frames) {
+    SDL_Surface* loaded = IMG_Load(path.c_str());
+    if (loaded == nullptr) {
+        std::cerr << "Failed to load " << path << "! SDL_image Error: " << IMG_GetError() << std::endl;
+        return false;
+    }
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (rgba == nullptr) {
+        std::cerr << "Failed to convert " << path << "! SDL_Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    int cellW = rgba->w / columns;
+    int cellH = rgba->h / rows;
+    if (cellW * columns != rgba->w || cellH * rows != rgba->h) {
+        std::cerr << "Warning: " << path << " (" << rgba->w << "x" << rgba->h << ") does not divide evenly into "
+                  << columns << "x" << rows << " cells; the last " << rgba->w - cellW * columns << " columns and "
+                  << rgba->h - cellH * rows << " rows of pixels are not part of any frame." << std::endl;
+    }
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            frames.push_back(trimFrame(rgba, column * cellW, row * cellH, cellW, cellH));
+        }
+    }
+    SDL_FreeSurface(rgba);
+    return true;
+}
+
+// Shelf packing, tallest frames first, into an atlas of the given width.
+// Returns the height used, or -1 if a frame is wider than the atlas.
+int packShelves(std::vector<PackedFrame*>& order, int atlasWidth) {
+    int x = FRAME_PADDING, y = FRAME_PADDING, shelfHeight = 0;
+    for (PackedFrame* frame : order) {
+        if (frame->info.w + 2 * FRAME_PADDING > atlasWidth) {
+            return -1;
+        }
+        if (x + frame->info.w + FRAME_PADDING > atlasWidth) {
+            x = FRAME_PADDING;
+            y += shelfHeight + FRAME_PADDING;
+            shelfHeight = 0;
+        }
+        frame->info.x = static_cast<Uint16>(x);
+        frame->info.y = static_cast<Uint16>(y);
+        x += frame->info.w + FRAME_PADDING;
+        shelfHeight = std::max(shelfHeight, static_cast<int>(frame->info.h));
+    }
+    return y + shelfHeight + FRAME_PADDING;
+}
+
+int nextPowerOfTwo(int value) {
+    int result = 1;
+    while (result < value) {
+        result *= 2;
+    }
+    return result;
+}
+
+// Tries every power-of-two width and keeps the smallest atlas (squarest on ties).
+// Returns false if the frames do not fit in MAX_ATLAS_SIZE.
+bool packFrames(std::vector<PackedFrame>& frames, int& atlasWidth, int& atlasHeight) {
+    std::vector<PackedFrame*> order;
+    for (PackedFrame& frame : frames) {
+        if (frame.info.w > 0) {
+            order.push_back(&frame);
+        }
+    }
+    std::sort(order.begin(), order.end(), [](const PackedFrame* a, const PackedFrame* b) { return a->info.h > b->info.h; });
+
+    int bestWidth = 0, bestHeight = 0;
+    for (int width = 1; width <= MAX_ATLAS_SIZE; width *= 2) {
+        int used = packShelves(order, width);
+        if (used < 0 || used > MAX_ATLAS_SIZE) {
+            continue;
+        }
+        int height = nextPowerOfTwo(used);
+        long long area = static_cast<long long>(width) * height;
+        long long bestArea = static_cast<long long>(bestWidth) * bestHeight;
+        if (bestWidth == 0 || area < bestArea || (area == bestArea && std::abs(width - height) < std::abs(bestWidth - bestHeight))) {
+            bestWidth = width;
+            bestHeight = height;
+        }
+    }
+    if (bestWidth == 0) {
+        return false;
+    }
+    packShelves(order, bestWidth); // Redo the placement for the chosen width
+    atlasWidth = bestWidth;
+    atlasHeight = bestHeight;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* args[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: sprite_packer <out.sprites> [--grid COLUMNS ROWS] <image.png> [more images...]" << std::endl;
+        return 1;
+    }
+    if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
+        std::cerr << "SDL_image could not initialize! IMG_Error: " << IMG_GetError() << std::endl;
+        return 1;
+    }
+
+    std::string outputPath = args[1];
+    std::vector<PackedFrame> frames;
+    int columns = 1, rows = 1;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = args[i];
+        if (arg == "--grid" && i + 2 < argc) {
+            columns = std::max(1, std::atoi(args[i + 1]));
+            rows = std::max(1, std::atoi(args[i + 2]));
+            i += 2;
+            continue;
+        }
+        if (!addFrames(arg, columns, rows, frames)) {
+            IMG_Quit();
+            return 1;
+        }
+        columns = rows = 1; // --grid applies to the next image only
+    }
+    IMG_Quit();
+    if (frames.empty() || frames.size() > 0xFFFF) {
+        std::cerr << "Need between 1 and 65535 frames, got " << frames.size() << "." << std::endl;
+        return 1;
+    }
+
+    int atlasWidth, atlasHeight;
+    if (!packFrames(frames, atlasWidth, atlasHeight)) {
+        std::cerr << "Frames do not fit in a " << MAX_ATLAS_SIZE << "x" << MAX_ATLAS_SIZE << " atlas!" << std::endl;
+        return 1;
+    }
+    std::vector<Uint8> pixels(static_cast<size_t>(atlasWidth) * atlasHeight * 4, 0);
+    size_t sourcePixels = 0, trimmedPixels = 0;
+    for (const PackedFrame& frame : frames) {
+        for (int y = 0; y < frame.info.h; ++y) {
+            std::copy(frame.rgba.begin() + static_cast<size_t>(y) * frame.info.w * 4,
+                      frame.rgba.begin() + static_cast<size_t>(y + 1) * frame.info.w * 4,
+                      pixels.begin() + (static_cast<size_t>(frame.info.y + y) * atlasWidth + frame.info.x) * 4);
+        }
+        sourcePixels += static_cast<size_t>(frame.info.sourceW) * frame.info.sourceH;
+        trimmedPixels += static_cast<size_t>(frame.info.w) * frame.info.h;
+    }
+    std::vector<Uint8> image = encodeQoi(pixels.data(), atlasWidth, atlasHeight);
+
+    SpriteSheetHeader header = {};
+    header.magic = SPRITE_SHEET_MAGIC;
+    header.version = SPRITE_SHEET_VERSION;
+    header.frameCount = static_cast<Uint16>(frames.size());
+    header.atlasWidth = static_cast<Uint16>(atlasWidth);
+    header.atlasHeight = static_cast<Uint16>(atlasHeight);
+    header.imageBytes = static_cast<Uint32>(image.size());
+
+    std::ofstream out(outputPath, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const PackedFrame& frame : frames) {
+        out.write(reinterpret_cast<const char*>(&frame.info), sizeof(frame.info));
+    }
+    out.write(reinterpret_cast<const char*>(image.data()), image.size());
+    if (!out) {
+        std::cerr << "Failed to write " << outputPath << "!" << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << outputPath << ": " << frames.size() << " frames, " << atlasWidth << "x" << atlasHeight
+              << " atlas; frames cover " << trimmedPixels << " of " << sourcePixels << " source pixels." << std::endl;
+    return 0;
+}
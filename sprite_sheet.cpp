@@ -0,0 +1,118 @@
+#include "sprite_sheet.h"
+#include "image_loader.h"
+#include "mapped_file.h"
+#include "qoi_image.h" // readQoiHeader
+#include <cmath>    // For std::lround
+#include <cstring>  // For memcpy
+#include <iostream> // For error output
+
+SpriteSheet* loadSpriteSheet(SDL_Renderer* renderer, const char* path) {
+    MappedFile file;
+    if (!mapFile(path, file)) {
+        return nullptr;
+    }
+
+    SpriteSheetHeader header;
+    if (file.size < sizeof(header)) {
+        std::cerr << "Sprite sheet " << path << " is truncated!" << std::endl;
+        unmapFile(file);
+        return nullptr;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    if (header.magic != SPRITE_SHEET_MAGIC || header.version != SPRITE_SHEET_VERSION) {
+        std::cerr << "Sprite sheet " << path << " has the wrong format or version; rebuild it with sprite_packer." << std::endl;
+        unmapFile(file);
+        return nullptr;
+    }
+    size_t frameBytes = sizeof(SpriteFrame) * header.frameCount;
+    if (file.size < sizeof(header) + frameBytes + header.imageBytes) {
+        std::cerr << "Sprite sheet " << path << " is truncated!" << std::endl;
+        unmapFile(file);
+        return nullptr;
+    }
+
+    // Frames are drawn from the embedded image and scaled by their source size
+    const Uint8* image = file.data + sizeof(header) + frameBytes;
+    int imageWidth, imageHeight;
+    if (!readQoiHeader(image, header.imageBytes, imageWidth, imageHeight) || imageWidth != header.atlasWidth ||
+        imageHeight != header.atlasHeight) {
+        std::cerr << "Sprite sheet " << path << " does not contain a " << header.atlasWidth << "x" << header.atlasHeight << " QOI image!" << std::endl;
+        unmapFile(file);
+        return nullptr;
+    }
+    std::vector<SpriteFrame> frames(header.frameCount);
+    memcpy(frames.data(), file.data + sizeof(header), frameBytes);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const SpriteFrame& f = frames[i];
+        const char* problem = nullptr;
+        if (f.sourceW == 0 || f.sourceH == 0) {
+            problem = "has an empty source size";
+        }
+        else if (f.x + f.w > imageWidth || f.y + f.h > imageHeight) {
+            problem = "lies outside the image";
+        }
+        else if (f.offsetX < 0 || f.offsetY < 0 || f.offsetX + f.w > f.sourceW || f.offsetY + f.h > f.sourceH) {
+            problem = "is trimmed to pixels outside its source frame";
+        }
+        if (problem) {
+            std::cerr << "Sprite sheet " << path << ": frame " << i << " (" << f.x << ", " << f.y << ", " << f.w << "x" << f.h
+                      << ", source " << f.sourceW << "x" << f.sourceH << ") " << problem << "!" << std::endl;
+            unmapFile(file);
+            return nullptr;
+        }
+    }
+
+    SpriteSheet* sheet = new SpriteSheet();
+    sheet->frames.swap(frames);
+    sheet->texture = createQoiTexture(renderer, image, header.imageBytes, path);
+    unmapFile(file);
+    if (sheet->texture == nullptr) {
+        delete sheet;
+        return nullptr;
+    }
+    return sheet;
+}
+
+void freeSpriteSheet(SpriteSheet* sheet) {
+    if (sheet == nullptr) {
+        return;
+    }
+    if (sheet->texture) {
+        SDL_DestroyTexture(sheet->texture);
+    }
+    delete sheet;
+}
+
+bool getSpriteFrameRects(const SpriteSheet* sheet, int frame, const SDL_Rect& dstRect, SDL_Rect& src, SDL_FRect& dst) {
+    if (sheet == nullptr || frame < 0 || frame >= static_cast<int>(sheet->frames.size())) {
+        return false;
+    }
+    const SpriteFrame& f = sheet->frames[frame];
+    if (f.w == 0 || f.h == 0) {
+        return false; // Nothing but transparency
+    }
+    // Map the trimmed rectangle through the same scale the whole frame would get,
+    // in floats so scaled frames keep sub-pixel placement
+    float scaleX = static_cast<float>(dstRect.w) / f.sourceW;
+    float scaleY = static_cast<float>(dstRect.h) / f.sourceH;
+    src = { f.x, f.y, f.w, f.h };
+    dst = { dstRect.x + f.offsetX * scaleX, dstRect.y + f.offsetY * scaleY, f.w * scaleX, f.h * scaleY };
+    return true;
+}
+
+SDL_Rect getSpriteFramePlacement(const SpriteSheet* sheet, int frame, int x, int y, float scale) {
+    if (sheet == nullptr || frame < 0 || frame >= static_cast<int>(sheet->frames.size())) {
+        return { x, y, 0, 0 };
+    }
+    const SpriteFrame& f = sheet->frames[frame];
+    return { x - static_cast<int>(std::lround(f.pivotX * scale)), y - static_cast<int>(std::lround(f.pivotY * scale)),
+             static_cast<int>(f.sourceW * scale), static_cast<int>(f.sourceH * scale) };
+}
+
+void drawSpriteFrame(SDL_Renderer* renderer, const SpriteSheet* sheet, int frame, const SDL_Rect& dstRect) {
+    SDL_Rect src;
+    SDL_FRect dst;
+    if (getSpriteFrameRects(sheet, frame, dstRect, src, dst)) {
+        SDL_RenderCopyF(renderer, sheet->texture, &src, &dst);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#ifndef SPRITE_SHEET_H
+#define SPRITE_SHEET_H
+
+#include <SDL.h>
+#include <vector>
+
+// Trimmed, packed animation frames.
+//
+// sprite_packer (a separate build-time tool) crops the transparent border off
+// every frame and packs the remaining pixels into one power-of-two atlas. Each
+// frame remembers where its trimmed pixels sat in the original image, so a
+// frame is drawn into the same destination rectangle as the untrimmed image
+// and lands on exactly the same screen pixels, while the GPU only touches the
+// non-transparent part.
+//
+// File layout (little-endian): SpriteSheetHeader, frameCount SpriteFrame
+// entries in input order, then imageBytes of QOI-encoded atlas (see
+// qoi_image.h).
+
+const Uint32 SPRITE_SHEET_MAGIC = 0x53525053; // "SPRS"
+const Uint16 SPRITE_SHEET_VERSION = 1;
+
+struct SpriteSheetHeader {
+    Uint32 magic;
+    Uint16 version;
+    Uint16 frameCount;
+    Uint16 atlasWidth;
+    Uint16 atlasHeight;
+    Uint32 imageBytes;
+};
+
+struct SpriteFrame {
+    Uint16 x, y, w, h;        // Trimmed pixels in the atlas; w and h are 0 for a fully transparent frame
+    Sint16 offsetX, offsetY;  // Top-left of the trimmed pixels within the original frame
+    Uint16 sourceW, sourceH;  // Size of the original, untrimmed frame
+    Sint16 pivotX, pivotY;    // Anchor point within the original frame (its center by default)
+};
+
+static_assert(sizeof(SpriteSheetHeader) == 16, "SpriteSheetHeader must match the file layout");
+static_assert(sizeof(SpriteFrame) == 20, "SpriteFrame must match the file layout");
+
+struct SpriteSheet {
+    SDL_Texture* texture;
+    std::vector<SpriteFrame> frames;
+};
+
+// Maps and uploads a .sprites file. Returns nullptr (and prints why) on
+// failure, including frames with an empty source size and frame rectangles
+// outside the embedded image or their source frame.
+SpriteSheet* loadSpriteSheet(SDL_Renderer* renderer, const char* path);
+
+void freeSpriteSheet(SpriteSheet* sheet);
+
+// Draws a frame where the untrimmed image would be drawn with
+// SDL_RenderCopy(renderer, texture, nullptr, &dstRect).
+void drawSpriteFrame(SDL_Renderer* renderer, const SpriteSheet* sheet, int frame, const SDL_Rect& dstRect);
+
+// Where the whole untrimmed frame goes when drawn at scale with its pivot on
+// (x, y): the dstRect to pass to drawSpriteFrame
+SDL_Rect getSpriteFramePlacement(const SpriteSheet* sheet, int frame, int x, int y, float scale);
+
+// The source rectangle in the atlas and the destination drawSpriteFrame would
+// use, for callers that batch their own draws. Returns false if the frame is
+// out of range or fully transparent (nothing to draw).
+bool getSpriteFrameRects(const SpriteSheet* sheet, int frame, const SDL_Rect& dstRect, SDL_Rect& src, SDL_FRect& dst);
+
+#endif
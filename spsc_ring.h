@@ -0,0 +1,90 @@
+#pragma once
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed-capacity single-producer / single-consumer queue.
+//
+// One thread pushes and exactly one other thread pops; neither ever takes a
+// lock or waits. A full ring makes push() fail instead of blocking, and an
+// empty ring makes pop() fail. Capacity must be a power of two.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : head(0), tail(0) {}
+
+    // Producer thread only
+    bool push(const T& item) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) >= Capacity) {
+            return false;
+        }
+        items[currentTail & (Capacity - 1)] = item;
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only
+    bool pop(T& item) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[currentHead & (Capacity - 1)];
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer thread only: pushes up to count items, returns how many fit
+    size_t pushMany(const T* source, size_t count) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        size_t space = Capacity - (currentTail - head.load(std::memory_order_acquire));
+        if (count > space) {
+            count = space;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            items[(currentTail + i) & (Capacity - 1)] = source[i];
+        }
+        tail.store(currentTail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer thread only: pops up to count items, returns how many were available
+    size_t popMany(T* destination, size_t count) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        size_t available = tail.load(std::memory_order_acquire) - currentHead;
+        if (count > available) {
+            count = available;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            destination[i] = items[(currentHead + i) & (Capacity - 1)];
+        }
+        head.store(currentHead + count, std::memory_order_release);
+        return count;
+    }
+
+    // Empties the ring. Only safe while neither side is pushing or popping.
+    void reset() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_release);
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Approximate when called from the producer while the consumer runs
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+private:
+    // Head and tail live on separate cache lines so the two threads do not false-share
+    alignas(64) std::atomic<size_t> head; // Next item to pop (written by the consumer)
+    alignas(64) std::atomic<size_t> tail; // Next slot to fill (written by the producer)
+    alignas(64) T items[Capacity];
+};
+
+#endif
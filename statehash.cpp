@@ -0,0 +1,239 @@
+#include "statehash.h"
+#include <algorithm> // For std::min, std::max
+#include <cstring>  // For memcpy, memcmp
+#include <fstream>  // For the dump files
+#include <iomanip>  // For hex output
+#include <iostream> // For error output
+#include <string>   // For std::to_string
+
+// --- Hashing ---
+
+namespace {
+
+const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+const uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+inline uint64_t rotl64(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t read64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t round64(uint64_t accumulator, uint64_t input) {
+    accumulator += input * PRIME64_2;
+    accumulator = rotl64(accumulator, 31);
+    return accumulator * PRIME64_1;
+}
+
+inline uint64_t mergeRound(uint64_t accumulator, uint64_t lane) {
+    accumulator ^= round64(0, lane);
+    return accumulator * PRIME64_1 + PRIME64_4;
+}
+
+} // namespace
+
+uint64_t hashState(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+    uint64_t hash;
+
+    if (size >= 32) {
+        // Four independent lanes, one 8-byte word each per 32-byte stripe
+        uint64_t lane1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t lane2 = seed + PRIME64_2;
+        uint64_t lane3 = seed;
+        uint64_t lane4 = seed - PRIME64_1;
+        const uint8_t* lastStripe = end - 32;
+        do {
+            lane1 = round64(lane1, read64(p));
+            lane2 = round64(lane2, read64(p + 8));
+            lane3 = round64(lane3, read64(p + 16));
+            lane4 = round64(lane4, read64(p + 24));
+            p += 32;
+        } while (p <= lastStripe);
+
+        hash = rotl64(lane1, 1) + rotl64(lane2, 7) + rotl64(lane3, 12) + rotl64(lane4, 18);
+        hash = mergeRound(hash, lane1);
+        hash = mergeRound(hash, lane2);
+        hash = mergeRound(hash, lane3);
+        hash = mergeRound(hash, lane4);
+    }
+    else {
+        hash = seed + PRIME64_5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+
+    // Tail
+    for (; p + 8 <= end; p += 8) {
+        hash ^= round64(0, read64(p));
+        hash = rotl64(hash, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        hash ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+        hash = rotl64(hash, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= (*p) * PRIME64_5;
+        hash = rotl64(hash, 11) * PRIME64_1;
+    }
+
+    // Avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t hashCanonicalState(const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t combined = 0;
+    for (size_t offset = 0, block = 0; offset < size; offset += STATE_HASH_BLOCK_BYTES, ++block) {
+        combined ^= hashState(p + offset, std::min<size_t>(STATE_HASH_BLOCK_BYTES, size - offset), block);
+    }
+    // The size seeds the final mix, so trailing zero blocks still count
+    return hashState(&combined, sizeof(combined), size);
+}
+
+void writeStateHashMessage(uint32_t tick, uint64_t hash, uint8_t* out) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(tick >> (8 * i));
+    }
+    for (int i = 0; i < 8; ++i) {
+        out[4 + i] = static_cast<uint8_t>(hash >> (8 * i));
+    }
+}
+
+void readStateHashMessage(const uint8_t* data, uint32_t& tick, uint64_t& hash) {
+    tick = 0;
+    hash = 0;
+    for (int i = 0; i < 4; ++i) {
+        tick |= static_cast<uint32_t>(data[i]) << (8 * i);
+    }
+    for (int i = 0; i < 8; ++i) {
+        hash |= static_cast<uint64_t>(data[4 + i]) << (8 * i);
+    }
+}
+
+// --- Desync Detector ---
+
+DesyncDetector::DesyncDetector(DescribeStateFunction describeState)
+    : describeState(describeState), desynced(false), desyncTick(0), blockHashes(), combinedBlocks(0), currentSize(0) {
+    for (Entry& entry : history) {
+        entry.valid = false;
+    }
+}
+
+uint64_t DesyncDetector::recordLocalState(uint32_t tick, const void* state, size_t size) {
+    if (size > MAX_CANONICAL_STATE_BYTES) {
+        std::cerr << "Canonical state too large to record (" << size << " bytes)!" << std::endl;
+        size = MAX_CANONICAL_STATE_BYTES;
+    }
+    Entry& entry = history[tick & (DESYNC_HISTORY - 1)];
+    entry.tick = tick;
+    entry.size = static_cast<uint32_t>(size);
+    entry.valid = true;
+    memcpy(entry.state, state, size);
+
+    // Swap the hashes of changed blocks in and out of the XOR; a block past
+    // the end of either state contributes nothing
+    const uint8_t* p = static_cast<const uint8_t*>(state);
+    size_t blocks = (std::max(size, currentSize) + STATE_HASH_BLOCK_BYTES - 1) / STATE_HASH_BLOCK_BYTES;
+    for (size_t block = 0; block < blocks; ++block) {
+        size_t offset = block * STATE_HASH_BLOCK_BYTES;
+        size_t length = offset < size ? std::min<size_t>(STATE_HASH_BLOCK_BYTES, size - offset) : 0;
+        size_t previousLength = offset < currentSize ? std::min<size_t>(STATE_HASH_BLOCK_BYTES, currentSize - offset) : 0;
+        if (length == previousLength && memcmp(current + offset, p + offset, length) == 0) {
+            continue;
+        }
+        combinedBlocks ^= blockHashes[block];
+        blockHashes[block] = length > 0 ? hashState(p + offset, length, block) : 0;
+        combinedBlocks ^= blockHashes[block];
+        memcpy(current + offset, p + offset, length);
+    }
+    currentSize = size;
+    entry.hash = hashState(&combinedBlocks, sizeof(combinedBlocks), size);
+    return entry.hash;
+}
+
+bool DesyncDetector::getLocalHash(uint32_t tick, uint64_t& hash) const {
+    const Entry* entry = findEntry(tick);
+    if (entry == nullptr) {
+        return false;
+    }
+    hash = entry->hash;
+    return true;
+}
+
+const DesyncDetector::Entry* DesyncDetector::findEntry(uint32_t tick) const {
+    const Entry& entry = history[tick & (DESYNC_HISTORY - 1)];
+    if (!entry.valid || entry.tick != tick) {
+        return nullptr;
+    }
+    return &entry;
+}
+
+bool DesyncDetector::checkRemoteHash(uint32_t tick, uint64_t hash) {
+    const Entry* entry = findEntry(tick);
+    if (entry == nullptr || entry->hash == hash) {
+        return true;
+    }
+    if (!desynced) {
+        desynced = true;
+        desyncTick = tick;
+        std::cerr << "Desync detected at tick " << tick << "! Local hash " << std::hex << entry->hash
+                  << ", remote hash " << hash << std::dec << std::endl;
+        dumpState("local", tick, entry->hash, entry->state, entry->size);
+    }
+    return false;
+}
+
+bool DesyncDetector::getLocalState(uint32_t tick, const uint8_t*& data, size_t& size) const {
+    const Entry* entry = findEntry(tick);
+    if (entry == nullptr) {
+        return false;
+    }
+    data = entry->state;
+    size = entry->size;
+    return true;
+}
+
+void DesyncDetector::receiveRemoteState(uint32_t tick, const uint8_t* data, size_t size) {
+    dumpState("remote", tick, hashCanonicalState(data, size), data, size);
+}
+
+void DesyncDetector::dumpState(const char* side, uint32_t tick, uint64_t hash, const uint8_t* data, size_t size) const {
+    std::string filename = "desync_" + std::to_string(tick) + "_" + side + ".txt";
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "Failed to write desync dump " << filename << "!" << std::endl;
+        return;
+    }
+    out << "tick " << tick << "\n";
+    out << "hash " << std::hex << std::setw(16) << std::setfill('0') << hash << std::dec << std::setfill(' ') << "\n";
+    if (describeState) {
+        describeState(data, size, out);
+    }
+    out << "raw";
+    for (size_t i = 0; i < size; ++i) {
+        out << (i % 32 == 0 ? "\n" : " ") << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(data[i]);
+    }
+    out << std::dec << "\n";
+    std::cout << "Wrote desync dump " << filename << "." << std::endl;
+}
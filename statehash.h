@@ -0,0 +1,92 @@
+#pragma once
+#ifndef STATEHASH_H
+#define STATEHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Per-tick game state hashing for lockstep / rollback desync detection.
+//
+// Each peer serializes its canonical state once per tick, hashes it and sends
+// only the 12-byte (tick, hash) pair (the match host sends it to spectators
+// with every snapshot, see spectator.h). When a remote hash disagrees with
+// ours, the checking side dumps its state of that tick to
+// desync_<tick>_local.txt, asks the peer for its state (getLocalState on the
+// peer's side) and dumps that to desync_<tick>_remote.txt, so the first
+// diverging field can be found by comparing the two.
+
+// 64-bit hash using four independent multiply-rotate lanes over 32-byte stripes
+// (the xxHash64 construction), so the lanes pipeline/vectorize well.
+uint64_t hashState(const void* data, size_t size, uint64_t seed = 0);
+
+const int STATE_HASH_MESSAGE_BYTES = 12;
+const int DESYNC_HISTORY = 128;           // Ticks of local state kept for dumping (power of two)
+const int MAX_CANONICAL_STATE_BYTES = 1024;
+const int STATE_HASH_BLOCK_BYTES = 64;
+const int STATE_HASH_BLOCKS = MAX_CANONICAL_STATE_BYTES / STATE_HASH_BLOCK_BYTES;
+
+// Hash of a canonical state: every STATE_HASH_BLOCK_BYTES block is hashed on
+// its own (seeded with its index) and the block hashes are combined with XOR,
+// so from one tick to the next only the blocks that changed are rehashed.
+uint64_t hashCanonicalState(const void* data, size_t size);
+
+// Wire format of the hash exchange: tick (4 bytes) + hash (8 bytes), little-endian
+void writeStateHashMessage(uint32_t tick, uint64_t hash, uint8_t* out);
+void readStateHashMessage(const uint8_t* data, uint32_t& tick, uint64_t& hash);
+
+class DesyncDetector {
+public:
+    // Turns a canonical state blob back into readable fields for the dump files
+    typedef void (*DescribeStateFunction)(const uint8_t* state, size_t size, std::ostream& out);
+
+    explicit DesyncDetector(DescribeStateFunction describeState);
+
+    // Hashes this tick's canonical state and keeps a copy for later dumps.
+    // Only the blocks that differ from the previously recorded state are
+    // rehashed; the result equals hashCanonicalState. Returns the hash to
+    // send to the peer.
+    uint64_t recordLocalState(uint32_t tick, const void* state, size_t size);
+
+    // The hash we recorded for a tick, to send along with it
+    bool getLocalHash(uint32_t tick, uint64_t& hash) const;
+
+    // Compares a peer's hash with ours. On mismatch the local state is dumped
+    // and false is returned; the caller should then ask the peer for its state.
+    // Hashes for ticks we have not simulated yet (or no longer remember) are ignored.
+    bool checkRemoteHash(uint32_t tick, uint64_t hash);
+
+    // The state we recorded for a tick, to answer a peer's dump request
+    bool getLocalState(uint32_t tick, const uint8_t*& data, size_t& size) const;
+
+    // Writes the state a peer sent us after a mismatch
+    void receiveRemoteState(uint32_t tick, const uint8_t* data, size_t size);
+
+    bool hasDesynced() const { return desynced; }
+    uint32_t firstDesyncTick() const { return desyncTick; }
+
+private:
+    struct Entry {
+        uint32_t tick;
+        uint64_t hash;
+        uint32_t size;
+        bool valid;
+        uint8_t state[MAX_CANONICAL_STATE_BYTES];
+    };
+
+    const Entry* findEntry(uint32_t tick) const;
+    void dumpState(const char* side, uint32_t tick, uint64_t hash, const uint8_t* data, size_t size) const;
+
+    DescribeStateFunction describeState;
+    Entry history[DESYNC_HISTORY];
+    bool desynced;
+    uint32_t desyncTick;
+
+    // The last recorded state and its block hashes, for incremental updates
+    uint8_t current[MAX_CANONICAL_STATE_BYTES];
+    uint64_t blockHashes[STATE_HASH_BLOCKS];
+    uint64_t combinedBlocks;
+    size_t currentSize;
+};
+
+#endif
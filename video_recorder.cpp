@@ -0,0 +1,276 @@
+#include "video_recorder.h"
+#include <algorithm>          // For std::min, std::max
+#include <condition_variable> // For waking the workers and the writer
+#include <fstream>
+#include <iostream>           // For error output
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int FRAME_SLOTS = 6;             // Frames captured but not yet written; more slots ride out slower disks
+const int MAX_CONVERSION_WORKERS = 4;  // 800x600 converts in about a millisecond, so a few workers keep up easily
+
+enum SlotState : Uint8 {
+    SLOT_FREE,       // Owned by the render thread
+    SLOT_CAPTURED,   // Waiting for a worker
+    SLOT_CONVERTING, // Owned by a worker
+    SLOT_CONVERTED   // Waiting for the writer (which owns it while writing)
+};
+
+struct FrameSlot {
+    SlotState state = SLOT_FREE;
+    Uint64 sequence = 0; // Order in the file
+    int repeats = 0;     // Times the frame is written, to cover dropped or slow frames
+    std::vector<Uint32> argb;
+    std::vector<Uint8> yuv; // Y plane, then the quarter-size U and V planes
+};
+
+} // namespace
+
+struct VideoRecorder {
+    int width;
+    int height;
+    int framesPerSecond;
+    std::string path;
+    std::ofstream file;
+
+    // Render thread only
+    Uint32 startMs;
+    bool started;
+    bool failed;         // Readback is not possible; stop capturing
+    Uint64 timelineFrames; // Video frames accounted for so far, including repeats
+    Uint64 nextSequence;
+    Uint64 droppedFrames;
+
+    // Shared; slot ownership is handed over under the mutex
+    std::mutex mutex;
+    std::condition_variable wake;
+    FrameSlot slots[FRAME_SLOTS];
+    bool running;
+
+    // Writer only
+    Uint64 nextWrite;
+    Uint64 writtenFrames;
+    bool writeFailed;
+
+    std::vector<std::thread> workers;
+    std::thread writer;
+};
+
+void convertArgbToYuv420(const Uint32* argb, int width, int height, Uint8* yuv) {
+    Uint8* yPlane = yuv;
+    Uint8* uPlane = yuv + static_cast<size_t>(width) * height;
+    Uint8* vPlane = uPlane + static_cast<size_t>(width / 2) * (height / 2);
+    for (int y = 0; y < height; y += 2) {
+        const Uint32* row0 = argb + static_cast<size_t>(y) * width;
+        const Uint32* row1 = row0 + width;
+        Uint8* luma0 = yPlane + static_cast<size_t>(y) * width;
+        Uint8* luma1 = luma0 + width;
+        Uint8* u = uPlane + static_cast<size_t>(y / 2) * (width / 2);
+        Uint8* v = vPlane + static_cast<size_t>(y / 2) * (width / 2);
+        for (int x = 0; x < width; x += 2) {
+            int sumR = 0, sumG = 0, sumB = 0;
+            const Uint32 block[4] = { row0[x], row0[x + 1], row1[x], row1[x + 1] };
+            Uint8* luma[4] = { luma0 + x, luma0 + x + 1, luma1 + x, luma1 + x + 1 };
+            for (int i = 0; i < 4; ++i) {
+                int r = (block[i] >> 16) & 0xFF;
+                int g = (block[i] >> 8) & 0xFF;
+                int b = block[i] & 0xFF;
+                *luma[i] = static_cast<Uint8>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                sumR += r;
+                sumG += g;
+                sumB += b;
+            }
+            u[x / 2] = static_cast<Uint8>(((-38 * sumR - 74 * sumG + 112 * sumB + 512) >> 10) + 128);
+            v[x / 2] = static_cast<Uint8>(((112 * sumR - 94 * sumG - 18 * sumB + 512) >> 10) + 128);
+        }
+    }
+}
+
+namespace {
+
+void conversionWorker(VideoRecorder* recorder) {
+    std::unique_lock<std::mutex> lock(recorder->mutex);
+    for (;;) {
+        FrameSlot* slot = nullptr;
+        recorder->wake.wait(lock, [recorder, &slot] {
+            for (FrameSlot& candidate : recorder->slots) {
+                if (candidate.state == SLOT_CAPTURED) {
+                    slot = &candidate;
+                    return true;
+                }
+            }
+            return !recorder->running;
+        });
+        if (slot == nullptr) {
+            return; // Stopped, and every captured frame has been taken
+        }
+        slot->state = SLOT_CONVERTING;
+        lock.unlock();
+        convertArgbToYuv420(slot->argb.data(), recorder->width, recorder->height, slot->yuv.data());
+        lock.lock();
+        slot->state = SLOT_CONVERTED;
+        recorder->wake.notify_all();
+    }
+}
+
+void writerThread(VideoRecorder* recorder) {
+    static const char FRAME_HEADER[] = "FRAME\n";
+    std::unique_lock<std::mutex> lock(recorder->mutex);
+    for (;;) {
+        FrameSlot& slot = recorder->slots[recorder->nextWrite % FRAME_SLOTS];
+        recorder->wake.wait(lock, [recorder, &slot] {
+            bool ready = slot.state == SLOT_CONVERTED && slot.sequence == recorder->nextWrite;
+            bool pending = slot.state == SLOT_CAPTURED || slot.state == SLOT_CONVERTING;
+            return ready || (!recorder->running && !pending);
+        });
+        if (slot.state != SLOT_CONVERTED || slot.sequence != recorder->nextWrite) {
+            return; // Stopped and drained
+        }
+        lock.unlock();
+        for (int i = 0; i < slot.repeats && !recorder->writeFailed; ++i) {
+            recorder->file.write(FRAME_HEADER, sizeof(FRAME_HEADER) - 1);
+            recorder->file.write(reinterpret_cast<const char*>(slot.yuv.data()), slot.yuv.size());
+            if (!recorder->file) {
+                std::cerr << "Failed to write " << recorder->path << "! Recording stopped." << std::endl;
+                recorder->writeFailed = true;
+                break;
+            }
+            recorder->writtenFrames++;
+        }
+        lock.lock();
+        slot.state = SLOT_FREE;
+        recorder->nextWrite++;
+    }
+}
+
+// Copies the top-left width * height pixels of the finished frame into argb.
+// Returns false if they cannot be read.
+bool readFrame(VideoRecorder* recorder, SDL_Renderer* renderer, SDL_Surface* softwareTarget, Uint32* argb) {
+    int pitch = recorder->width * static_cast<int>(sizeof(Uint32));
+    if (softwareTarget) {
+        if (softwareTarget->w < recorder->width || softwareTarget->h < recorder->height) {
+            std::cerr << "Window surface is " << softwareTarget->w << "x" << softwareTarget->h << ", smaller than the recording's "
+                      << recorder->width << "x" << recorder->height << "." << std::endl;
+            return false;
+        }
+        if (SDL_MUSTLOCK(softwareTarget) && SDL_LockSurface(softwareTarget) != 0) {
+            return false;
+        }
+        // A plain row copy when the surface is already ARGB8888 or RGB888
+        int result = SDL_ConvertPixels(recorder->width, recorder->height, softwareTarget->format->format, softwareTarget->pixels,
+                                       softwareTarget->pitch, SDL_PIXELFORMAT_ARGB8888, argb, pitch);
+        if (SDL_MUSTLOCK(softwareTarget)) {
+            SDL_UnlockSurface(softwareTarget);
+        }
+        return result == 0;
+    }
+    // Read in the framebuffer's usual layout so SDL does not convert on the render thread
+    SDL_Rect area = { 0, 0, recorder->width, recorder->height };
+    return SDL_RenderReadPixels(renderer, &area, SDL_PIXELFORMAT_ARGB8888, argb, pitch) == 0;
+}
+
+} // namespace
+
+VideoRecorder* startVideoRecording(const char* path, int width, int height, int framesPerSecond) {
+    if (width <= 0 || height <= 0 || width % 2 != 0 || height % 2 != 0 || framesPerSecond <= 0) {
+        std::cerr << "Cannot record " << width << "x" << height << " at " << framesPerSecond << " FPS: size must be even." << std::endl;
+        return nullptr;
+    }
+    VideoRecorder* recorder = new VideoRecorder();
+    recorder->width = width;
+    recorder->height = height;
+    recorder->framesPerSecond = framesPerSecond;
+    recorder->path = path;
+    recorder->file.open(path, std::ios::binary);
+    if (!recorder->file) {
+        std::cerr << "Failed to create " << path << "!" << std::endl;
+        delete recorder;
+        return nullptr;
+    }
+    recorder->file << "YUV4MPEG2 W" << width << " H" << height << " F" << framesPerSecond << ":1 Ip A1:1 C420jpeg\n";
+
+    recorder->startMs = 0;
+    recorder->started = false;
+    recorder->failed = false;
+    recorder->timelineFrames = 0;
+    recorder->nextSequence = 0;
+    recorder->droppedFrames = 0;
+    recorder->running = true;
+    recorder->nextWrite = 0;
+    recorder->writtenFrames = 0;
+    recorder->writeFailed = false;
+    size_t pixels = static_cast<size_t>(width) * height;
+    for (FrameSlot& slot : recorder->slots) {
+        slot.argb.resize(pixels); // Allocated up front so capturing never touches the heap
+        slot.yuv.resize(pixels + pixels / 2);
+    }
+
+    // Leave a core for the game itself
+    int workerCount = std::max(1, std::min(MAX_CONVERSION_WORKERS, static_cast<int>(std::thread::hardware_concurrency()) - 2));
+    for (int i = 0; i < workerCount; ++i) {
+        recorder->workers.emplace_back(conversionWorker, recorder);
+    }
+    recorder->writer = std::thread(writerThread, recorder);
+    return recorder;
+}
+
+void captureVideoFrame(VideoRecorder* recorder, SDL_Renderer* renderer, SDL_Surface* softwareTarget, Uint32 nowMs) {
+    if (recorder == nullptr || recorder->failed) {
+        return;
+    }
+    if (!recorder->started) {
+        recorder->startMs = nowMs;
+        recorder->started = true;
+    }
+    // Frames the video should hold by now; the first one is due immediately
+    Uint64 dueFrames = static_cast<Uint64>(nowMs - recorder->startMs) * recorder->framesPerSecond / 1000 + 1;
+    if (dueFrames <= recorder->timelineFrames) {
+        return;
+    }
+
+    FrameSlot& slot = recorder->slots[recorder->nextSequence % FRAME_SLOTS];
+    {
+        std::lock_guard<std::mutex> lock(recorder->mutex);
+        if (slot.state != SLOT_FREE) {
+            recorder->droppedFrames++; // Encoding is behind; the next captured frame covers this one
+            return;
+        }
+    }
+    if (!readFrame(recorder, renderer, softwareTarget, slot.argb.data())) {
+        std::cerr << "Failed to read back the frame for recording! SDL_Error: " << SDL_GetError() << std::endl;
+        recorder->failed = true;
+        return;
+    }
+    // A long frame is held for as long as it was on screen, up to a second
+    Uint64 repeats = std::min<Uint64>(dueFrames - recorder->timelineFrames, recorder->framesPerSecond);
+    recorder->timelineFrames = dueFrames;
+
+    std::lock_guard<std::mutex> lock(recorder->mutex);
+    slot.sequence = recorder->nextSequence++;
+    slot.repeats = static_cast<int>(repeats);
+    slot.state = SLOT_CAPTURED;
+    recorder->wake.notify_all();
+}
+
+void stopVideoRecording(VideoRecorder* recorder) {
+    if (recorder == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(recorder->mutex);
+        recorder->running = false;
+        recorder->wake.notify_all();
+    }
+    for (std::thread& worker : recorder->workers) {
+        worker.join();
+    }
+    recorder->writer.join();
+    recorder->file.close();
+    std::cout << "Recorded " << recorder->nextSequence << " frames (" << recorder->writtenFrames << " at "
+              << recorder->framesPerSecond << " FPS, " << recorder->droppedFrames << " dropped) to " << recorder->path << "." << std::endl;
+    delete recorder;
+}
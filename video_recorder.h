@@ -0,0 +1,41 @@
+#pragma once
+#ifndef VIDEO_RECORDER_H
+#define VIDEO_RECORDER_H
+
+#include <SDL.h>
+
+// Gameplay recording to a YUV4MPEG2 (.y4m) file, playable with ffplay/mpv or
+// encodable with ffmpeg.
+//
+// The render thread only copies the finished frame into one of a few
+// preallocated slots (SDL_RenderReadPixels, or a memcpy of the software
+// framebuffer). Worker threads convert the slots from ARGB to 4:2:0 YUV, and
+// a writer thread appends them to the file in order. If the workers or the
+// disk fall behind and every slot is busy, the frame is dropped rather than
+// making the game wait.
+//
+// Frames are taken at a fixed rate from the capture calls' timestamps, so a
+// game running faster than the recording rate is sampled, and a slow frame is
+// written several times to keep the video in step with the game.
+
+struct VideoRecorder;
+
+// Creates path and starts the worker threads. width and height must be even.
+// Returns nullptr (and prints why) on failure.
+VideoRecorder* startVideoRecording(const char* path, int width, int height, int framesPerSecond);
+
+// Call after drawing a frame and before presenting it. Reads from
+// softwareTarget when the renderer draws into a surface (flush it first),
+// otherwise from the renderer. Does nothing if no frame is due at nowMs.
+void captureVideoFrame(VideoRecorder* recorder, SDL_Renderer* renderer, SDL_Surface* softwareTarget, Uint32 nowMs);
+
+// Writes the frames still in flight, stops the threads, closes the file and
+// prints how many frames were recorded and dropped
+void stopVideoRecording(VideoRecorder* recorder);
+
+// Converts tightly packed ARGB8888 pixels to the planar 4:2:0 layout of a
+// .y4m frame (BT.601 studio range, chroma averaged over 2x2 blocks). width and
+// height must be even; yuv receives width * height * 3 / 2 bytes.
+void convertArgbToYuv420(const Uint32* argb, int width, int height, Uint8* yuv);
+
+#endif